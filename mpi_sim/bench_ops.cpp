@@ -0,0 +1,303 @@
+/* Microbenchmarks of individual operators.
+ *
+ * Each benchmark builds one operator over synthetic signals of a given size
+ * n (n x 1 vectors, and n x n matrices for the connection weights of DotInc
+ * and the learning rules), calls it repeatedly and reports the time per
+ * call as CSV. Bytes per call is the least memory traffic the operator
+ * needs (every input read once, every output written once), so GB/s can
+ * be compared with the machine's memory bandwidth. */
+
+#include <map>
+#include <vector>
+#include <string>
+#include <memory>
+#include <random>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+
+#include "optionparser.h"
+
+#include "operator.hpp"
+#include "timing.hpp"
+
+using namespace std;
+
+// Each timed repetition makes enough calls to cover about this many elements,
+// so that reading the clock is negligible even for small operators.
+const size_t ELEMENTS_PER_REP = 1 << 22;
+
+class BenchCase{
+public:
+    BenchCase(int n, unsigned seed):n(n), elements(0), bytes(0), rng(seed){}
+
+    // A new signal of the given shape, with values uniform in [low, high).
+    SignalView signal(int size1, int size2, dtype low=-1.0, dtype high=1.0){
+        uniform_real_distribution<dtype> dist(low, high);
+
+        auto base = unique_ptr<BaseSignal>(new BaseSignal(size1, size2));
+        for(auto& x : base->data()){
+            x = dist(rng);
+        }
+
+        signals.push_back(move(base));
+        return view(*signals.back());
+    }
+
+    static SignalView view(BaseSignal& base){
+        return SignalView(
+            base, ublas::slice(0, 1, base.size1()), ublas::slice(0, 1, base.size2()));
+    }
+
+    int n;
+
+    // Elements processed and least bytes moved per call.
+    size_t elements;
+    size_t bytes;
+
+    unique_ptr<Operator> op;
+
+private:
+    mt19937 rng;
+    vector<unique_ptr<BaseSignal>> signals;
+};
+
+const size_t V = sizeof(dtype);
+
+static void make_lif(BenchCase& c){
+    int n = c.n;
+    c.op = unique_ptr<Operator>(new LIF(
+        n, 0.02, 0.002, 0.0, 0.001, c.signal(n, 1, 0.0, 3.0), c.signal(n, 1),
+        c.signal(n, 1, 0.0, 1.0), c.signal(n, 1, 0.0, 0.002)));
+    c.elements = n;
+    c.bytes = 6 * n * V; // J; voltage and ref_time both ways; output
+}
+
+static void make_lif_rate(BenchCase& c){
+    int n = c.n;
+    c.op = unique_ptr<Operator>(new LIFRate(n, 0.02, 0.002, c.signal(n, 1, 0.0, 3.0), c.signal(n, 1)));
+    c.elements = n;
+    c.bytes = 2 * n * V;
+}
+
+static void make_dot_inc(BenchCase& c){
+    int n = c.n;
+    c.op = unique_ptr<Operator>(new DotInc(c.signal(n, n), c.signal(n, 1), c.signal(n, 1)));
+    c.elements = size_t(n) * n;
+    c.bytes = (size_t(n) * n + 3 * n) * V;
+}
+
+static void make_elementwise_inc(BenchCase& c){
+    int n = c.n;
+    c.op = unique_ptr<Operator>(new ElementwiseInc(c.signal(n, 1), c.signal(n, 1), c.signal(n, 1)));
+    c.elements = n;
+    c.bytes = 4 * n * V;
+}
+
+static void make_copy(BenchCase& c){
+    int n = c.n;
+    c.op = unique_ptr<Operator>(new Copy(c.signal(n, 1), c.signal(n, 1)));
+    c.elements = n;
+    c.bytes = 2 * n * V;
+}
+
+static void make_sliced_copy(BenchCase& c){
+    int n = c.n;
+    c.op = unique_ptr<Operator>(new SlicedCopy(
+        c.signal(n, 1), c.signal(2 * n, 1), true,
+        0, 2 * n, 2, 0, n, 1, vector<int>(), vector<int>()));
+    c.elements = n;
+    c.bytes = 3 * n * V;
+}
+
+static void make_simple_synapse(BenchCase& c){
+    int n = c.n;
+    c.op = unique_ptr<Operator>(new SimpleSynapse(c.signal(n, 1), c.signal(n, 1), -0.9, 0.1));
+    c.elements = n;
+    c.bytes = 3 * n * V;
+}
+
+static void make_synapse(BenchCase& c){
+    int n = c.n;
+
+    // A stable second order filter with unit gain.
+    BaseSignal numer(2, 1), denom(1, 1);
+    numer(0, 0) = 0.05;
+    numer(1, 0) = 0.05;
+    denom(0, 0) = -0.9;
+
+    c.op = unique_ptr<Operator>(new Synapse(c.signal(n, 1), c.signal(n, 1), numer, denom));
+    c.elements = n;
+    c.bytes = 2 * n * V;
+}
+
+static void make_bcm(BenchCase& c){
+    int n = c.n;
+    c.op = unique_ptr<Operator>(new BCM(
+        c.signal(n, 1), c.signal(n, 1), c.signal(n, 1), c.signal(n, n), 1e-6, 0.001));
+    c.elements = size_t(n) * n;
+    c.bytes = (size_t(n) * n + 3 * n) * V;
+}
+
+static void make_oja(BenchCase& c){
+    int n = c.n;
+    c.op = unique_ptr<Operator>(new Oja(
+        c.signal(n, 1), c.signal(n, 1), c.signal(n, n), c.signal(n, n), 1e-6, 0.001, 1.0));
+    c.elements = size_t(n) * n;
+    c.bytes = (2 * size_t(n) * n + 2 * n) * V;
+}
+
+static void make_voja(BenchCase& c){
+    int n = c.n;
+    BaseSignal scale(n, 1);
+    fill(scale.data().begin(), scale.data().end(), 1.0);
+
+    c.op = unique_ptr<Operator>(new Voja(
+        c.signal(n, 1), c.signal(n, 1), c.signal(n, n), c.signal(n, n), c.signal(1, 1),
+        scale, 1e-6, 0.001));
+    c.elements = size_t(n) * n;
+    c.bytes = (2 * size_t(n) * n + 3 * n) * V;
+}
+
+typedef void (*CaseMaker)(BenchCase&);
+
+static const vector<pair<string, CaseMaker>> all_cases = {
+    {"LIF", make_lif},
+    {"LIFRate", make_lif_rate},
+    {"DotInc", make_dot_inc},
+    {"ElementwiseInc", make_elementwise_inc},
+    {"Copy", make_copy},
+    {"SlicedCopy", make_sliced_copy},
+    {"SimpleSynapse", make_simple_synapse},
+    {"Synapse", make_synapse},
+    {"BCM", make_bcm},
+    {"Oja", make_oja},
+    {"Voja", make_voja}};
+
+static vector<string> split_list(string s){
+    vector<string> items;
+    boost::split(items, s, boost::is_any_of(","));
+    items.erase(remove(items.begin(), items.end(), ""), items.end());
+    return items;
+}
+
+enum benchOptionIndex {UNKNOWN, HELP, SIZES, OPS, REPS, WARMUP, SEED, OUT};
+
+const option::Descriptor bench_usage[] =
+{
+ {UNKNOWN, 0, "" , "",        option::Arg::None, "USAGE: bench_ops [options]\n\n"
+                                                 "Times operators on synthetic signals and prints the results as CSV.\n"
+                                                 "Options:" },
+ {HELP,    0, "" , "help",    option::Arg::None, "  --help  \tPrint usage and exit." },
+ {SIZES,   0, "",  "sizes",   option::Arg::NonEmpty, "  --sizes  \tComma-separated signal sizes n. Vectors are n x 1, and the "
+                                                     "weights of DotInc and the learning rules are n x n. "
+                                                     "Defaults to 64,256,1024."},
+ {OPS,     0, "",  "ops",     option::Arg::NonEmpty, "  --ops  \tComma-separated operators to run. Defaults to all of: "
+                                                     "LIF, LIFRate, DotInc, ElementwiseInc, Copy, SlicedCopy, "
+                                                     "SimpleSynapse, Synapse, BCM, Oja, Voja."},
+ {REPS,    0, "",  "reps",    option::Arg::Numeric, "  --reps  \tNumber of timed repetitions. The median and minimum "
+                                                    "are reported. Defaults to 20."},
+ {WARMUP,  0, "",  "warmup",  option::Arg::Numeric, "  --warmup  \tNumber of untimed repetitions first. Defaults to 3."},
+ {SEED,    0, "",  "seed",    option::Arg::Numeric, "  --seed  \tSeed for the signal values. Defaults to 1."},
+ {OUT,     0, "",  "out",     option::Arg::NonEmpty, "  --out  \tFile to write the CSV to, instead of standard output."},
+ {UNKNOWN, 0, "" , "",        option::Arg::None, "\nExamples:\n"
+                                                 "  bench_ops --ops LIF,DotInc --sizes 100,1000\n" },
+ {0,0,0,0,0,0}
+};
+
+int main(int argc, char **argv){
+    argc -= (argc > 0); argv += (argc > 0); // skip program name argv[0] if present
+    option::Stats  stats(bench_usage, argc, argv);
+    option::Option options[stats.options_max], buffer[stats.buffer_max];
+    option::Parser parse(bench_usage, argc, argv, options, buffer);
+
+    if(parse.error()){
+        return 1;
+    }
+
+    if(options[HELP]){
+        option::printUsage(std::cout, bench_usage);
+        return 0;
+    }
+
+    vector<int> sizes;
+    for(string s : split_list(options[SIZES] ? options[SIZES].arg : "64,256,1024")){
+        sizes.push_back(boost::lexical_cast<int>(s));
+    }
+
+    map<string, CaseMaker> makers(all_cases.begin(), all_cases.end());
+    vector<string> op_names;
+
+    if(options[OPS]){
+        op_names = split_list(options[OPS].arg);
+
+        for(string name : op_names){
+            if(!makers.count(name)){
+                cerr << "Unknown operator: " << name << "." << endl;
+                return 1;
+            }
+        }
+    }else{
+        for(auto& p : all_cases){
+            op_names.push_back(p.first);
+        }
+    }
+
+    int reps = options[REPS] ? max(boost::lexical_cast<int>(options[REPS].arg), 1) : 20;
+    int warmup = options[WARMUP] ? boost::lexical_cast<int>(options[WARMUP].arg) : 3;
+    unsigned seed = options[SEED] ? boost::lexical_cast<unsigned>(options[SEED].arg) : 1;
+
+    ofstream out_file;
+    if(options[OUT]){
+        out_file.open(options[OUT].arg);
+
+        if(!out_file){
+            cerr << "Could not open " << options[OUT].arg << "." << endl;
+            return 1;
+        }
+    }
+
+    ostream& out = options[OUT] ? out_file : cout;
+
+    out << "op,n,elements,bytes_per_call,calls_per_rep,reps,"
+        << "ns_per_call,min_ns_per_call,ns_per_element,gb_per_s" << endl;
+
+    for(string name : op_names){
+        for(int n : sizes){
+            BenchCase c(n, seed);
+            makers[name](c);
+
+            Operator& op = *c.op;
+            op.reset(seed);
+
+            size_t calls = max(size_t(1), ELEMENTS_PER_REP / max(c.elements, size_t(1)));
+
+            for(int r = 0; r < warmup; r++){
+                for(size_t i = 0; i < calls; i++){
+                    op();
+                }
+            }
+
+            vector<double> ns_per_call;
+            for(int r = 0; r < reps; r++){
+                auto begin = timing_clock::now();
+
+                for(size_t i = 0; i < calls; i++){
+                    op();
+                }
+
+                ns_per_call.push_back(double(elapsed_ns(begin, timing_clock::now())) / calls);
+            }
+
+            sort(ns_per_call.begin(), ns_per_call.end());
+            double median = ns_per_call[ns_per_call.size() / 2];
+
+            out << name << "," << n << "," << c.elements << "," << c.bytes << ","
+                << calls << "," << reps << "," << median << "," << ns_per_call[0] << ","
+                << median / c.elements << "," << c.bytes / median << endl;
+        }
+    }
+
+    return 0;
+}
@@ -1,22 +1,221 @@
 #include "chunk.hpp"
 
-// in bytes, for each process.
-#define MAX_RUNTIME_OUTPUT_SIZE 5000
+#include <thread>
 
 MpiSimulatorChunk::MpiSimulatorChunk(bool collect_timings)
 :time(0.0), dt(0.001), n_steps(0), rank(0), n_processors(1),
-mpi_merged(false), collect_timings(collect_timings){
+log_per_rank(false), n_io_servers(0), io_comm(MPI_COMM_NULL), sim_comm(MPI_COMM_NULL),
+network_image_mode(NETWORK_IMAGE_NONE), fold_signals_enabled(false),
+mpi_merged(false), collect_timings(collect_timings), timing_period(1), trace_enabled(false),
+perf_counters_enabled(false), memory_report_enabled(false), n_runs(0), load_ns(0){
 }
 
 MpiSimulatorChunk::MpiSimulatorChunk(int rank, int n_processors, bool mpi_merged, bool collect_timings)
 :time(0.0), dt(0.001), n_steps(0), rank(rank), n_processors(n_processors),
-mpi_merged(mpi_merged), collect_timings(collect_timings){
+log_per_rank(false), n_io_servers(0), io_comm(MPI_COMM_NULL), sim_comm(MPI_COMM_NULL),
+network_image_mode(NETWORK_IMAGE_NONE), fold_signals_enabled(false),
+mpi_merged(mpi_merged), collect_timings(collect_timings), timing_period(1), trace_enabled(false),
+perf_counters_enabled(false), memory_report_enabled(false), n_runs(0), load_ns(0){
     stringstream ss;
     ss << "Chunk " << rank;
     label = ss.str();
 }
 
+/* Read count elements of a 1D float64 dataset, starting at offset, into dst. */
+static void read_signal_data(
+        hid_t dset, hid_t read_plist, hsize_t offset, hsize_t count, dtype* dst){
+
+    hid_t file_space = H5Dget_space(dset);
+    H5Sselect_hyperslab(file_space, H5S_SELECT_SET, &offset, NULL, &count, NULL);
+    hid_t mem_space = H5Screate_simple(1, &count, NULL);
+
+    herr_t err = H5Dread(dset, H5T_NATIVE_DOUBLE, mem_space, file_space, read_plist, dst);
+
+    H5Sclose(mem_space);
+    H5Sclose(file_space);
+
+    if(err < 0){
+        stringstream msg;
+        msg << "Could not read " << count << " elements of signal data at offset " << offset << ".";
+        throw runtime_error(msg.str());
+    }
+}
+
 void MpiSimulatorChunk::from_file(string filename, hid_t file_plist, hid_t read_plist){
+    from_file(filename, file_plist, read_plist, MPI_COMM_NULL);
+}
+
+void MpiSimulatorChunk::from_file(
+        string filename, hid_t file_plist, hid_t read_plist, MPI_Comm comm){
+
+    load_begin = timing_clock::now();
+
+    if(network_image_mode == NETWORK_IMAGE_LOAD){
+        from_image(network_image_filename(network_image_name, rank));
+
+        int n_components = 0;
+        share_network_metadata(n_components, comm);
+        return;
+    }
+
+    if(network_image_mode == NETWORK_IMAGE_SAVE){
+        image_writer = unique_ptr<NetworkImageWriter>(new NetworkImageWriter());
+    }
+
+    hid_t attr;
+    hid_t f = H5Fopen(filename.c_str(), H5F_ACC_RDONLY, file_plist);
+
+    // Get n_components, dt and the probe info on rank 0, and share them.
+    int n_components = 0;
+
+    if(rank == 0){
+        attr = H5Aopen(f, "n_components", H5P_DEFAULT);
+        H5Aread(attr, H5T_NATIVE_INT, &n_components);
+        H5Aclose(attr);
+
+        cout << "Loading nengo network from file." << endl;
+        cout << "Network has " << n_components << " components." << endl;
+
+        attr = H5Aopen(f, "dt", H5P_DEFAULT);
+        H5Aread(attr, H5T_NATIVE_DOUBLE, &dt);
+        H5Aclose(attr);
+
+        probe_info = read_probe_info(f, read_plist);
+    }
+
+    share_network_metadata(n_components, comm);
+
+    // The components assigned to this process. All of them are read before
+    // any of their operators are built, so that build_ops can build
+    // operators concurrently while the signal map is no longer changing.
+    vector<ComponentData> components;
+
+    for(int component = rank; component < n_components; component += n_processors){
+        components.push_back(ComponentData());
+        components.back().component = component;
+
+        read_component(f, read_plist, components.back());
+    }
+
+    H5Fclose(f);
+
+    add_components(components);
+}
+
+void MpiSimulatorChunk::from_buffers(
+        dtype network_dt, int n_components, const vector<string>& packed,
+        const vector<string>& network_probe_info, MPI_Comm comm){
+
+    load_begin = timing_clock::now();
+
+    if(network_image_mode == NETWORK_IMAGE_LOAD || network_image_mode == NETWORK_IMAGE_CACHE){
+        throw runtime_error(
+            "Network images can only be loaded, or cached, for networks read from a file.");
+    }
+
+    if(network_image_mode == NETWORK_IMAGE_SAVE){
+        image_writer = unique_ptr<NetworkImageWriter>(new NetworkImageWriter());
+    }
+
+    if(rank == 0){
+        if(int(packed.size()) != n_components){
+            stringstream msg;
+            msg << "Got " << packed.size() << " packed components for a network with "
+                << n_components << " components.";
+            throw runtime_error(msg.str());
+        }
+
+        cout << "Loading nengo network from memory." << endl;
+        cout << "Network has " << n_components << " components." << endl;
+
+        dt = network_dt;
+
+        probe_info.clear();
+        for(const string& pi : network_probe_info){
+            probe_info.push_back(ProbeSpec(pi));
+        }
+    }
+
+    share_network_metadata(n_components, comm);
+
+    vector<ComponentData> components;
+
+    if(rank == 0){
+        // Components are sent in order, and every process receives its own
+        // in order, so the sends cannot block each other.
+        for(int component = 0; component < n_components; component++){
+            int owner = component % n_processors;
+
+            if(owner == 0){
+                components.push_back(ComponentData());
+                components.back().component = component;
+                unpack_component(packed[component], components.back());
+            }else{
+                send_component_buffer(packed[component], owner, comm);
+            }
+        }
+    }else{
+        for(int component = rank; component < n_components; component += n_processors){
+            components.push_back(ComponentData());
+            components.back().component = component;
+            unpack_component(recv_component_buffer(comm), components.back());
+        }
+    }
+
+    add_components(components);
+}
+
+// Largest piece of a packed component sent in one message.
+static const size_t COMPONENT_MESSAGE_SIZE = 1 << 30;
+
+void MpiSimulatorChunk::send_component_buffer(const string& buffer, int dst, MPI_Comm comm){
+    uint64_t size = buffer.size();
+    MPI_Send(&size, 1, MPI_UINT64_T, dst, component_tag, comm);
+
+    for(size_t sent = 0; sent < size; sent += COMPONENT_MESSAGE_SIZE){
+        int n = min(COMPONENT_MESSAGE_SIZE, size - sent);
+        MPI_Send((void*) (buffer.data() + sent), n, MPI_BYTE, dst, component_tag, comm);
+    }
+}
+
+string MpiSimulatorChunk::recv_component_buffer(MPI_Comm comm){
+    uint64_t size;
+    MPI_Recv(&size, 1, MPI_UINT64_T, 0, component_tag, comm, MPI_STATUS_IGNORE);
+
+    string buffer(size, '\0');
+    for(size_t received = 0; received < size; received += COMPONENT_MESSAGE_SIZE){
+        int n = min(COMPONENT_MESSAGE_SIZE, size - received);
+        MPI_Recv(&buffer[received], n, MPI_BYTE, 0, component_tag, comm, MPI_STATUS_IGNORE);
+    }
+
+    return buffer;
+}
+
+void MpiSimulatorChunk::add_components(vector<ComponentData>& components){
+    for(ComponentData& data : components){
+        for(ComponentSignal& signal : data.signals){
+            add_base_signal(signal.key, signal.label, move(signal.data));
+        }
+    }
+
+    build_ops(components);
+
+    for(ComponentData& data : components){
+        for(const string& probe_str : data.probe_strings){
+            add_probe(ProbeSpec(probe_str));
+        }
+    }
+
+    if(image_writer){
+        image_writer->write(
+            network_image_filename(network_image_name, rank), rank, n_processors,
+            dt, signal_map, signal_labels, probe_info);
+
+        image_writer.reset();
+    }
+}
+
+void MpiSimulatorChunk::read_component(hid_t f, hid_t read_plist, ComponentData& data){
     herr_t err;
     hsize_t shape[2];
     hid_t dspace, attr;
@@ -26,211 +225,412 @@ void MpiSimulatorChunk::from_file(string filename, hid_t file_plist, hid_t read_
     hid_t str_type = H5Tcopy(H5T_C_S1);
     H5Tset_strpad(str_type, H5T_STR_NULLPAD);
 
-    hid_t f = H5Fopen(filename.c_str(), H5F_ACC_RDONLY, file_plist);
+    stringstream ss;
+    ss << data.component;
 
-    // Get n_components
-    int n_components;
-    attr = H5Aopen(f, "n_components", H5P_DEFAULT);
-    H5Aread(attr, H5T_NATIVE_INT, &n_components);
-    H5Aclose(attr);
+    // Open the group assigned to my component
+    hid_t component_group = H5Gopen(f, ss.str().c_str(), H5P_DEFAULT);
 
-    if(rank == 0){
-        cout << "Loading nengo network from file." << endl;
-        cout << "Network has " << n_components << " components." << endl;
-    }
+    // signal keys
+    hid_t signal_keys = H5Dopen(component_group, "signal_keys", H5P_DEFAULT);
 
-    // Get dt
-    attr = H5Aopen(f, "dt", H5P_DEFAULT);
-    H5Aread(attr, H5T_NATIVE_DOUBLE, &dt);
-    H5Aclose(attr);
+    dspace = H5Dget_space(signal_keys);
+    ndim = H5Sget_simple_extent_dims(dspace, shape, NULL);
+    H5Sclose(dspace);
 
-    int component = rank;
-    while(component < n_components){
+    assert(ndim == 1);
 
-        stringstream ss;
-        ss << component;
+    hsize_t n_signals = shape[0];
 
-        // Open the group assigned to my component
-        hid_t component_group = H5Gopen(f, ss.str().c_str(), H5P_DEFAULT);
+    auto signal_keys_buffer = unique_ptr<key_type[]>(new key_type[n_signals]);
+    err = H5Dread(
+        signal_keys, H5T_NATIVE_LLONG, H5S_ALL, H5S_ALL,
+        read_plist, signal_keys_buffer.get());
 
-        // signal keys
-        hid_t signal_keys = H5Dopen(component_group, "signal_keys", H5P_DEFAULT);
+    H5Dclose(signal_keys);
 
-        dspace = H5Dget_space(signal_keys);
-        ndim = H5Sget_simple_extent_dims(dspace, shape, NULL);
-        H5Sclose(dspace);
+    // signal shapes
+    hid_t signal_shapes = H5Dopen(component_group, "signal_shapes", H5P_DEFAULT);
 
-        assert(ndim == 1);
+    dspace = H5Dget_space(signal_shapes);
+    ndim = H5Sget_simple_extent_dims(dspace, shape, NULL);
+    H5Sclose(dspace);
 
-        hsize_t n_signals = shape[0];
+    assert(shape[0] == n_signals);
+    assert(n_signals == 0 || shape[1] == 2);
+    assert(n_signals == 0 || ndim == 2);
 
-        auto signal_keys_buffer = unique_ptr<key_type[]>(new key_type[n_signals]);
-        err = H5Dread(
-            signal_keys, H5T_NATIVE_LLONG, H5S_ALL, H5S_ALL,
-            read_plist, signal_keys_buffer.get());
+    auto signal_shapes_buffer = unique_ptr<short[]>(new short [2 * n_signals]);
+    err = H5Dread(
+        signal_shapes, H5T_NATIVE_SHORT, H5S_ALL, H5S_ALL,
+        read_plist, signal_shapes_buffer.get());
 
-        H5Dclose(signal_keys);
+    H5Dclose(signal_shapes);
 
-        // signal shapes
-        hid_t signal_shapes = H5Dopen(component_group, "signal_shapes", H5P_DEFAULT);
+    // signal labels
+    hid_t labels = H5Dopen(component_group, "signal_labels", H5P_DEFAULT);
 
-        dspace = H5Dget_space(signal_shapes);
-        ndim = H5Sget_simple_extent_dims(dspace, shape, NULL);
-        H5Sclose(dspace);
+    dspace = H5Dget_space(labels);
+    ndim = H5Sget_simple_extent_dims(dspace, shape, NULL);
+    H5Sclose(dspace);
 
-        assert(shape[0] == n_signals);
-        assert(n_signals == 0 || shape[1] == 2);
-        assert(n_signals == 0 || ndim == 2);
+    assert(ndim == 1);
 
-        auto signal_shapes_buffer = unique_ptr<short[]>(new short [2 * n_signals]);
-        err = H5Dread(
-            signal_shapes, H5T_NATIVE_SHORT, H5S_ALL, H5S_ALL,
-            read_plist, signal_shapes_buffer.get());
+    auto label_buffer = unique_ptr<char>(new char[shape[0]]);
+    err = H5Dread(labels, str_type, H5S_ALL, H5S_ALL, read_plist, label_buffer.get());
+    H5Dclose(labels);
 
-        H5Dclose(signal_shapes);
+    // signal labels are parsed up front, since signals are not
+    // necessarily added to the chunk at the point they're read
+    vector<string> labels_list;
+    str_ptr = label_buffer.get();
 
-        // signal labels
-        hid_t labels = H5Dopen(component_group, "signal_labels", H5P_DEFAULT);
+    for(int i = 0; i < n_signals; i++){
+        labels_list.push_back(string(str_ptr));
 
-        dspace = H5Dget_space(labels);
-        ndim = H5Sget_simple_extent_dims(dspace, shape, NULL);
-        H5Sclose(dspace);
+        while(*str_ptr != '\0'){
+            str_ptr++;
+        }
 
-        assert(ndim == 1);
+        if(i < n_signals-1){
+            str_ptr++;
+        }
+    }
 
-        auto label_buffer = unique_ptr<char>(new char[shape[0]]);
-        err = H5Dread(labels, str_type, H5S_ALL, H5S_ALL, read_plist, label_buffer.get());
-        H5Dclose(labels);
+    // signals
+    hid_t signals = H5Dopen(component_group, "signals", H5P_DEFAULT);
 
-        // signals
-        hid_t signals = H5Dopen(component_group, "signals", H5P_DEFAULT);
+    dspace = H5Dget_space(signals);
+    ndim = H5Sget_simple_extent_dims(dspace, shape, NULL);
+    H5Sclose(dspace);
 
-        dspace = H5Dget_space(signals);
-        ndim = H5Sget_simple_extent_dims(dspace, shape, NULL);
-        H5Sclose(dspace);
+    assert(ndim == 1);
+
+    // Signal data is read straight into the storage of each BaseSignal,
+    // never more than SIGNAL_READ_BLOCK elements at a time. Signals
+    // smaller than that are batched, so that a component with many
+    // small signals doesn't need one read per signal; the batch goes
+    // through a staging buffer that is never bigger than one block.
+    hsize_t signal_offset = 0;
+
+    vector<dtype> staging;
+    vector<pair<int, unique_ptr<BaseSignal>>> pending;
+    hsize_t pending_offset = 0;
+    hsize_t pending_size = 0;
+
+    auto flush_pending = [&](){
+        if(pending_size > 0){
+            staging.resize(pending_size);
+            read_signal_data(
+                signals, read_plist, pending_offset, pending_size, staging.data());
+        }
 
-        assert(ndim == 1);
+        auto src = staging.begin();
+        for(auto& p : pending){
+            auto& storage = p.second->data();
+            copy(src, src + storage.size(), storage.begin());
+            src += storage.size();
 
-        auto signal_buffer = unique_ptr<dtype[]>(new dtype[shape[0]]);
+            data.signals.push_back(
+                {signal_keys_buffer[p.first], labels_list[p.first], move(p.second)});
+        }
 
-        err = H5Dread(
-            signals, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL,
-            read_plist, signal_buffer.get());
+        pending.clear();
+        pending_size = 0;
+    };
 
-        H5Dclose(signals);
+    for(int i = 0; i < n_signals; i++){
+        hsize_t size1 = signal_shapes_buffer[2*i];
+        hsize_t size2 = signal_shapes_buffer[2*i + 1];
+        hsize_t size = size1 * size2;
 
-        long long signal_offset = 0;
-        str_ptr = label_buffer.get();
+        if(signal_offset + size > shape[0]){
+            stringstream msg;
+            msg << "Signal data for component " << data.component
+                << " is shorter than its signal shapes require.";
+            throw runtime_error(msg.str());
+        }
 
-        // Read signals for component one at a time
-        // Name of the dataset containing a signal is equal to the signal key
-        for(int i = 0; i < n_signals; i++){
-            shape[0] = signal_shapes_buffer[2*i];
-            shape[1] = signal_shapes_buffer[2*i + 1];
+        auto signal = unique_ptr<BaseSignal>(new BaseSignal(size1, size2));
 
-            // Get the signal data
-            auto data = unique_ptr<BaseSignal>(new BaseSignal(shape[0], shape[1]));
+        if(size >= SIGNAL_READ_BLOCK){
+            flush_pending();
 
-            for(int j = 0; j < shape[0]; j++){
-                for(int k = 0; k < shape[1]; k++){
-                    (*data)(j, k) = signal_buffer[signal_offset + j * shape[1] + k];
-                }
+            dtype* dst = &(signal->data()[0]);
+            for(hsize_t done = 0; done < size; done += SIGNAL_READ_BLOCK){
+                read_signal_data(
+                    signals, read_plist, signal_offset + done,
+                    min(SIGNAL_READ_BLOCK, size - done), dst + done);
             }
 
-            signal_offset += shape[0] * shape[1];
+            data.signals.push_back({signal_keys_buffer[i], labels_list[i], move(signal)});
 
-            string label = string(str_ptr);
-            while(*str_ptr != '\0'){
-                str_ptr++;
+        }else{
+            if(pending_size + size > SIGNAL_READ_BLOCK){
+                flush_pending();
             }
 
-            if(i < n_signals-1){
-                str_ptr++;
+            if(pending.empty()){
+                pending_offset = signal_offset;
             }
 
-            add_base_signal(signal_keys_buffer[i], label, move(data));
+            pending.push_back({i, move(signal)});
+            pending_size += size;
         }
 
-        // Read operators for component
+        signal_offset += size;
+    }
 
-        // Open the dataset
-        hid_t operators = H5Dopen(component_group, "operators", H5P_DEFAULT);
+    flush_pending();
+    H5Dclose(signals);
 
-        // Get number of ops
-        int n_operators;
-        attr = H5Aopen(operators, "n_strings", H5P_DEFAULT);
-        H5Aread(attr, H5T_NATIVE_INT, &n_operators);
-        H5Aclose(attr);
+    // Read operators for component, from binary tables if present and
+    // from the string list. Both are parsed later, in build_ops.
+    if(H5Lexists(component_group, OP_TABLE_GROUP.c_str(), H5P_DEFAULT) > 0){
+        data.op_tables = read_op_tables(component_group, read_plist);
+    }
 
-        // Get its dimensions
-        dspace = H5Dget_space(operators);
-        ndim = H5Sget_simple_extent_dims(dspace, shape, NULL);
-        H5Sclose(dspace);
+    // Open the dataset
+    hid_t operators = H5Dopen(component_group, "operators", H5P_DEFAULT);
 
-        // Read the data set
-        auto op_buffer = unique_ptr<char>(new char[shape[0]]);
-        err = H5Dread(operators, str_type, H5S_ALL, H5S_ALL, read_plist, op_buffer.get());
-        H5Dclose(operators);
+    // Get number of ops
+    int n_operators;
+    attr = H5Aopen(operators, "n_strings", H5P_DEFAULT);
+    H5Aread(attr, H5T_NATIVE_INT, &n_operators);
+    H5Aclose(attr);
 
-        // Add the ops
-        str_ptr = op_buffer.get();
+    // Get its dimensions
+    dspace = H5Dget_space(operators);
+    ndim = H5Sget_simple_extent_dims(dspace, shape, NULL);
+    H5Sclose(dspace);
 
-        for(int op_idx=0; op_idx < n_operators; op_idx++){
-            string op_str = string(str_ptr);
+    // Read the data set
+    auto op_buffer = unique_ptr<char>(new char[shape[0]]);
+    err = H5Dread(operators, str_type, H5S_ALL, H5S_ALL, read_plist, op_buffer.get());
+    H5Dclose(operators);
 
-            add_op(OpSpec(op_str));
+    // Split the op strings
+    str_ptr = op_buffer.get();
 
-            while(*str_ptr != '\0'){
-                str_ptr++;
-            }
+    for(int op_idx=0; op_idx < n_operators; op_idx++){
+        data.op_strings.push_back(string(str_ptr));
 
-            if(op_idx < n_operators-1){
-                str_ptr++;
-            }
+        while(*str_ptr != '\0'){
+            str_ptr++;
         }
 
-        // Read probes for component
+        if(op_idx < n_operators-1){
+            str_ptr++;
+        }
+    }
 
-        // Open the dataset
-        hid_t probes = H5Dopen(component_group, "probes", H5P_DEFAULT);
+    // Read probes for component
 
-        // Get number of probes
-        int n_probes;
-        attr = H5Aopen(probes, "n_strings", H5P_DEFAULT);
-        H5Aread(attr, H5T_NATIVE_INT, &n_probes);
-        H5Aclose(attr);
+    // Open the dataset
+    hid_t probes = H5Dopen(component_group, "probes", H5P_DEFAULT);
 
-        // Get its dimensions
-        dspace = H5Dget_space(probes);
-        ndim = H5Sget_simple_extent_dims(dspace, shape, NULL);
-        H5Sclose(dspace);
+    // Get number of probes
+    int n_probes;
+    attr = H5Aopen(probes, "n_strings", H5P_DEFAULT);
+    H5Aread(attr, H5T_NATIVE_INT, &n_probes);
+    H5Aclose(attr);
 
-        // Read the data set
-        auto probe_buffer = unique_ptr<char>(new char[shape[0]]);
-        err = H5Dread(probes, str_type, H5S_ALL, H5S_ALL, read_plist, probe_buffer.get());
-        H5Dclose(probes);
+    // Get its dimensions
+    dspace = H5Dget_space(probes);
+    ndim = H5Sget_simple_extent_dims(dspace, shape, NULL);
+    H5Sclose(dspace);
 
-        // Add the probes
-        str_ptr = probe_buffer.get();
+    // Read the data set
+    auto probe_buffer = unique_ptr<char>(new char[shape[0]]);
+    err = H5Dread(probes, str_type, H5S_ALL, H5S_ALL, read_plist, probe_buffer.get());
+    H5Dclose(probes);
 
-        for(int probe_idx=0; probe_idx < n_probes; probe_idx++){
-            string probe_str = string(str_ptr);
-            add_probe(ProbeSpec(probe_str));
+    // Split the probe strings
+    str_ptr = probe_buffer.get();
+
+    for(int probe_idx=0; probe_idx < n_probes; probe_idx++){
+        data.probe_strings.push_back(string(str_ptr));
+
+        while(*str_ptr != '\0'){
+            str_ptr++;
+        }
+
+        if(probe_idx < n_probes-1){
+            str_ptr++;
+        }
+    }
+
+    H5Gclose(component_group);
+    H5Tclose(str_type);
+}
+
+// Operators that change the state of the chunk as they are built, and so
+// can't be built ahead of time by build_ops.
+static bool build_in_order(const string& type_string){
+    return type_string == "MpiSend" || type_string == "MpiRecv" ||
+           type_string == "SpaunStimulus";
+}
 
-            while(*str_ptr != '\0'){
-                str_ptr++;
+void MpiSimulatorChunk::build_ops(vector<ComponentData>& components){
+    // One entry per operator, from the tables and then the strings of each
+    // component. Order of addition doesn't otherwise matter, since ops are
+    // sorted by index in finalize_build.
+    struct PendingOp{
+        const OpTable* table;
+        size_t row;
+        const string* op_string;
+
+        OpSpec op_spec;
+        unique_ptr<Operator> op;
+    };
+
+    vector<PendingOp> pending;
+
+    for(ComponentData& data : components){
+        for(auto& table : data.op_tables){
+            for(size_t row = 0; row < table->n_rows(); row++){
+                pending.push_back({table.get(), row, NULL, OpSpec(), nullptr});
             }
+        }
+
+        for(const string& op_string : data.op_strings){
+            pending.push_back({NULL, 0, &op_string, OpSpec(), nullptr});
+        }
+    }
+
+    // Operators are built ahead of time unless an image is being saved,
+    // since the image writer has to see the operators in order.
+    bool build_ahead = !image_writer;
 
-            if(probe_idx < n_probes-1){
-                str_ptr++;
+    unsigned n_threads = min<size_t>(
+        components.size(), max(1u, thread::hardware_concurrency()));
+
+    parallel_for(pending.size(), n_threads, [&](size_t i){
+        PendingOp& p = pending[i];
+
+        if(p.op_string){
+            p.op_spec = OpSpec(*p.op_string);
+
+            if(build_ahead && !build_in_order(p.op_spec.type_string)){
+                p.op = make_op(p.op_spec.type_string, StringOpArgs(p.op_spec.arguments));
             }
+
+        }else if(build_ahead && !build_in_order(p.table->type_string)){
+            p.op = make_op(p.table->type_string, p.table->row(p.row));
         }
+    });
+
+    for(PendingOp& p : pending){
+        float index = p.op_string ? p.op_spec.index : p.table->row(p.row).index();
+
+        if(p.op){
+            if(p.op_string){
+                record_outputs(p.op_spec.type_string, StringOpArgs(p.op_spec.arguments));
+            }else{
+                record_outputs(p.table->type_string, p.table->row(p.row));
+            }
+
+            add_op(move(p.op));
+            operator_list.back()->set_index(index);
 
-        H5Gclose(component_group);
+        }else if(p.op_string){
+            add_op(p.op_spec.type_string, StringOpArgs(p.op_spec.arguments), index);
 
-        component += n_processors;
+        }else{
+            add_op(p.table->type_string, p.table->row(p.row), index);
+        }
+    }
+}
+
+void MpiSimulatorChunk::from_image(string filename){
+    network_image = unique_ptr<NetworkImage>(new NetworkImage(filename));
+    NetworkImage& image = *network_image;
+    const NetworkImageHeader& header = image.header();
+
+    if(int(header.rank) != rank || int(header.n_processors) != n_processors){
+        stringstream msg;
+        msg << "Network image " << filename << " was saved by process " << header.rank
+            << " of " << header.n_processors << ", but is being loaded by process "
+            << rank << " of " << n_processors << ".";
+        throw runtime_error(msg.str());
     }
 
+    if(rank == 0){
+        cout << "Loading nengo network from image." << endl;
+    }
+
+    dt = header.dt;
+
+    // Signals are placed in the mapping rather than copied out of it, so
+    // read-only signals are shared with the page cache (and between
+    // processes loading the same image), and a signal's pages are only
+    // copied when an operator first writes to it.
+    const NetworkImageSignal* signals = image.signals();
+    for(uint64_t i = 0; i < header.n_signals; i++){
+        auto data = unique_ptr<BaseSignal>(
+            new BaseSignal(signals[i].shape1, signals[i].shape2));
+
+        place_signal(*data, image.signal_storage(signals[i]));
+
+        add_base_signal(
+            signals[i].key, string(image.strings() + signals[i].label), move(data));
+    }
+
+    const NetworkImageOp* ops = image.ops();
+    for(uint64_t i = 0; i < header.n_ops; i++){
+        ImageOpArgs args(image, ops[i]);
+        add_op(string(image.strings() + ops[i].type), args, ops[i].index);
+    }
+
+    for(uint64_t i = 0; i < header.n_probes; i++){
+        add_probe(ProbeSpec(string(image.strings() + image.probes()[i])));
+    }
+
+    probe_info.clear();
+    for(uint64_t i = 0; i < header.n_probe_info; i++){
+        probe_info.push_back(ProbeSpec(string(image.strings() + image.probe_info()[i])));
+    }
+}
+
+void MpiSimulatorChunk::share_network_metadata(int& n_components, MPI_Comm comm){
+    if(comm != MPI_COMM_NULL && n_processors > 1){
+        MPI_Bcast(&n_components, 1, MPI_INT, 0, comm);
+        MPI_Bcast(&dt, 1, MPI_DOUBLE, 0, comm);
+
+        string encoded;
+        if(rank == 0){
+            encoded = encode_probe_info(probe_info);
+        }
+
+        int n_chars = encoded.size();
+        MPI_Bcast(&n_chars, 1, MPI_INT, 0, comm);
+
+        encoded.resize(n_chars);
+        MPI_Bcast(&encoded[0], n_chars, MPI_CHAR, 0, comm);
+
+        if(rank != 0){
+            bool keep_all = n_io_servers == 0 && !log_per_rank;
+
+            probe_info.clear();
+            for(const ProbeSpec& ps : decode_probe_info(encoded)){
+                if(keep_all || ps.component % n_processors == rank){
+                    probe_info.push_back(ps);
+                }
+            }
+        }
+    }
+}
+
+vector<ProbeSpec> read_probe_info(hid_t f, hid_t read_plist){
+    hsize_t shape[2];
+    hid_t dspace, attr;
+    char* str_ptr;
+
+    hid_t str_type = H5Tcopy(H5T_C_S1);
+    H5Tset_strpad(str_type, H5T_STR_NULLPAD);
+
+    vector<ProbeSpec> probe_info;
+
     // Read probe info
 
     // Open the dataset
@@ -244,12 +644,12 @@ void MpiSimulatorChunk::from_file(string filename, hid_t file_plist, hid_t read_
 
     // Get its dimensions
     dspace = H5Dget_space(probe_info_dset);
-    ndim = H5Sget_simple_extent_dims(dspace, shape, NULL);
+    H5Sget_simple_extent_dims(dspace, shape, NULL);
     H5Sclose(dspace);
 
     // Read the data set
     auto probe_buffer = unique_ptr<char>(new char[shape[0]]);
-    err = H5Dread(probe_info_dset, str_type, H5S_ALL, H5S_ALL, read_plist, probe_buffer.get());
+    H5Dread(probe_info_dset, str_type, H5S_ALL, H5S_ALL, read_plist, probe_buffer.get());
     H5Dclose(probe_info_dset);
 
     str_ptr = probe_buffer.get();
@@ -267,7 +667,9 @@ void MpiSimulatorChunk::from_file(string filename, hid_t file_plist, hid_t read_
         }
     }
 
-    H5Fclose(f);
+    H5Tclose(str_type);
+
+    return probe_info;
 }
 
 void MpiSimulatorChunk::finalize_build(){
@@ -275,13 +677,31 @@ void MpiSimulatorChunk::finalize_build(){
 }
 
 void MpiSimulatorChunk::finalize_build(MPI_Comm comm){
-    if(n_processors != 1){
+    sim_comm = comm;
+
+    if(n_io_servers > 0){
+        int server = n_processors + io_server_index(rank, n_processors, n_io_servers);
+        sim_log = unique_ptr<SimulationLog>(
+            new IOClientSimulationLog(n_processors, rank, probe_info, dt, comm, io_comm, server));
+    }else if(n_processors != 1 && log_per_rank){
+        sim_log = unique_ptr<SimulationLog>(
+            new RankSimulationLog(n_processors, rank, probe_info, dt, comm));
+    }else if(n_processors != 1){
         sim_log = unique_ptr<SimulationLog>(
             new ParallelSimulationLog(n_processors, rank, probe_info, dt, comm));
     }else{
         sim_log = unique_ptr<SimulationLog>(new SimulationLog(probe_info, dt));
     }
 
+    if(probe_stream_name.length() > 0 && probe_map.size() > 0){
+        try{
+            probe_stream = unique_ptr<ProbeStream>(new ProbeStream(probe_stream_name, rank));
+        }catch(runtime_error& e){
+            cout << "Warning: " << e.what() << ". Probe streaming disabled on rank "
+                 << rank << "." << endl;
+        }
+    }
+
     if(mpi_merged){
         for(auto& kv : merged_sends){
 
@@ -347,6 +767,49 @@ void MpiSimulatorChunk::finalize_build(MPI_Comm comm){
 
     // Very important; ensures ops are executed in correct order
     operator_list.sort(compare_op_ptr);
+
+    // All operators are known now, so keep initial values for reset only for
+    // the signals they write to. Read-only signals (e.g. most weights) are
+    // stored once.
+    signal_init_value.clear();
+    for(key_type key : mutable_signals){
+        signal_init_value[key] = shared_ptr<BaseSignal>(new BaseSignal(*signal_map.at(key)));
+    }
+
+    if(fold_signals_enabled){
+        fold_signals();
+    }
+
+    // Processes on the same node often hold identical read-only signals
+    // (e.g. weights replicated across an ensemble array); store those once.
+    // Folded signals already share storage within the process, so they are
+    // left out; otherwise their bytes would be counted as saved twice.
+    if(n_processors > 1 && comm != MPI_COMM_NULL){
+        map<key_type, shared_ptr<BaseSignal>> read_only;
+
+        for(auto& kv : signal_map){
+            if(!mutable_signals.count(kv.first) && !sent_signals.count(kv.first) &&
+                    !folded_signals.count(kv.first)){
+                read_only.insert(kv);
+            }
+        }
+
+        node_shared_signals = unique_ptr<NodeSharedSignals>(
+            new NodeSharedSignals(read_only, comm));
+
+        const NodeSharedSignals& nss = *node_shared_signals;
+        if(nss.node_size() > 1 && nss.node_rank() == 0){
+            int buflen = MPI_MAX_PROCESSOR_NAME;
+            char name[MPI_MAX_PROCESSOR_NAME];
+            MPI_Get_processor_name(name, &buflen);
+
+            cout << "Node " << name << " (" << nss.node_size() << " processes): "
+                 << "sharing read-only signals saved " << nss.bytes_saved()
+                 << " bytes." << endl;
+        }
+    }
+
+    load_ns = elapsed_ns(load_begin, timing_clock::now());
 }
 
 void MpiSimulatorChunk::run_n_steps(int steps, bool progress){
@@ -372,24 +835,87 @@ void MpiSimulatorChunk::run_n_steps(int steps, bool progress){
         (kv.second)->init_for_simulation(steps, flush_every);
     }
 
+    if(memory_report_enabled){
+        report_memory(memory_usage(), n_processors > 1 ? sim_comm : MPI_COMM_NULL);
+    }
+
     ez::ezETAProgressBar eta(steps);
 
     if(progress){
         eta.start();
     }
 
-    map<string, double> per_class_average_timings;
-    double per_op_timings[operator_list.size()];
-    fill_n(per_op_timings, operator_list.size(), 0.0);
+    SimulationTimings timings(collect_timings ? operator_list.size() : 0, timing_period);
+    timings.load.add(load_ns);
+
+    // Runs with several processes always record the compute time of each
+    // step, so that the master can report how unbalanced they were. This
+    // needs the time spent waiting on MPI.
+    bool record_load = n_processors > 1;
+
+    run_load = RunLoad();
+
+    if(record_load){
+        run_load.compute_ns.reserve(steps);
+        run_load.n_mpi_operators = mpi_sends.size() + mpi_recvs.size();
+        run_load.n_operators = operator_list.size() - run_load.n_mpi_operators;
+    }
+
+    for(auto& send: mpi_sends){
+        send->reset_comm_stats(collect_timings || record_load);
+    }
+
+    for(auto& recv : mpi_recvs){
+        recv->reset_comm_stats(collect_timings || record_load);
+    }
+
+    uint64_t waited = 0;
+
+    unique_ptr<PerfCounters> counters;
+
+    if(collect_timings && perf_counters_enabled){
+        counters = unique_ptr<PerfCounters>(new PerfCounters());
+
+        if(counters->is_available()){
+            timings.operator_counts.resize(operator_list.size(), PerfCounts());
+            for(int c = 0; c < N_PERF_COUNTERS; c++){
+                timings.counted[c] = counters->counts(PerfCounter(c));
+            }
+
+            counters->start();
+        }else{
+            if(rank == 0){
+                cout << "Hardware counters unavailable (" << counters->error()
+                     << "); collecting timings without them." << endl;
+            }
+
+            counters.reset();
+        }
+    }
+
+    run_prefix = timings_prefix(sim_log->get_filename(), n_runs);
+    n_runs++;
+
+    unique_ptr<Trace> trace;
+    vector<unsigned> op_trace_names;
 
-    vector<double> step_times;
+    if(trace_enabled){
+        trace = unique_ptr<Trace>(new Trace(run_prefix + "_trace.json", rank, sim_comm));
+
+        for(auto& op: operator_list){
+            op_trace_names.push_back(trace->name_id(op->classname(), "operators"));
+        }
+
+        set_active_trace(trace.get());
+    }
 
     for(unsigned step = 0; step < steps; ++step){
-        clock_t begin = clock();
+        auto begin = timing_clock::now();
 
         if(step % FLUSH_PROBES_EVERY == 0 && step != 0){
             dbg("Rank " << rank << " beginning step: " << step << ", flushing probes." << endl);
             flush_probes();
+            timings.flushes.add(elapsed_ns(begin, timing_clock::now()));
         }
 
         if(!progress && rank == 0 && step % 100 == 0){
@@ -402,18 +928,52 @@ void MpiSimulatorChunk::run_n_steps(int steps, bool progress){
         n_steps++;
         time = n_steps * dt;
 
-        if(collect_timings){
-            int op_index = 0;
-            for(auto& op: operator_list){
-                clock_t op_begin = clock();
+        bool time_operators = collect_timings && timings.times_operators(step);
+        bool count_operators = time_operators && counters;
+
+        if(time_operators || trace){
+            size_t op_index = 0;
+            PerfCounts counts_before, counts_after;
+
+            if(count_operators){
+                counters->read(counts_before);
+            }
+
+            auto op_begin = timing_clock::now();
+            auto group_begin = op_begin;
 
+            for(auto& op: operator_list){
                 //Call the operator
                 (*op)();
 
-                clock_t op_end = clock();
+                if(time_operators){
+                    auto op_end = timing_clock::now();
+                    timings.operators[op_index].add(elapsed_ns(op_begin, op_end));
+
+                    if(count_operators){
+                        counters->read(counts_after);
+
+                        PerfCounts& op_counts = timings.operator_counts[op_index];
+                        for(int c = 0; c < N_PERF_COUNTERS; c++){
+                            op_counts[c] += counts_after[c] - counts_before[c];
+                        }
+
+                        counts_before = counts_after;
+
+                        // Leave the cost of reading the counters out of
+                        // the next operator's time.
+                        op_end = timing_clock::now();
+                    }
+
+                    op_begin = op_end;
+                }
 
-                if(collect_timings){
-                    per_op_timings[op_index] += double(op_end - op_begin) / CLOCKS_PER_SEC;
+                // One trace event for each run of operators of the same class.
+                if(trace && (op_index + 1 == op_trace_names.size() ||
+                             op_trace_names[op_index + 1] != op_trace_names[op_index])){
+                    auto group_end = timing_clock::now();
+                    trace->record(op_trace_names[op_index], group_begin, group_end);
+                    group_begin = group_end;
                 }
 
                 op_index++;
@@ -434,11 +994,35 @@ void MpiSimulatorChunk::run_n_steps(int steps, bool progress){
             ++eta;
         }
 
-        clock_t end = clock();
-        step_times.push_back(double(end - begin) / CLOCKS_PER_SEC);
+        auto end = timing_clock::now();
+        uint64_t step_ns = elapsed_ns(begin, end);
+        timings.steps.add(step_ns);
+
+        if(record_load){
+            uint64_t step_wait = min(mpi_wait_ns() - waited, step_ns);
+            waited += step_wait;
+
+            run_load.compute_ns.push_back(step_ns - step_wait);
+            run_load.wait_ns += step_wait;
+            run_load.step_ns += step_ns;
+        }
+
+        if(trace){
+            trace->record(TRACE_STEP, begin, end);
+        }
+    }
+
+    if(counters){
+        counters->stop();
     }
 
+    auto flush_begin = timing_clock::now();
     flush_probes();
+    timings.flushes.add(elapsed_ns(flush_begin, timing_clock::now()));
+
+    if(sim_log->is_ready()){
+        sim_log->end_simulation();
+    }
 
     for(auto& send: mpi_sends){
         send->complete();
@@ -450,79 +1034,25 @@ void MpiSimulatorChunk::run_n_steps(int steps, bool progress){
 
     clsdbgfile();
 
-    if(collect_timings){
-        // Handle timing data
-        double sum = std::accumulate(step_times.begin(), step_times.end(), 0.0);
-        double mean = sum / step_times.size();
-
-        vector<double> diff(step_times.size());
-        transform(step_times.begin(), step_times.end(), diff.begin(),
-                       bind2nd(minus<double>(), mean));
-        double sq_sum = inner_product(diff.begin(), diff.end(), diff.begin(), 0.0);
-        double stdev = sqrt(sq_sum / step_times.size());
-
-        map<string, double> class_average;
-        map<string, double> class_count;
-        map<string, double> class_slowest;
-        map<string, Operator*> class_slowest_op;
-        map<string, double> class_cumulative;
-
-        int op_index = 0;
-        for(auto& op: operator_list){
-            string class_name = op->classname();
-
-            class_count[class_name] += 1;
-
-            if(class_slowest[class_name] < per_op_timings[op_index]){
-                class_slowest[class_name] = per_op_timings[op_index];
-                class_slowest_op[class_name] = op;
-            }
-
-            class_cumulative[class_name] += per_op_timings[op_index];
+    if(trace){
+        set_active_trace(NULL);
+        trace->write();
+    }
 
-            op_index++;
+    if(collect_timings){
+        for(auto& send: mpi_sends){
+            send->add_comm_stats(timings.peers);
         }
 
-        stringstream runtimes_ss;
-        string delim = ",";
-
-        runtimes_ss << endl << "Rank " << rank << " runtimes." << endl;
-        runtimes_ss << "Mean seconds-per-step: " << mean << ", stdev: " << stdev << endl;
-
-        for(auto& p : class_cumulative){
-            string class_name = p.first;
-            double value = p.second / class_count[class_name] / double(n_steps);
-            runtimes_ss << class_name << "_average" << delim << value << endl;
-
-            value = p.second / double(n_steps);
-            runtimes_ss << class_name << "_cumulative" << delim << value << endl;
-
-            value = class_slowest[class_name] / double(n_steps);
-            runtimes_ss << class_name << "_slowest" << delim << value << endl;
-            runtimes_ss << class_name << "_slowest_op" << delim << endl << *class_slowest_op[class_name] << endl;
+        for(auto& recv : mpi_recvs){
+            recv->add_comm_stats(timings.peers);
         }
 
-        vector<pair<double, Operator*>> op_runtimes;
+        timings.write(run_prefix, rank, operator_list);
 
-        op_index = 0;
-        for(auto op: operator_list){
-            op_runtimes.push_back({per_op_timings[op_index], op});
-            op_index++;
+        if(n_processors > 1 && sim_comm != MPI_COMM_NULL){
+            write_comm_matrix(run_prefix, timings.peers, sim_comm);
         }
-
-        int n_show = 10;
-        partial_sort(
-            op_runtimes.begin(), op_runtimes.begin()+n_show,
-            op_runtimes.end(), compare_first_gt<double, Operator*>);
-
-        runtimes_ss << n_show << " slowest operators: " << endl;
-        for(int i = 0; i < n_show; i++){
-            runtimes_ss << "OPERATOR " << i << endl;
-            runtimes_ss << "Seconds per step: " << op_runtimes[i].first / double(n_steps) << endl;
-            runtimes_ss << *(op_runtimes[i].second) << endl;
-        }
-
-        sim_log->write_file("_runtimes", rank, MAX_RUNTIME_OUTPUT_SIZE, runtimes_ss.str());
     }
 }
 
@@ -534,17 +1064,12 @@ void MpiSimulatorChunk::reset(unsigned seed){
         op->reset(seed + op->get_seed_modifier());
     }
 
-    // TODO: store whether signals are read-only, only reset if they are not.
-    for(auto& kv: signal_map){
-        key_type key = kv.first;
-        shared_ptr<BaseSignal> sig = signal_map.at(key);
-        shared_ptr<BaseSignal> init_value = signal_init_value.at(key);
+    // Base signals are dense and row-major, so each is one contiguous copy.
+    for(auto& kv: signal_init_value){
+        const auto& init_data = kv.second->data();
+        auto& data = signal_map.at(kv.first)->data();
 
-        for(int i = 0; i < sig->size1(); i++){
-            for(int j = 0; j < sig->size2(); j++){
-                (*sig)(i, j) = (*init_value)(i, j);
-            }
-        }
+        copy(init_data.begin(), init_data.end(), data.begin());
     }
 }
 
@@ -560,12 +1085,10 @@ void MpiSimulatorChunk::add_base_signal(
         identical &= existing_data->size1() == data->size1();
         identical &= existing_data->size2() == data->size2();
 
+        // Both are dense, so compare the storage directly.
         if(identical){
-            for(int i = 0; i < data->size1(); i++){
-                for(int j = 0; j < data->size2(); j++){
-                    identical &= (*data)(i, j) == (*existing_data)(i, j);
-                }
-            }
+            identical = equal(
+                data->data().begin(), data->data().end(), existing_data->data().begin());
         }
 
         if(!identical){
@@ -577,7 +1100,6 @@ void MpiSimulatorChunk::add_base_signal(
         }
     }else{
         signal_labels[key] = l;
-        signal_init_value[key] = shared_ptr<BaseSignal>(new BaseSignal(*data));
         signal_map[key] = shared_ptr<BaseSignal>(move(data));
     }
 }
@@ -607,7 +1129,18 @@ SignalView MpiSimulatorChunk::get_signal_view(SignalSpec ss){
 }
 
 SignalView MpiSimulatorChunk::get_signal_view(string ss){
-    return get_signal_view(SignalSpec(ss));
+    SignalSpec spec(ss);
+
+    if(folded_signals.count(spec.key)){
+        stringstream msg;
+        msg << "Signal with key " << spec.key << " shares its storage with other "
+            << "signals, so it cannot be handed out for writing.";
+        throw logic_error(msg.str());
+    }
+
+    mutable_signals.insert(spec.key);
+
+    return get_signal_view(spec);
 }
 
 SignalView MpiSimulatorChunk::get_signal_view(key_type key){
@@ -623,311 +1156,406 @@ void MpiSimulatorChunk::add_op(unique_ptr<Operator> op){
 }
 
 void MpiSimulatorChunk::add_op(OpSpec op_spec){
-    string type_string = op_spec.type_string;
-    vector<string>& args = op_spec.arguments;
-    float index = op_spec.index;
+    add_op(op_spec.type_string, StringOpArgs(op_spec.arguments), op_spec.index);
+}
+
+void MpiSimulatorChunk::add_op(string type_string, const OpArgs& args, float index){
+    if(image_writer){
+        RecordingOpArgs recording_args(args, *image_writer);
+        build_op(type_string, recording_args, index);
+        image_writer->add_op(type_string, index, recording_args.recorded);
+    }else{
+        build_op(type_string, args, index);
+    }
+
+    record_outputs(type_string, args);
+}
+
+// Positions of the signal arguments each type of operator writes to.
+static const map<string, vector<int>> OP_OUTPUT_ARGS = {
+    {"Reset", {0}},
+    {"Copy", {0}},
+    {"SlicedCopy", {0}},
+    {"DotInc", {2}},
+    {"ElementwiseInc", {2}},
+    {"LIF", {6, 7, 8}},
+    {"LIFRate", {4}},
+    {"AdaptiveLIF", {8, 9, 10, 11}},
+    {"AdaptiveLIFRate", {7, 8}},
+    {"RectifiedLinear", {2}},
+    {"Sigmoid", {3}},
+    {"Izhikevich", {7, 8, 9}},
+    {"NoDenSynapse", {1}},
+    {"SimpleSynapse", {1}},
+    {"Synapse", {1}},
+    {"TriangleSynapse", {1}},
+    {"WhiteNoise", {0}},
+    {"WhiteSignal", {0}},
+    {"BCM", {3}},
+    {"Oja", {3}},
+    {"Voja", {3}},
+    {"SpaunStimulus", {0}},
+    {"MpiSend", {}},
+    {"MpiRecv", {}}
+};
+
+void MpiSimulatorChunk::record_outputs(string type_string, const OpArgs& args){
+    // MpiRecv refers to the signal it writes by key.
+    if(type_string == "MpiRecv"){
+        mutable_signals.insert(args.key(2));
+        return;
+    }
+
+    auto outputs = OP_OUTPUT_ARGS.find(type_string);
+
+    if(outputs == OP_OUTPUT_ARGS.end()){
+        stringstream msg;
+        msg << "The outputs of operators of type " << type_string << " are not known.";
+        throw logic_error(msg.str());
+    }
+
+    for(int i : outputs->second){
+        mutable_signals.insert(args.signal(i).key);
+    }
+}
+
+static string op_args_error(
+        string type_string, const OpArgs& args, const boost::bad_lexical_cast& e){
+
+    stringstream msg;
+    msg << "Caught bad lexical cast while extracting operator "
+           "with error " << e.what() << endl;
+    msg << "The operator type was: " << type_string << endl;
+    msg << "The arguments were: " << endl;
+    msg << args;
+
+    return msg.str();
+}
+
+void MpiSimulatorChunk::build_op(string type_string, const OpArgs& args, float index){
+    // MPI ops are not added to operator_list here (and may be skipped
+    // entirely), so only index the op if one was actually added.
+    size_t n_ops = operator_list.size();
+
+    try{
+        if(type_string.compare("MpiSend") == 0){
+
+            if(n_processors > 1){
+                int dst = args.integer(0);
+                dst = dst % n_processors;
+                if(dst != rank){
+
+                    int tag = args.integer(1);
+                    key_type signal_key = args.key(2);
+                    SignalView content = get_signal_view(signal_key);
+
+                    sent_signals.insert(signal_key);
+                    add_mpi_send(index, dst, tag, content);
+                }
+            }
+
+        }else if(type_string.compare("MpiRecv") == 0){
+
+            if(n_processors > 1){
+                int src = args.integer(0);
+                src = src % n_processors;
+
+                if(src != rank){
+                    int tag = args.integer(1);
+                    key_type signal_key = args.key(2);
+                    SignalView content = get_signal_view(signal_key);
+
+                    add_mpi_recv(index, src, tag, content);
+                }
+            }
+
+        }else{
+            add_op(make_op(type_string, args));
+        }
+
+        if(operator_list.size() > n_ops){
+            operator_list.back()->set_index(index);
+        }
+
+    }catch(const boost::bad_lexical_cast& e){
+        throw runtime_error(op_args_error(type_string, args, e));
+    }
+}
+
+unique_ptr<Operator> MpiSimulatorChunk::make_op(string type_string, const OpArgs& args){
+    unique_ptr<Operator> op;
 
     try{
         if(type_string.compare("Reset") == 0){
-            SignalView dst = get_signal_view(args[0]);
-            dtype value = boost::lexical_cast<dtype>(args[1]);
+            SignalView dst = get_signal_view(args.signal(0));
+            dtype value = args.real(1);
 
-            add_op(unique_ptr<Operator>(new Reset(dst, value)));
+            op = unique_ptr<Operator>(new Reset(dst, value));
 
         }else if(type_string.compare("Copy") == 0){
 
-            SignalView dst = get_signal_view(args[0]);
-            SignalView src = get_signal_view(args[1]);
+            SignalView dst = get_signal_view(args.signal(0));
+            SignalView src = get_signal_view(args.signal(1));
 
-            add_op(unique_ptr<Operator>(new Copy(dst, src)));
+            op = unique_ptr<Operator>(new Copy(dst, src));
 
         }else if(type_string.compare("SlicedCopy") == 0){
 
-            SignalView dst = get_signal_view(args[0]);
-            SignalView src = get_signal_view(args[1]);
+            SignalView dst = get_signal_view(args.signal(0));
+            SignalView src = get_signal_view(args.signal(1));
 
-            bool inc = bool(boost::lexical_cast<int>(args[2]));
+            bool inc = bool(args.integer(2));
 
-            int start_A = boost::lexical_cast<int>(args[3]);
-            int stop_A = boost::lexical_cast<int>(args[4]);
-            int step_A = boost::lexical_cast<int>(args[5]);
+            int start_A = args.integer(3);
+            int stop_A = args.integer(4);
+            int step_A = args.integer(5);
 
-            int start_B = boost::lexical_cast<int>(args[6]);
-            int stop_B = boost::lexical_cast<int>(args[7]);
-            int step_B = boost::lexical_cast<int>(args[8]);
+            int start_B = args.integer(6);
+            int stop_B = args.integer(7);
+            int step_B = args.integer(8);
 
-            vector<int> seq_A = python_list_to_index_vector(args[9]);
-            vector<int> seq_B = python_list_to_index_vector(args[10]);
+            vector<int> seq_A = args.index_vector(9);
+            vector<int> seq_B = args.index_vector(10);
 
-            add_op(unique_ptr<Operator>(
+            op = unique_ptr<Operator>(
                 new SlicedCopy(
                     dst, src, inc, start_A, stop_A, step_A,
-                    start_B, stop_B, step_B, seq_A, seq_B)));
+                    start_B, stop_B, step_B, seq_A, seq_B));
 
         }else if(type_string.compare("DotInc") == 0){
-            SignalView A = get_signal_view(args[0]);
-            SignalView X = get_signal_view(args[1]);
-            SignalView Y = get_signal_view(args[2]);
+            SignalView A = get_signal_view(args.signal(0));
+            SignalView X = get_signal_view(args.signal(1));
+            SignalView Y = get_signal_view(args.signal(2));
 
-            add_op(unique_ptr<Operator>(new DotInc(A, X, Y)));
+            op = unique_ptr<Operator>(new DotInc(A, X, Y));
 
         }else if(type_string.compare("ElementwiseInc") == 0){
-            SignalView A = get_signal_view(args[0]);
-            SignalView X = get_signal_view(args[1]);
-            SignalView Y = get_signal_view(args[2]);
+            SignalView A = get_signal_view(args.signal(0));
+            SignalView X = get_signal_view(args.signal(1));
+            SignalView Y = get_signal_view(args.signal(2));
 
-            add_op(unique_ptr<Operator>(new ElementwiseInc(A, X, Y)));
+            op = unique_ptr<Operator>(new ElementwiseInc(A, X, Y));
 
         }else if(type_string.compare("LIF") == 0){
-            int n_neurons = boost::lexical_cast<int>(args[0]);
-            dtype tau_rc = boost::lexical_cast<dtype>(args[1]);
-            dtype tau_ref = boost::lexical_cast<dtype>(args[2]);
-            dtype min_voltage = boost::lexical_cast<dtype>(args[3]);
-            dtype dt = boost::lexical_cast<dtype>(args[4]);
-
-            SignalView J = get_signal_view(args[5]);
-            SignalView output = get_signal_view(args[6]);
-            SignalView voltage = get_signal_view(args[7]);
-            SignalView ref_time = get_signal_view(args[8]);
-
-            add_op(unique_ptr<Operator>(
+            int n_neurons = args.integer(0);
+            dtype tau_rc = args.real(1);
+            dtype tau_ref = args.real(2);
+            dtype min_voltage = args.real(3);
+            dtype dt = args.real(4);
+
+            SignalView J = get_signal_view(args.signal(5));
+            SignalView output = get_signal_view(args.signal(6));
+            SignalView voltage = get_signal_view(args.signal(7));
+            SignalView ref_time = get_signal_view(args.signal(8));
+
+            op = unique_ptr<Operator>(
                 new LIF(
                     n_neurons, tau_rc, tau_ref, min_voltage,
-                    dt, J, output, voltage, ref_time)));
+                    dt, J, output, voltage, ref_time));
 
         }else if(type_string.compare("LIFRate") == 0){
-            int n_neurons = boost::lexical_cast<int>(args[0]);
-            dtype tau_rc = boost::lexical_cast<dtype>(args[1]);
-            dtype tau_ref = boost::lexical_cast<dtype>(args[2]);
+            int n_neurons = args.integer(0);
+            dtype tau_rc = args.real(1);
+            dtype tau_ref = args.real(2);
 
-            SignalView J = get_signal_view(args[3]);
-            SignalView output = get_signal_view(args[4]);
+            SignalView J = get_signal_view(args.signal(3));
+            SignalView output = get_signal_view(args.signal(4));
 
-            add_op(unique_ptr<Operator>(
-                new LIFRate(n_neurons, tau_rc, tau_ref, J, output)));
+            op = unique_ptr<Operator>(
+                new LIFRate(n_neurons, tau_rc, tau_ref, J, output));
 
         }else if(type_string.compare("AdaptiveLIF") == 0){
-            int n_neurons = boost::lexical_cast<int>(args[0]);
+            int n_neurons = args.integer(0);
 
-            dtype tau_n = boost::lexical_cast<dtype>(args[1]);
-            dtype inc_n = boost::lexical_cast<dtype>(args[2]);
+            dtype tau_n = args.real(1);
+            dtype inc_n = args.real(2);
 
-            dtype tau_rc = boost::lexical_cast<dtype>(args[3]);
-            dtype tau_ref = boost::lexical_cast<dtype>(args[4]);
-            dtype min_voltage = boost::lexical_cast<dtype>(args[5]);
-            dtype dt = boost::lexical_cast<dtype>(args[6]);
+            dtype tau_rc = args.real(3);
+            dtype tau_ref = args.real(4);
+            dtype min_voltage = args.real(5);
+            dtype dt = args.real(6);
 
-            SignalView J = get_signal_view(args[7]);
-            SignalView output = get_signal_view(args[8]);
-            SignalView voltage = get_signal_view(args[9]);
-            SignalView ref_time = get_signal_view(args[10]);
-            SignalView adaptation = get_signal_view(args[11]);
+            SignalView J = get_signal_view(args.signal(7));
+            SignalView output = get_signal_view(args.signal(8));
+            SignalView voltage = get_signal_view(args.signal(9));
+            SignalView ref_time = get_signal_view(args.signal(10));
+            SignalView adaptation = get_signal_view(args.signal(11));
 
-            add_op(unique_ptr<Operator>(
+            op = unique_ptr<Operator>(
                 new AdaptiveLIF(
                     n_neurons, tau_n, inc_n, tau_rc, tau_ref,
                     min_voltage, dt, J, output, voltage, ref_time,
-                    adaptation)));
+                    adaptation));
 
         }else if(type_string.compare("AdaptiveLIFRate") == 0){
-            int n_neurons = boost::lexical_cast<int>(args[0]);
+            int n_neurons = args.integer(0);
 
-            dtype tau_n = boost::lexical_cast<dtype>(args[1]);
-            dtype inc_n = boost::lexical_cast<dtype>(args[2]);
+            dtype tau_n = args.real(1);
+            dtype inc_n = args.real(2);
 
-            dtype tau_rc = boost::lexical_cast<dtype>(args[3]);
-            dtype tau_ref = boost::lexical_cast<dtype>(args[4]);
+            dtype tau_rc = args.real(3);
+            dtype tau_ref = args.real(4);
 
-            dtype dt = boost::lexical_cast<dtype>(args[5]);
+            dtype dt = args.real(5);
 
-            SignalView J = get_signal_view(args[6]);
-            SignalView output = get_signal_view(args[7]);
-            SignalView adaptation = get_signal_view(args[8]);
+            SignalView J = get_signal_view(args.signal(6));
+            SignalView output = get_signal_view(args.signal(7));
+            SignalView adaptation = get_signal_view(args.signal(8));
 
-            add_op(unique_ptr<Operator>(
+            op = unique_ptr<Operator>(
                 new AdaptiveLIFRate(
                     n_neurons, tau_n, inc_n, tau_rc, tau_ref,
-                    dt, J, output, adaptation)));
+                    dt, J, output, adaptation));
 
         }else if(type_string.compare("RectifiedLinear") == 0){
-            int n_neurons = boost::lexical_cast<int>(args[0]);
+            int n_neurons = args.integer(0);
 
-            SignalView J = get_signal_view(args[1]);
-            SignalView output = get_signal_view(args[2]);
+            SignalView J = get_signal_view(args.signal(1));
+            SignalView output = get_signal_view(args.signal(2));
 
-            add_op(unique_ptr<Operator>(new RectifiedLinear(n_neurons, J, output)));
+            op = unique_ptr<Operator>(new RectifiedLinear(n_neurons, J, output));
 
         }else if(type_string.compare("Sigmoid") == 0){
-            int n_neurons = boost::lexical_cast<int>(args[0]);
-            dtype tau_ref = boost::lexical_cast<dtype>(args[1]);
+            int n_neurons = args.integer(0);
+            dtype tau_ref = args.real(1);
 
-            SignalView J = get_signal_view(args[2]);
-            SignalView output = get_signal_view(args[3]);
+            SignalView J = get_signal_view(args.signal(2));
+            SignalView output = get_signal_view(args.signal(3));
 
-            add_op(unique_ptr<Operator>(new Sigmoid(n_neurons, tau_ref, J, output)));
+            op = unique_ptr<Operator>(new Sigmoid(n_neurons, tau_ref, J, output));
 
         }else if(type_string.compare("Izhikevich") == 0){
-            int n_neurons = boost::lexical_cast<int>(args[0]);
+            int n_neurons = args.integer(0);
 
-            dtype tau_recovery = boost::lexical_cast<dtype>(args[1]);
-            dtype coupling = boost::lexical_cast<dtype>(args[2]);
-            dtype reset_voltage = boost::lexical_cast<dtype>(args[3]);
-            dtype reset_recovery = boost::lexical_cast<dtype>(args[4]);
-            dtype dt = boost::lexical_cast<dtype>(args[5]);
+            dtype tau_recovery = args.real(1);
+            dtype coupling = args.real(2);
+            dtype reset_voltage = args.real(3);
+            dtype reset_recovery = args.real(4);
+            dtype dt = args.real(5);
 
-            SignalView J = get_signal_view(args[6]);
-            SignalView output = get_signal_view(args[7]);
-            SignalView voltage = get_signal_view(args[8]);
-            SignalView recovery = get_signal_view(args[9]);
+            SignalView J = get_signal_view(args.signal(6));
+            SignalView output = get_signal_view(args.signal(7));
+            SignalView voltage = get_signal_view(args.signal(8));
+            SignalView recovery = get_signal_view(args.signal(9));
 
-            add_op(unique_ptr<Operator>(
+            op = unique_ptr<Operator>(
                 new Izhikevich(
                     n_neurons, tau_recovery, coupling, reset_voltage,
-                    reset_recovery, dt, J, output, voltage, recovery)));
+                    reset_recovery, dt, J, output, voltage, recovery));
 
         }else if(type_string.compare("NoDenSynapse") == 0){
 
-            SignalView input = get_signal_view(args[0]);
-            SignalView output = get_signal_view(args[1]);
-            dtype b = boost::lexical_cast<dtype>(args[2]);
+            SignalView input = get_signal_view(args.signal(0));
+            SignalView output = get_signal_view(args.signal(1));
+            dtype b = args.real(2);
 
-            add_op(unique_ptr<Operator>(new NoDenSynapse(input, output, b)));
+            op = unique_ptr<Operator>(new NoDenSynapse(input, output, b));
 
         }else if(type_string.compare("SimpleSynapse") == 0){
 
-            SignalView input = get_signal_view(args[0]);
-            SignalView output = get_signal_view(args[1]);
-            dtype a = boost::lexical_cast<dtype>(args[2]);
-            dtype b = boost::lexical_cast<dtype>(args[3]);
+            SignalView input = get_signal_view(args.signal(0));
+            SignalView output = get_signal_view(args.signal(1));
+            dtype a = args.real(2);
+            dtype b = args.real(3);
 
-            add_op(unique_ptr<Operator>(new SimpleSynapse(input, output, a, b)));
+            op = unique_ptr<Operator>(new SimpleSynapse(input, output, a, b));
 
         }else if(type_string.compare("Synapse") == 0){
 
-            SignalView input = get_signal_view(args[0]);
-            SignalView output = get_signal_view(args[1]);
+            SignalView input = get_signal_view(args.signal(0));
+            SignalView output = get_signal_view(args.signal(1));
 
-            unique_ptr<BaseSignal> numerator = python_list_to_signal(args[2], false);
-            unique_ptr<BaseSignal> denominator = python_list_to_signal(args[3], false);
+            unique_ptr<BaseSignal> numerator = args.array(2, false);
+            unique_ptr<BaseSignal> denominator = args.array(3, false);
 
-            add_op(unique_ptr<Operator>(new Synapse(input, output, *numerator, *denominator)));
+            op = unique_ptr<Operator>(new Synapse(input, output, *numerator, *denominator));
 
         }else if(type_string.compare("TriangleSynapse") == 0){
 
-            SignalView input = get_signal_view(args[0]);
-            SignalView output = get_signal_view(args[1]);
+            SignalView input = get_signal_view(args.signal(0));
+            SignalView output = get_signal_view(args.signal(1));
 
-            dtype n0 = boost::lexical_cast<dtype>(args[2]);
-            dtype ndiff = boost::lexical_cast<dtype>(args[3]);
-            int n_taps = boost::lexical_cast<int>(args[4]);
+            dtype n0 = args.real(2);
+            dtype ndiff = args.real(3);
+            int n_taps = args.integer(4);
 
-            add_op(unique_ptr<Operator>(new TriangleSynapse(input, output, n0, ndiff, n_taps)));
+            op = unique_ptr<Operator>(new TriangleSynapse(input, output, n0, ndiff, n_taps));
 
         }else if(type_string.compare("WhiteNoise") == 0){
 
-            SignalView output = get_signal_view(args[0]);
+            SignalView output = get_signal_view(args.signal(0));
 
-            dtype mean = boost::lexical_cast<dtype>(args[1]);
-            dtype std = boost::lexical_cast<dtype>(args[2]);
+            dtype mean = args.real(1);
+            dtype std = args.real(2);
 
-            bool do_scale = bool(boost::lexical_cast<int>(args[3]));
-            bool inc = bool(boost::lexical_cast<int>(args[4]));
+            bool do_scale = bool(args.integer(3));
+            bool inc = bool(args.integer(4));
 
-            dtype dt = boost::lexical_cast<dtype>(args[5]);
+            dtype dt = args.real(5);
 
-            add_op(unique_ptr<Operator>(
-                new WhiteNoise(output, mean, std, do_scale, inc, dt)));
+            op = unique_ptr<Operator>(
+                new WhiteNoise(output, mean, std, do_scale, inc, dt));
 
         }else if(type_string.compare("WhiteSignal") == 0){
 
-            SignalView output = get_signal_view(args[0]);
+            SignalView output = get_signal_view(args.signal(0));
 
             // get_size must be true here because coefs is a matrix
-            unique_ptr<BaseSignal> coefs = python_list_to_signal(args[1], true);
+            unique_ptr<BaseSignal> coefs = args.array(1, true);
 
-            add_op(unique_ptr<Operator>(new WhiteSignal(output, *coefs)));
+            op = unique_ptr<Operator>(new WhiteSignal(output, *coefs));
 
         }else if(type_string.compare("BCM") == 0){
 
-            SignalView pre_filtered = get_signal_view(args[0]);
-            SignalView post_filtered = get_signal_view(args[1]);
-            SignalView theta = get_signal_view(args[2]);
-            SignalView delta = get_signal_view(args[3]);
+            SignalView pre_filtered = get_signal_view(args.signal(0));
+            SignalView post_filtered = get_signal_view(args.signal(1));
+            SignalView theta = get_signal_view(args.signal(2));
+            SignalView delta = get_signal_view(args.signal(3));
 
-            dtype learning_rate = boost::lexical_cast<dtype>(args[4]);
-            dtype dt = boost::lexical_cast<dtype>(args[5]);
+            dtype learning_rate = args.real(4);
+            dtype dt = args.real(5);
 
-            add_op(unique_ptr<Operator>(
+            op = unique_ptr<Operator>(
                 new BCM(
-                    pre_filtered, post_filtered, theta, delta, learning_rate, dt)));
+                    pre_filtered, post_filtered, theta, delta, learning_rate, dt));
 
         }else if(type_string.compare("Oja") == 0){
 
-            SignalView pre_filtered = get_signal_view(args[0]);
-            SignalView post_filtered = get_signal_view(args[1]);
-            SignalView weights = get_signal_view(args[2]);
-            SignalView delta = get_signal_view(args[3]);
+            SignalView pre_filtered = get_signal_view(args.signal(0));
+            SignalView post_filtered = get_signal_view(args.signal(1));
+            SignalView weights = get_signal_view(args.signal(2));
+            SignalView delta = get_signal_view(args.signal(3));
 
-            dtype learning_rate = boost::lexical_cast<dtype>(args[4]);
-            dtype dt = boost::lexical_cast<dtype>(args[5]);
-            dtype beta = boost::lexical_cast<dtype>(args[6]);
+            dtype learning_rate = args.real(4);
+            dtype dt = args.real(5);
+            dtype beta = args.real(6);
 
-            add_op(unique_ptr<Operator>(
+            op = unique_ptr<Operator>(
                 new Oja(
-                    pre_filtered, post_filtered, weights, delta, learning_rate, dt, beta)));
+                    pre_filtered, post_filtered, weights, delta, learning_rate, dt, beta));
 
         }else if(type_string.compare("Voja") == 0){
 
-            SignalView pre_decoded = get_signal_view(args[0]);
-            SignalView post_filtered = get_signal_view(args[1]);
-            SignalView scaled_encoders = get_signal_view(args[2]);
-            SignalView delta = get_signal_view(args[3]);
-            SignalView learning_signal = get_signal_view(args[4]);
+            SignalView pre_decoded = get_signal_view(args.signal(0));
+            SignalView post_filtered = get_signal_view(args.signal(1));
+            SignalView scaled_encoders = get_signal_view(args.signal(2));
+            SignalView delta = get_signal_view(args.signal(3));
+            SignalView learning_signal = get_signal_view(args.signal(4));
 
-            unique_ptr<BaseSignal> scale = python_list_to_signal(args[5], false);
+            unique_ptr<BaseSignal> scale = args.array(5, false);
 
-            dtype learning_rate = boost::lexical_cast<dtype>(args[6]);
-            dtype dt = boost::lexical_cast<dtype>(args[7]);
+            dtype learning_rate = args.real(6);
+            dtype dt = args.real(7);
 
-            add_op(unique_ptr<Operator>(
+            op = unique_ptr<Operator>(
                 new Voja(
                     pre_decoded, post_filtered, scaled_encoders, delta,
-                    learning_signal, *scale, learning_rate, dt)));
-
-        }else if(type_string.compare("MpiSend") == 0){
-
-            if(n_processors > 1){
-                int dst = boost::lexical_cast<int>(args[0]);
-                dst = dst % n_processors;
-                if(dst != rank){
-
-                    int tag = boost::lexical_cast<int>(args[1]);
-                    key_type signal_key = boost::lexical_cast<key_type>(args[2]);
-                    SignalView content = get_signal_view(signal_key);
-
-                    add_mpi_send(index, dst, tag, content);
-                }
-            }
-
-        }else if(type_string.compare("MpiRecv") == 0){
-
-            if(n_processors > 1){
-                int src = boost::lexical_cast<int>(args[0]);
-                src = src % n_processors;
-
-                if(src != rank){
-                    int tag = boost::lexical_cast<int>(args[1]);
-                    key_type signal_key = boost::lexical_cast<key_type>(args[2]);
-                    SignalView content = get_signal_view(signal_key);
-
-                    add_mpi_recv(index, src, tag, content);
-                }
-            }
+                    learning_signal, *scale, learning_rate, dt));
 
         }else if(type_string.compare("SpaunStimulus") == 0){
-            SignalView output = get_signal_view(args[0]);
+            SignalView output = get_signal_view(args.signal(0));
 
-            string stim_seq_str = args[1];
+            string stim_seq_str = args.str(1);
             boost::trim_if(stim_seq_str, boost::is_any_of("[]"));
             boost::replace_all(stim_seq_str, "\"", "");
             boost::replace_all(stim_seq_str, "\'", "");
@@ -935,40 +1563,41 @@ void MpiSimulatorChunk::add_op(OpSpec op_spec){
             vector<string> stim_seq;
             boost::split(stim_seq, stim_seq_str, boost::is_any_of(","));
 
-            float present_interval = boost::lexical_cast<float>(args[2]);
-            float present_blanks = boost::lexical_cast<float>(args[3]);
+            float present_interval = args.real(2);
+            float present_blanks = args.real(3);
 
-            int identifier = boost::lexical_cast<int>(args[4]);
+            int identifier = args.integer(4);
 
-            auto op = unique_ptr<Operator>(
+            op = unique_ptr<Operator>(
                 new SpaunStimulus(
                      output, get_time_pointer(), stim_seq,
                      present_interval, present_blanks, identifier));
 
-            add_op(move(op));
-
         }else{
             stringstream msg;
             msg << "Received an operator type that nengo_mpi can't handle: " << type_string;
             throw runtime_error(msg.str());
         }
 
-        operator_list.back()->set_index(index);
-
     }catch(const boost::bad_lexical_cast& e){
-        stringstream msg;
-        msg << "Caught bad lexical cast while extracting operator from OpSpec "
-               "with error " << e.what() << endl;
-        msg << "The operator type was: " << type_string << endl;
-        msg << "The arguments were: " << endl;
-        int i = 0;
-        for(auto& s: args){
-            msg << i << ": " << s << endl;
-            i++;
-        }
+        throw runtime_error(op_args_error(type_string, args, e));
+    }
 
-        throw runtime_error(msg.str());
+    return op;
+}
+
+uint64_t MpiSimulatorChunk::mpi_wait_ns() const{
+    uint64_t wait_ns = 0;
+
+    for(auto& send: mpi_sends){
+        wait_ns += send->wait_time_ns();
+    }
+
+    for(auto& recv : mpi_recvs){
+        wait_ns += recv->wait_time_ns();
     }
+
+    return wait_ns;
 }
 
 void MpiSimulatorChunk::add_mpi_send(float index, int dst, int tag, SignalView content){
@@ -1012,6 +1641,10 @@ void MpiSimulatorChunk::add_mpi_recv(float index, int src, int tag, SignalView c
 }
 
 void MpiSimulatorChunk::add_probe(ProbeSpec ps){
+    if(image_writer){
+        image_writer->add_probe(ps);
+    }
+
     SignalView signal = get_signal_view(ps.signal_spec);
     probe_map[ps.probe_key] = shared_ptr<Probe>(new Probe(signal, ps.period));
 }
@@ -1020,6 +1653,95 @@ void MpiSimulatorChunk::set_log_filename(string lf){
     log_filename = lf;
 }
 
+void MpiSimulatorChunk::set_probe_stream(string name){
+    probe_stream_name = name;
+}
+
+void MpiSimulatorChunk::set_log_per_rank(bool per_rank){
+    log_per_rank = per_rank;
+}
+
+void MpiSimulatorChunk::set_io_servers(int n_servers, MPI_Comm comm){
+    n_io_servers = n_servers;
+    io_comm = comm;
+}
+
+void MpiSimulatorChunk::set_network_image(string name, int mode){
+    network_image_name = name;
+    network_image_mode = mode;
+}
+
+void MpiSimulatorChunk::set_fold_signals(bool fold){
+    fold_signals_enabled = fold;
+}
+
+void MpiSimulatorChunk::set_timing_period(unsigned period){
+    timing_period = max(period, 1u);
+}
+
+void MpiSimulatorChunk::set_trace(bool trace){
+    trace_enabled = trace;
+}
+
+void MpiSimulatorChunk::set_perf_counters(bool enabled){
+    perf_counters_enabled = enabled;
+}
+
+void MpiSimulatorChunk::set_memory_report(bool enabled){
+    memory_report_enabled = enabled;
+}
+
+MemoryUsage MpiSimulatorChunk::memory_usage() const{
+    MemoryUsage usage;
+
+    for(auto& kv: signal_map){
+        const BaseSignal& signal = *kv.second;
+
+        // Folded signals are counted once, as the folded storage.
+        if(folded_signals.count(kv.first) || signal.data().size() == 0){
+            continue;
+        }
+
+        if(network_image && network_image->contains(&signal.data()[0])){
+            usage.image_signals += signal_bytes(signal);
+        }else if(in_signal_segment(&signal.data()[0])){
+            usage.node_shared_signals += signal_bytes(signal);
+        }else{
+            usage.signals += signal_bytes(signal);
+        }
+    }
+
+    if(folded_storage){
+        usage.folded_signals = folded_storage->size() * sizeof(dtype);
+    }
+
+    for(auto& kv: signal_init_value){
+        usage.init_values += signal_bytes(*kv.second);
+    }
+
+    for(auto& op: operator_store){
+        size_t bytes = op->state_bytes();
+
+        if(bytes > 0){
+            usage.operator_state[op->classname()] += bytes;
+        }
+    }
+
+    for(auto& send: mpi_sends){
+        usage.mpi_buffers += send->state_bytes();
+    }
+
+    for(auto& recv: mpi_recvs){
+        usage.mpi_buffers += recv->state_bytes();
+    }
+
+    for(auto& kv: probe_map){
+        usage.probe_buffers += kv.second->buffer_bytes();
+    }
+
+    return usage;
+}
+
 bool MpiSimulatorChunk::is_logging(){
     if(sim_log){
         return sim_log->is_ready();
@@ -1031,15 +1753,114 @@ bool MpiSimulatorChunk::is_logging(){
 
 void MpiSimulatorChunk::close_simulation_log(){
     sim_log->close();
+
+    if(probe_stream){
+        cout << "Rank " << rank << " probe stream " << probe_stream->get_shm_name()
+             << ": published " << probe_stream->n_published() << " blocks, dropped "
+             << probe_stream->n_dropped() << " blocks." << endl;
+    }
+}
+
+void MpiSimulatorChunk::fold_signals(){
+    // Group candidates by hash, then split each group into classes of
+    // signals that really are identical.
+    map<uint64_t, vector<key_type>> by_hash;
+
+    for(auto& kv : signal_map){
+        if(!mutable_signals.count(kv.first) && !sent_signals.count(kv.first)){
+            by_hash[hash_signal(*kv.second)].push_back(kv.first);
+        }
+    }
+
+    vector<vector<key_type>> classes;
+    size_t n_elements = 0;
+
+    for(auto& kv : by_hash){
+        vector<vector<key_type>> group_classes;
+
+        for(key_type key : kv.second){
+            const BaseSignal& sig = *signal_map.at(key);
+            bool found = false;
+
+            for(auto& c : group_classes){
+                const BaseSignal& rep = *signal_map.at(c[0]);
+
+                if(rep.size1() == sig.size1() && rep.size2() == sig.size2() &&
+                        equal(sig.data().begin(), sig.data().end(), rep.data().begin())){
+                    c.push_back(key);
+                    found = true;
+                    break;
+                }
+            }
+
+            if(!found){
+                group_classes.push_back({key});
+            }
+        }
+
+        for(auto& c : group_classes){
+            if(c.size() > 1){
+                n_elements += signal_map.at(c[0])->data().size();
+                classes.push_back(move(c));
+            }
+        }
+    }
+
+    uint64_t n_folded = 0;
+    uint64_t n_saved = 0;
+
+    if(!classes.empty()){
+        // Folded signals go in one block, so operators reading them share cache lines.
+        folded_storage = unique_ptr<SignalSegment>(new SignalSegment(n_elements));
+        dtype* storage = folded_storage->data();
+
+        for(auto& c : classes){
+            const auto& data = signal_map.at(c[0])->data();
+            copy(data.begin(), data.end(), storage);
+
+            for(key_type key : c){
+                place_signal(*signal_map.at(key), storage);
+                folded_signals.insert(key);
+            }
+
+            n_folded += c.size();
+            n_saved += (c.size() - 1) * data.size() * sizeof(dtype);
+            storage += data.size();
+        }
+    }
+
+    // One summary for the whole simulation rather than a line per process.
+    uint64_t counts[3] = {n_folded, classes.size(), n_saved};
+
+    if(sim_comm != MPI_COMM_NULL && n_processors > 1){
+        uint64_t totals[3];
+        MPI_Reduce(counts, totals, 3, MPI_UINT64_T, MPI_SUM, 0, sim_comm);
+        copy(totals, totals + 3, counts);
+    }
+
+    if(rank == 0 && counts[0] > 0){
+        cout << "Folded " << counts[0] << " identical read-only signals into "
+             << counts[1] << ", saving " << counts[2] << " bytes." << endl;
+    }
+}
+
+void MpiSimulatorChunk::release_shared_signals(){
+    if(node_shared_signals){
+        node_shared_signals->release();
+        node_shared_signals.reset();
+    }
 }
 
 void MpiSimulatorChunk::flush_probes(){
+    TraceScope flush_scope(TRACE_PROBE_FLUSH);
+
     if(sim_log->is_ready()){
         for(auto& kv : probe_map){
             int n_rows;
             shared_ptr<dtype> buffer = (kv.second)->flush_to_buffer(n_rows);
 
             try{
+                TraceScope write_scope(TRACE_LOG_WRITE);
                 sim_log->write(kv.first, buffer, n_rows);
             }catch(out_of_range& e){
                 stringstream msg;
@@ -1047,7 +1868,15 @@ void MpiSimulatorChunk::flush_probes(){
                        "invalid probe key: " << kv.first << "." << endl;
                 throw out_of_range(msg.str());
             }
+
+            if(probe_stream && n_rows > 0){
+                probe_stream->publish(
+                    kv.first, n_steps, buffer.get(), n_rows, (kv.second)->get_n_cols());
+            }
         }
+
+        TraceScope write_scope(TRACE_LOG_WRITE);
+        sim_log->flush_events();
     }
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <map>
+#include <set>
 #include <list>
 #include <string>
 #include <sstream>
@@ -17,17 +18,34 @@
 #include "operator.hpp"
 #include "utils.hpp"
 #include "spec.hpp"
+#include "op_table.hpp"
+#include "component_buffer.hpp"
+#include "network_image.hpp"
+#include "node_share.hpp"
 #include "mpi_operator.hpp"
 #include "spaun.hpp"
 #include "probe.hpp"
+#include "probe_stream.hpp"
 #include "sim_log.hpp"
 #include "psim_log.hpp"
+#include "timing.hpp"
+#include "memory.hpp"
+#include "trace.hpp"
 #include "debug.hpp"
 #include "ezProgressBar-2.1.1/ezETAProgressBar.hpp"
 
 // How frequently to flush the probe buffers, in units of number of steps.
 const int FLUSH_PROBES_EVERY = 1000;
 
+// Tag of the messages carrying packed components (see from_buffers).
+const int component_tag = 4;
+
+// Maximum number of signal elements read from a network file at once.
+const hsize_t SIGNAL_READ_BLOCK = 1 << 20;
+
+// Read the specs of all probes in the network from an open network file.
+vector<ProbeSpec> read_probe_info(hid_t f, hid_t read_plist);
+
 /* An MpiSimulatorChunk represents the portion of a Nengo
  * network that is simulated by a single MPI process. */
 class MpiSimulatorChunk{
@@ -37,15 +55,37 @@ public:
     MpiSimulatorChunk(int rank, int n_processors, bool mpi_merged, bool collect_timings);
     const string classname() { return "MpiSimulatorChunk"; }
 
-    /* Add simulation objects to the chunk from an HDF5 file. */
+    /* Add simulation objects to the chunk from an HDF5 file. Depending on
+     * the network image mode, the chunk may instead be loaded from an image,
+     * or an image may be saved once the file has been read.
+     *
+     * With more than one processor, `comm` must contain all the chunks, and
+     * only the chunk with rank 0 reads the metadata shared by the whole
+     * network (dt, the number of components and the probe info), which it
+     * then broadcasts. */
     void from_file(string filename, hid_t file_plist, hid_t read_plist);
+    void from_file(string filename, hid_t file_plist, hid_t read_plist, MPI_Comm comm);
+
+    /* Add simulation objects to the chunk from packed components (see
+     * component_buffer.hpp) instead of a file. Only the chunk with rank 0
+     * is given the network: dt, one packed component per component and the
+     * probe strings of all probes. It sends every other chunk in `comm` the
+     * components assigned to it; the other chunks pass empty arguments. */
+    void from_buffers(
+        dtype dt, int n_components, const vector<string>& packed,
+        const vector<string>& probe_info, MPI_Comm comm);
+
+    /* Add simulation objects to the chunk from a network image previously
+     * saved by a chunk with the same rank and number of processors. */
+    void from_image(string filename);
 
     /* Run an integer number of steps. Called by a
      * worker process once it gets a signal from the master
      * process telling the worker to begin a simulation. */
     void run_n_steps(int steps, bool progress);
 
-    /* Reset the chunk. */
+    /* Reset the chunk. Only signals that some operator writes to are
+     * restored to their initial values; see finalize_build. */
     void reset(unsigned seed);
 
     // *** Signals ***
@@ -75,7 +115,9 @@ public:
     SignalView get_signal_view(SignalSpec ss);
 
     /* Get a ``view'' on a stored base signal from a string
-     * (by converting it into a SignalSpec first) . */
+     * (by converting it into a SignalSpec first). For use outside the chunk
+     * (e.g. by python functions), so the signal is treated as mutable, and
+     * must be called before finalize_build if signals are folded. */
     SignalView get_signal_view(string ss);
 
     /* Get a ``view'' on a stored base signal from a key. Parameters of the view
@@ -99,6 +141,10 @@ public:
      * that it operates on). */
     void add_op(OpSpec os);
 
+    /* Add an operator of the given type from positional arguments, which may
+     * come from an op string or from a row of an operator table. */
+    void add_op(string type_string, const OpArgs& args, float index);
+
     /* Add MPI-related operators. These have to be added separately,
      * because we need to initialize them in a special way before the
      * simulation begins. */
@@ -112,15 +158,81 @@ public:
 
     // *** Miscellaneous ***
 
+    /* Set up logging and the MPI operators once everything has been added.
+     * With more than one processor, read-only signals that are identical on
+     * several processes of a node are then stored once for the whole node
+     * (see NodeSharedSignals), which is collective over `comm`. */
     void finalize_build();
     void finalize_build(MPI_Comm comm);
 
     void set_log_filename(string lf);
+
+    /* Publish every flushed probe block to a shared memory ring buffer
+     * named /<name>_<rank> (see ProbeStream). Empty name disables. */
+    void set_probe_stream(string name);
+
+    /* If true, each process logs the probes it owns to its own file
+     * (see RankSimulationLog) instead of to a shared parallel HDF5 file.
+     * Has no effect on serial simulations. */
+    void set_log_per_rank(bool per_rank);
+
+    /* Send probe data to one of `n_io_servers` I/O server processes instead
+     * of writing it to file. The servers are the last processes of `io_comm`,
+     * which must also contain all compute processes, in order, starting at 0. */
+    void set_io_servers(int n_io_servers, MPI_Comm io_comm);
+
+    /* With NETWORK_IMAGE_SAVE, from_file writes everything it reads to the
+     * image <name>_<rank>.img. With NETWORK_IMAGE_LOAD, from_file loads that
+     * image instead of reading the network file (see network_image.hpp).
+     * NETWORK_IMAGE_CACHE (name is a cache directory) is resolved to one of
+     * these by the simulator before from_file is called. */
+    void set_network_image(string name, int mode);
+
+    /* If true, finalize_build folds read-only signals with identical
+     * contents (under different keys) into one copy; see fold_signals. */
+    void set_fold_signals(bool fold);
+
+    /* If timings are collected, operators are timed on every period-th
+     * step only; see SimulationTimings. Defaults to 1. */
+    void set_timing_period(unsigned period);
+
+    /* If true, run_n_steps records a timeline of each run (see Trace) and
+     * writes it to <log>_trace.json. Must be set on every chunk, since
+     * tracing is collective. */
+    void set_trace(bool trace);
+
+    /* If true and timings are collected, hardware counters (cycles,
+     * instructions, LLC misses, stalled cycles) are also read around each
+     * timed operator and reported per operator class; see PerfCounters.
+     * Timings are collected without them if they cannot be opened. */
+    void set_perf_counters(bool enabled);
+
+    /* If true, run_n_steps reports the memory used by each chunk (see
+     * report_memory) once the probes have been set up, before the first
+     * step. Must be set on every chunk, since the report is collective. */
+    void set_memory_report(bool enabled);
+
+    /* Bytes of memory used by the chunk. Probe buffers are only counted
+     * once run_n_steps has set them up. */
+    MemoryUsage memory_usage() const;
+
     bool is_logging();
     void close_simulation_log();
 
+    /* Give read-only signals shared with other processes on the node (see
+     * finalize_build) their own storage again. Collective over the `comm`
+     * passed to finalize_build. */
+    void release_shared_signals();
+
     void flush_probes();
 
+    /* How this process spent the last call to run_n_steps; see RunLoad.
+     * Only recorded when there is more than one process. */
+    const RunLoad& get_run_load() const { return run_load; }
+
+    // Prefix of the files written for the last call to run_n_steps.
+    const string& get_run_prefix() const { return run_prefix; }
+
     // Used to pass the simulation time to python functions
     dtype* get_time_pointer(){return &time;}
 
@@ -148,10 +260,95 @@ private:
     unique_ptr<SimulationLog> sim_log;
     string log_filename;
 
+    unique_ptr<ProbeStream> probe_stream;
+    string probe_stream_name;
+
+    bool log_per_rank;
+
+    int n_io_servers;
+    MPI_Comm io_comm;
+
+    // The communicator passed to finalize_build.
+    MPI_Comm sim_comm;
+
+    string network_image_name;
+    int network_image_mode;
+
+    // Non-null while from_file is saving an image.
+    unique_ptr<NetworkImageWriter> image_writer;
+
+    /* Build an operator from its arguments. add_op(string, OpArgs, float)
+     * wraps this, recording the arguments if an image is being saved. */
+    void build_op(string type_string, const OpArgs& args, float index);
+
+    /* Construct a non-MPI operator without adding it to the chunk. Only reads
+     * the signal map, so may be called from several threads at once, except
+     * for SpaunStimulus (which loads a shared image store). */
+    unique_ptr<Operator> make_op(string type_string, const OpArgs& args);
+
+    /* Read the signals, operators and probes of one component group. */
+    void read_component(hid_t f, hid_t read_plist, ComponentData& data);
+
+    /* Add the signals, operators and probes of components that have been
+     * read, saving a network image if one is being saved. */
+    void add_components(vector<ComponentData>& components);
+
+    /* Send a packed component from rank 0 to another chunk, or receive one. */
+    void send_component_buffer(const string& buffer, int dst, MPI_Comm comm);
+    string recv_component_buffer(MPI_Comm comm);
+
+    /* Build the operators of the given components and add them to the chunk,
+     * in the same order as if each component's operators were added in turn.
+     * The signals of all the components must already have been added. When
+     * there are several components, op strings are parsed and operators are
+     * constructed on up to one thread per component. */
+    void build_ops(vector<ComponentData>& components);
+
+    /* Add the signals that an operator of the given type writes to, according
+     * to its arguments, to mutable_signals. */
+    void record_outputs(string type_string, const OpArgs& args);
+
+    /* Place the read-only signals of the chunk that have identical shapes
+     * and contents in a single copy, in folded_storage. Views and operators
+     * keep referring to the same BaseSignal objects, which now share
+     * storage. Signals sent by MPI operators are left alone. */
+    void fold_signals();
+
+    /* Broadcast dt, n_components and probe_info from rank 0 of `comm`. Then
+     * drop the probe info this process has no use for: unless the parallel
+     * log (which creates every probe's dataset collectively) is used, a
+     * worker only needs the info for its own probes. */
+    void share_network_metadata(int& n_components, MPI_Comm comm);
+
+    bool fold_signals_enabled;
+
+    // Storage of the signals folded by fold_signals. Declared before
+    // signal_map so that it is destroyed after the signals placed in it.
+    unique_ptr<SignalSegment> folded_storage;
+    set<key_type> folded_signals;
+
+    // The image the chunk was loaded from, if any; its signals are placed in
+    // the mapping. Declared before signal_map for the same reason.
+    unique_ptr<NetworkImage> network_image;
+
     map<key_type, string> signal_labels;
     map<key_type, shared_ptr<BaseSignal>> signal_map;
+
+    // Initial values of the mutable signals, filled in by finalize_build.
+    // Read-only signals (those no operator writes to) never need restoring.
     map<key_type, shared_ptr<BaseSignal>> signal_init_value;
 
+    // Keys of the signals written to by some operator.
+    set<key_type> mutable_signals;
+
+    // Keys of the signals sent by MPI operators. These cache the address of
+    // the signal's storage, so the signals are never moved to node-shared
+    // memory.
+    set<key_type> sent_signals;
+
+    // Read-only signals stored once per node, set by finalize_build.
+    unique_ptr<NodeSharedSignals> node_shared_signals;
+
     // Contains all operators - don't have to worry about deleting these, since we
     // have unique_ptr's for all these ops in the lists below.
     list<Operator*> operator_list;
@@ -164,6 +361,26 @@ private:
 
     bool mpi_merged;
     bool collect_timings;
+    unsigned timing_period;
+    bool trace_enabled;
+    bool perf_counters_enabled;
+    bool memory_report_enabled;
+
+    RunLoad run_load;
+
+    // Number of calls to run_n_steps so far; timings, traces and the like
+    // from each run go to files of their own (see timings_prefix).
+    unsigned n_runs;
+    string run_prefix;
+
+    // Time from the start of from_file (or from_buffers) to the end of
+    // finalize_build.
+    timing_clock::time_point load_begin;
+    uint64_t load_ns;
+
+    // Time spent by all MPI operators in MPI_Wait since their comm stats
+    // were last reset.
+    uint64_t mpi_wait_ns() const;
 
     // Used at build time to construct the merged mpi operators if mpi_merged is true
     map<int, vector<pair<int, SignalView>>> merged_sends;
@@ -0,0 +1,156 @@
+#include "component_buffer.hpp"
+
+#include <cstring>
+
+/* Reads the words and string lists of a packed component in order. */
+class ComponentBufferReader{
+public:
+    ComponentBufferReader(const string& buffer, int component)
+    :buffer(buffer), component(component), position(0){}
+
+    const char* bytes(size_t n){
+        if(n > buffer.size() - position){
+            stringstream msg;
+            msg << "Packed component " << component << " ends unexpectedly at byte "
+                << position << ".";
+            throw runtime_error(msg.str());
+        }
+
+        const char* start = buffer.data() + position;
+        position += (n + 7) / 8 * 8;
+        position = min(position, buffer.size());
+        return start;
+    }
+
+    int64_t word(){
+        int64_t value;
+        memcpy(&value, bytes(sizeof(int64_t)), sizeof(int64_t));
+        return value;
+    }
+
+    int64_t count(){
+        int64_t value = word();
+
+        if(value < 0){
+            stringstream msg;
+            msg << "Packed component " << component << " has a negative count.";
+            throw runtime_error(msg.str());
+        }
+
+        return value;
+    }
+
+    vector<string> strings(size_t n_strings){
+        size_t size = count();
+        const char* start = bytes(size);
+        const char* end = start + size;
+
+        vector<string> result;
+        for(size_t i = 0; i < n_strings; i++){
+            const char* terminator = (const char*) memchr(start, '\0', end - start);
+
+            if(!terminator){
+                stringstream msg;
+                msg << "Packed component " << component << " has fewer strings than expected.";
+                throw runtime_error(msg.str());
+            }
+
+            result.push_back(string(start, terminator));
+            start = terminator + 1;
+        }
+
+        return result;
+    }
+
+    bool done() const { return position == buffer.size(); }
+
+private:
+    const string& buffer;
+    int component;
+    size_t position;
+};
+
+void unpack_component(const string& buffer, ComponentData& data){
+    ComponentBufferReader reader(buffer, data.component);
+
+    int64_t version = reader.word();
+    if(version != COMPONENT_BUFFER_VERSION){
+        stringstream msg;
+        msg << "Packed component " << data.component << " has version " << version
+            << ", but this build of nengo_mpi reads version "
+            << COMPONENT_BUFFER_VERSION << ".";
+        throw runtime_error(msg.str());
+    }
+
+    size_t n_signals = reader.count();
+    size_t n_signal_elements = reader.count();
+    size_t n_params = reader.count();
+    size_t n_tables = reader.count();
+    size_t n_op_strings = reader.count();
+    size_t n_probe_strings = reader.count();
+
+    // signals
+    vector<int64_t> keys(n_signals), shapes(2 * n_signals);
+    memcpy(keys.data(), reader.bytes(n_signals * sizeof(int64_t)), n_signals * sizeof(int64_t));
+    memcpy(shapes.data(), reader.bytes(2 * n_signals * sizeof(int64_t)),
+           2 * n_signals * sizeof(int64_t));
+
+    const char* signal_data = reader.bytes(n_signal_elements * sizeof(dtype));
+    vector<string> labels = reader.strings(n_signals);
+
+    size_t offset = 0;
+    for(size_t i = 0; i < n_signals; i++){
+        size_t size = size_t(shapes[2*i]) * shapes[2*i + 1];
+
+        if(shapes[2*i] < 0 || shapes[2*i + 1] < 0 || offset + size > n_signal_elements){
+            stringstream msg;
+            msg << "Signal data for packed component " << data.component
+                << " is shorter than its signal shapes require.";
+            throw runtime_error(msg.str());
+        }
+
+        auto signal = unique_ptr<BaseSignal>(new BaseSignal(shapes[2*i], shapes[2*i + 1]));
+        if(size > 0){
+            memcpy(&(signal->data()[0]), signal_data + offset * sizeof(dtype), size * sizeof(dtype));
+        }
+
+        data.signals.push_back({key_type(keys[i]), labels[i], move(signal)});
+        offset += size;
+    }
+
+    // operators
+    auto params = make_shared<vector<dtype>>(n_params);
+    if(n_params > 0){
+        memcpy(params->data(), reader.bytes(n_params * sizeof(dtype)), n_params * sizeof(dtype));
+    }
+
+    for(size_t i = 0; i < n_tables; i++){
+        string type_string = reader.strings(1)[0];
+        size_t n_fields = reader.count();
+        size_t n_rows = reader.count();
+
+        vector<OpTableField> fields;
+        size_t row_size = 0;
+
+        for(size_t j = 0; j < n_fields; j++){
+            fields.push_back(OpTableField(reader.word()));
+            row_size += OpTable::field_size(fields.back());
+        }
+
+        const char* rows = reader.bytes(n_rows * row_size);
+
+        data.op_tables.push_back(unique_ptr<OpTable>(
+            new OpTable(type_string, fields, rows, n_rows, params)));
+    }
+
+    data.op_strings = reader.strings(n_op_strings);
+
+    // probes
+    data.probe_strings = reader.strings(n_probe_strings);
+
+    if(!reader.done()){
+        stringstream msg;
+        msg << "Packed component " << data.component << " has trailing data.";
+        throw runtime_error(msg.str());
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <sstream>
+#include <exception>
+#include <cstdint>
+
+#include "operator.hpp"
+#include "op_table.hpp"
+
+using namespace std;
+
+/* Packed components.
+ *
+ * A packed component holds everything a network file holds for one
+ * component, so that a network built in python can be handed to the
+ * simulator without writing it to a file (see model.py, pack_component).
+ * It is a flat byte string of 8-byte words in native byte order:
+ *
+ *     header     : int64 version, n_signals, n_signal_elements, n_params,
+ *                  n_tables, n_op_strings, n_probe_strings
+ *     signals    : int64 keys[n_signals], int64 shapes[n_signals][2],
+ *                  float64 data[n_signal_elements], labels (string list)
+ *     op params  : float64 params[n_params]
+ *     op tables  : n_tables times: type (string list of one), int64 n_fields,
+ *                  int64 n_rows, int64 fields[n_fields] (OpTableField values,
+ *                  ``index'' first), rows (n_rows * row size bytes)
+ *     op strings : string list
+ *     probes     : string list
+ *
+ * A string list is an int64 byte count followed by that many bytes of
+ * null-terminated strings, padded with nulls to a multiple of 8. Table rows
+ * have the in-memory layout of OpTable (each field at the next multiple of
+ * 8 bytes, references as OpTableSignalRef and OpTableArrayRef). */
+
+const int64_t COMPONENT_BUFFER_VERSION = 1;
+
+struct ComponentSignal{
+    key_type key;
+    string label;
+    unique_ptr<BaseSignal> data;
+};
+
+/* Everything read from one component group of a network file (or from a
+ * packed component), before it is added to a chunk. Operators are kept in
+ * their stored form (op_tables and op_strings) until they are built. */
+struct ComponentData{
+    int component;
+    vector<ComponentSignal> signals;
+    vector<unique_ptr<OpTable>> op_tables;
+    vector<string> op_strings;
+    vector<string> probe_strings;
+};
+
+/* Fill `data` from a packed component. */
+void unpack_component(const string& buffer, ComponentData& data);
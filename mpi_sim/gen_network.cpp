@@ -0,0 +1,688 @@
+/* Writes synthetic networks for scaling benchmarks straight to a network
+ * file, in the layout read by MpiSimulatorChunk::from_file, without going
+ * through python and nengo.
+ *
+ * A network is a set of LIF ensembles joined by lowpass-filtered
+ * connections, laid out as a random graph, a 2D grid or a set of streams
+ * (chains of ensembles, as in bench/grid.py). Each ensemble is built from the
+ * same operators the nengo builder would use:
+ *
+ *     J = bias; J += encoders . input; LIF(J) -> output;
+ *     decoded = 0; decoded += decoders . output;
+ *
+ * and each connection from A to B is
+ *
+ *     filtered = lowpass(A.decoded); B.input += transform * filtered
+ *
+ * with an MpiSend / MpiRecv pair when A and B are in different components.
+ * Encoders, gains, biases and decoders are random, so the networks do not
+ * compute anything in particular, but they have the size, sparsity and
+ * communication pattern of real ones. */
+
+#include <map>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <random>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <exception>
+
+#include <hdf5.h>
+
+#include "optionparser.h"
+
+#include "spec.hpp"
+
+using namespace std;
+
+// Signal shapes are stored as 16 bit integers, and read as signed ones.
+const int MAX_SIGNAL_DIM = 32767;
+
+// Order of the operators within a step. An MpiRecv goes just before the
+// first op that reads its signal, and an MpiSend just after the op that
+// updates its signal, as in nengo_mpi.model.
+enum OpPhase {
+    RESET_PHASE, RECV_PHASE, INPUT_PHASE, BIAS_PHASE, ENCODE_PHASE,
+    NEURON_PHASE, DECODE_PHASE, SYNAPSE_PHASE, SEND_PHASE};
+
+// Signals belonging to each ensemble, offsets into its block of keys.
+enum EnsembleSignal {
+    ENS_INPUT, ENS_ENCODERS, ENS_BIAS, ENS_J, ENS_OUTPUT,
+    ENS_VOLTAGE, ENS_REF_TIME, ENS_DECODERS, ENS_DECODED, N_ENS_SIGNALS};
+
+// Signals belonging to each connection.
+enum ConnectionSignal {CONN_FILTERED, CONN_TRANSFORM, N_CONN_SIGNALS};
+
+struct NetworkParams{
+    string topology;
+    int n_ensembles;
+    int n_neurons;
+    int dims;
+    int fanout;
+    int n_streams;
+    int n_components;
+    double probed;
+    double dt;
+    double tau_rc;
+    double tau_ref;
+    double tau_synapse;
+    unsigned seed;
+};
+
+struct Edge{
+    int pre;
+    int post;
+
+    // MPI tag of the connection, or -1 if pre and post share a component.
+    int tag;
+
+    // Whether the connection computes the zero function, like the
+    // connection closing each stream in bench/grid.py.
+    bool zero;
+};
+
+/* The topology as a list of edges between ensembles, and the ensembles
+ * that receive the constant input. */
+struct Graph{
+    vector<Edge> edges;
+    vector<int> inputs;
+};
+
+static Graph random_graph(const NetworkParams& p, mt19937& rng){
+    if(p.fanout >= p.n_ensembles){
+        throw runtime_error("The fan-out of a random graph must be less than the number of ensembles.");
+    }
+
+    Graph g;
+    g.inputs.push_back(0);
+
+    uniform_int_distribution<int> pick(0, p.n_ensembles - 1);
+
+    for(int pre = 0; pre < p.n_ensembles; pre++){
+        vector<int> targets;
+
+        while(int(targets.size()) < p.fanout){
+            int post = pick(rng);
+
+            if(post != pre && find(targets.begin(), targets.end(), post) == targets.end()){
+                targets.push_back(post);
+            }
+        }
+
+        for(int post : targets){
+            g.edges.push_back({pre, post, -1, false});
+        }
+    }
+
+    return g;
+}
+
+/* Ensembles on a grid of width ceil(sqrt(n)), filled row by row, each
+ * connected to its (up to) four neighbours in both directions. */
+static Graph grid_graph(const NetworkParams& p){
+    int width = int(ceil(sqrt(double(p.n_ensembles))));
+
+    Graph g;
+    g.inputs.push_back(0);
+
+    for(int e = 0; e < p.n_ensembles; e++){
+        int right = e + 1;
+        int down = e + width;
+
+        if(right % width != 0 && right < p.n_ensembles){
+            g.edges.push_back({e, right, -1, false});
+            g.edges.push_back({right, e, -1, false});
+        }
+
+        if(down < p.n_ensembles){
+            g.edges.push_back({e, down, -1, false});
+            g.edges.push_back({down, e, -1, false});
+        }
+    }
+
+    return g;
+}
+
+/* n_streams chains of ensembles, each closed into a loop by a connection
+ * computing zero. Ensembles are numbered position-major (ensemble e is at
+ * position e / n_streams of stream e % n_streams), so that the contiguous
+ * assignment of ensembles to components splits every stream into segments,
+ * like the default assignment in bench/grid.py. */
+static Graph stream_graph(const NetworkParams& p){
+    Graph g;
+
+    for(int e = 0; e < p.n_ensembles; e++){
+        if(e < p.n_streams){
+            g.inputs.push_back(e);
+        }
+
+        if(e + p.n_streams < p.n_ensembles){
+            g.edges.push_back({e, e + p.n_streams, -1, false});
+        }else if(e >= p.n_streams){
+            g.edges.push_back({e, e % p.n_streams, -1, true});
+        }
+    }
+
+    return g;
+}
+
+/* Signals, operators and probes of one component, as they are stored. */
+class ComponentWriter{
+public:
+    void add_signal(key_type key, string label, int size1, int size2, vector<dtype> values){
+        keys.push_back(key);
+        shapes.push_back(size1);
+        shapes.push_back(size2);
+        labels.push_back(label);
+        data.insert(data.end(), values.begin(), values.end());
+    }
+
+    template<class... Args>
+    void add_op(OpPhase phase, string type_string, Args... args){
+        stringstream ss;
+        ss << setprecision(17) << phase << OP_DELIM << type_string;
+        append_args(ss, args...);
+
+        ops.push_back(ss.str());
+    }
+
+    void add_probe(string probe_string){
+        probes.push_back(probe_string);
+    }
+
+    void write(hid_t f, int component) const;
+
+    size_t n_elements() const{
+        return data.size();
+    }
+
+    size_t n_ops() const{
+        return ops.size();
+    }
+
+private:
+    static void append_args(stringstream&){}
+
+    template<class T, class... Args>
+    static void append_args(stringstream& ss, T arg, Args... args){
+        ss << OP_DELIM << arg;
+        append_args(ss, args...);
+    }
+
+    vector<key_type> keys;
+    vector<unsigned short> shapes;
+    vector<string> labels;
+    vector<dtype> data;
+
+    vector<string> ops;
+    vector<string> probes;
+};
+
+static void write_int_attr(hid_t obj_id, string attr_name, int value){
+    hid_t att_dataspace_id = H5Screate(H5S_SCALAR);
+    hid_t att_id = H5Acreate2(
+        obj_id, attr_name.c_str(), H5T_NATIVE_INT, att_dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
+    H5Awrite(att_id, H5T_NATIVE_INT, &value);
+    H5Aclose(att_id);
+    H5Sclose(att_dataspace_id);
+}
+
+static void write_dataset(
+        hid_t loc_id, string name, hid_t type_id, int rank, const hsize_t* dims, const void* data){
+
+    hid_t space_id = H5Screate_simple(rank, dims, NULL);
+    hid_t dset_id = H5Dcreate2(
+        loc_id, name.c_str(), type_id, space_id, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    H5Dwrite(dset_id, type_id, H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
+    H5Dclose(dset_id);
+    H5Sclose(space_id);
+}
+
+/* Stores strings as one block of characters, each string followed by a null
+ * character, with their number in the n_strings attribute. Same as
+ * store_string_list in nengo_mpi.model. */
+static void write_string_list(hid_t loc_id, string name, const vector<string>& strings){
+    string block;
+    for(const string& s : strings){
+        block.append(s);
+        block.push_back('\0');
+    }
+
+    if(block.empty()){
+        block.push_back('\0');
+    }
+
+    hid_t str_type = H5Tcopy(H5T_C_S1);
+    H5Tset_strpad(str_type, H5T_STR_NULLPAD);
+
+    hsize_t dims[] = {block.size()};
+    write_dataset(loc_id, name, str_type, 1, dims, block.data());
+
+    hid_t dset_id = H5Dopen(loc_id, name.c_str(), H5P_DEFAULT);
+    write_int_attr(dset_id, "n_strings", strings.size());
+    H5Dclose(dset_id);
+
+    H5Tclose(str_type);
+}
+
+void ComponentWriter::write(hid_t f, int component) const{
+    stringstream ss;
+    ss << component;
+
+    hid_t group = H5Gcreate2(f, ss.str().c_str(), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+
+    hsize_t n_signals = keys.size();
+    hsize_t data_dims[] = {data.size()};
+    hsize_t key_dims[] = {n_signals};
+    hsize_t shape_dims[] = {n_signals, 2};
+
+    write_dataset(group, "signals", H5T_NATIVE_DOUBLE, 1, data_dims, data.data());
+    write_dataset(group, "signal_keys", H5T_NATIVE_LLONG, 1, key_dims, keys.data());
+    write_dataset(group, "signal_shapes", H5T_NATIVE_USHORT, 2, shape_dims, shapes.data());
+
+    write_string_list(group, "signal_labels", labels);
+    write_string_list(group, "operators", ops);
+    write_string_list(group, "probes", probes);
+
+    H5Gclose(group);
+}
+
+/* Signal strings in the format parsed by SignalSpec, for a whole signal. */
+static string vector_string(key_type key, int size){
+    stringstream ss;
+    ss << key << SIGNAL_DELIM << size << SIGNAL_DELIM << 1 << SIGNAL_DELIM << 0;
+    return ss.str();
+}
+
+static string matrix_string(key_type key, int size1, int size2){
+    stringstream ss;
+    ss << key << SIGNAL_DELIM << size1 << "," << size2
+       << SIGNAL_DELIM << size2 << ",1" << SIGNAL_DELIM << 0;
+    return ss.str();
+}
+
+class NetworkGenerator{
+public:
+    NetworkGenerator(const NetworkParams& p):p(p), rng(p.seed){
+        if(p.topology == "random"){
+            graph = random_graph(p, rng);
+        }else if(p.topology == "grid"){
+            graph = grid_graph(p);
+        }else if(p.topology == "stream"){
+            graph = stream_graph(p);
+        }else{
+            throw runtime_error("Unknown topology: " + p.topology + ".");
+        }
+
+        // Tags are numbered in order over the connections that cross a
+        // component boundary, like nengo_mpi.model._next_mpi_tag.
+        int n_tags = 0;
+        for(Edge& edge : graph.edges){
+            if(component(edge.pre) != component(edge.post)){
+                edge.tag = n_tags++;
+            }
+        }
+
+        n_cross_edges = n_tags;
+
+        first_conn_key = 1 + key_type(p.n_ensembles) * N_ENS_SIGNALS;
+        first_input_key = first_conn_key + key_type(graph.edges.size()) * N_CONN_SIGNALS;
+        first_probe_key = first_input_key + 2 * graph.inputs.size();
+
+        bernoulli_distribution is_probed(p.probed);
+        for(int e = 0; e < p.n_ensembles; e++){
+            probed.push_back(is_probed(rng));
+        }
+    }
+
+    // Ensembles are assigned to components in contiguous blocks.
+    int component(int ensemble) const{
+        return int((long long)(ensemble) * p.n_components / p.n_ensembles);
+    }
+
+    void write(string filename);
+
+    size_t n_edges() const{
+        return graph.edges.size();
+    }
+
+    int n_cross_edges;
+
+private:
+    key_type ens_key(int ensemble, EnsembleSignal signal) const{
+        return 1 + key_type(ensemble) * N_ENS_SIGNALS + signal;
+    }
+
+    key_type conn_key(size_t edge, ConnectionSignal signal) const{
+        return first_conn_key + edge * N_CONN_SIGNALS + signal;
+    }
+
+    vector<dtype> uniform(size_t n, dtype low, dtype high){
+        uniform_real_distribution<dtype> dist(low, high);
+        vector<dtype> values(n);
+        for(dtype& x : values){
+            x = dist(rng);
+        }
+        return values;
+    }
+
+    void add_ensemble(ComponentWriter& w, int e);
+    void add_input(ComponentWriter& w, size_t i);
+    void add_pre_half(ComponentWriter& w, size_t edge);
+    void add_post_half(ComponentWriter& w, size_t edge);
+
+    const NetworkParams& p;
+    mt19937 rng;
+
+    Graph graph;
+    vector<bool> probed;
+
+    key_type first_conn_key;
+    key_type first_input_key;
+    key_type first_probe_key;
+
+    vector<string> probe_info;
+};
+
+void NetworkGenerator::add_ensemble(ComponentWriter& w, int e){
+    int n = p.n_neurons;
+    int d = p.dims;
+
+    stringstream label;
+    label << "ensemble " << e;
+    string l = label.str();
+
+    // Encoders are random unit vectors scaled by the gain of their neuron.
+    vector<dtype> encoders(size_t(n) * d);
+    normal_distribution<dtype> normal;
+    uniform_real_distribution<dtype> gain(1.0, 4.0);
+
+    for(int i = 0; i < n; i++){
+        dtype norm = 0.0;
+        for(int j = 0; j < d; j++){
+            encoders[i * d + j] = normal(rng);
+            norm += encoders[i * d + j] * encoders[i * d + j];
+        }
+
+        dtype scale = gain(rng) / max(sqrt(norm), dtype(1e-12));
+        for(int j = 0; j < d; j++){
+            encoders[i * d + j] *= scale;
+        }
+    }
+
+    // Spikes have height 1 / dt; decoders are scaled so that the decoded
+    // value of an ensemble firing at a few tens of Hz stays of order 1.
+    dtype decoder_scale = 1.0 / (n * 50.0);
+
+    w.add_signal(ens_key(e, ENS_INPUT), l + ".input", d, 1, vector<dtype>(d, 0.0));
+    w.add_signal(ens_key(e, ENS_ENCODERS), l + ".encoders", n, d, encoders);
+    w.add_signal(ens_key(e, ENS_BIAS), l + ".bias", n, 1, uniform(n, -1.0, 3.0));
+    w.add_signal(ens_key(e, ENS_J), l + ".J", n, 1, vector<dtype>(n, 0.0));
+    w.add_signal(ens_key(e, ENS_OUTPUT), l + ".output", n, 1, vector<dtype>(n, 0.0));
+    w.add_signal(ens_key(e, ENS_VOLTAGE), l + ".voltage", n, 1, vector<dtype>(n, 0.0));
+    w.add_signal(ens_key(e, ENS_REF_TIME), l + ".ref_time", n, 1, vector<dtype>(n, 0.0));
+    w.add_signal(
+        ens_key(e, ENS_DECODERS), l + ".decoders", d, n,
+        uniform(size_t(n) * d, -decoder_scale, decoder_scale));
+    w.add_signal(ens_key(e, ENS_DECODED), l + ".decoded", d, 1, vector<dtype>(d, 0.0));
+
+    string input = vector_string(ens_key(e, ENS_INPUT), d);
+    string J = vector_string(ens_key(e, ENS_J), n);
+    string output = vector_string(ens_key(e, ENS_OUTPUT), n);
+    string decoded = vector_string(ens_key(e, ENS_DECODED), d);
+
+    w.add_op(RESET_PHASE, "Reset", input, 0.0);
+    w.add_op(RESET_PHASE, "Reset", decoded, 0.0);
+    w.add_op(BIAS_PHASE, "Copy", J, vector_string(ens_key(e, ENS_BIAS), n));
+    w.add_op(ENCODE_PHASE, "DotInc", matrix_string(ens_key(e, ENS_ENCODERS), n, d), input, J);
+    w.add_op(
+        NEURON_PHASE, "LIF", n, p.tau_rc, p.tau_ref, 0.0, p.dt, J, output,
+        vector_string(ens_key(e, ENS_VOLTAGE), n), vector_string(ens_key(e, ENS_REF_TIME), n));
+    w.add_op(DECODE_PHASE, "DotInc", matrix_string(ens_key(e, ENS_DECODERS), d, n), output, decoded);
+
+    if(probed[e]){
+        key_type probe_key = first_probe_key + e;
+
+        stringstream ps;
+        ps << component(e) << PROBE_DELIM << probe_key << PROBE_DELIM << decoded
+           << PROBE_DELIM << 1 << PROBE_DELIM << "<Probe of " << l << ".decoded>"
+           << PROBE_DELIM << PROBE_STORAGE_DENSE;
+
+        w.add_probe(ps.str());
+        probe_info.push_back(ps.str());
+    }
+}
+
+void NetworkGenerator::add_input(ComponentWriter& w, size_t i){
+    int d = p.dims;
+    int post = graph.inputs[i];
+
+    key_type value_key = first_input_key + 2 * i;
+    key_type transform_key = value_key + 1;
+
+    stringstream label;
+    label << "input " << i;
+
+    w.add_signal(value_key, label.str() + ".value", d, 1, vector<dtype>(d, 0.25));
+    w.add_signal(transform_key, label.str() + ".transform", d, 1, vector<dtype>(d, 1.0));
+
+    w.add_op(
+        INPUT_PHASE, "ElementwiseInc", vector_string(transform_key, d),
+        vector_string(value_key, d), vector_string(ens_key(post, ENS_INPUT), d));
+}
+
+void NetworkGenerator::add_pre_half(ComponentWriter& w, size_t i){
+    const Edge& edge = graph.edges[i];
+    int d = p.dims;
+
+    stringstream label;
+    label << "connection " << edge.pre << "->" << edge.post << ".filtered";
+
+    w.add_signal(conn_key(i, CONN_FILTERED), label.str(), d, 1, vector<dtype>(d, 0.0));
+
+    dtype decay = exp(-p.dt / p.tau_synapse);
+    string filtered = vector_string(conn_key(i, CONN_FILTERED), d);
+
+    w.add_op(
+        SYNAPSE_PHASE, "SimpleSynapse", vector_string(ens_key(edge.pre, ENS_DECODED), d),
+        filtered, -decay, 1.0 - decay);
+
+    if(edge.tag >= 0){
+        w.add_op(SEND_PHASE, "MpiSend", component(edge.post), edge.tag, conn_key(i, CONN_FILTERED));
+    }
+}
+
+void NetworkGenerator::add_post_half(ComponentWriter& w, size_t i){
+    const Edge& edge = graph.edges[i];
+    int d = p.dims;
+
+    stringstream label;
+    label << "connection " << edge.pre << "->" << edge.post;
+
+    // The receiving side needs its own copy of the filtered signal.
+    if(edge.tag >= 0){
+        w.add_signal(
+            conn_key(i, CONN_FILTERED), label.str() + ".filtered", d, 1, vector<dtype>(d, 0.0));
+        w.add_op(RECV_PHASE, "MpiRecv", component(edge.pre), edge.tag, conn_key(i, CONN_FILTERED));
+    }
+
+    w.add_signal(
+        conn_key(i, CONN_TRANSFORM), label.str() + ".transform", d, 1,
+        edge.zero ? vector<dtype>(d, 0.0) : uniform(d, -1.0, 1.0));
+
+    w.add_op(
+        INPUT_PHASE, "ElementwiseInc", vector_string(conn_key(i, CONN_TRANSFORM), d),
+        vector_string(conn_key(i, CONN_FILTERED), d), vector_string(ens_key(edge.post, ENS_INPUT), d));
+}
+
+void NetworkGenerator::write(string filename){
+    // Which ensembles, inputs and connection halves go in each component.
+    vector<vector<int>> ensembles(p.n_components);
+    vector<vector<size_t>> inputs(p.n_components), pre_halves(p.n_components), post_halves(p.n_components);
+
+    for(int e = 0; e < p.n_ensembles; e++){
+        ensembles[component(e)].push_back(e);
+    }
+
+    for(size_t i = 0; i < graph.inputs.size(); i++){
+        inputs[component(graph.inputs[i])].push_back(i);
+    }
+
+    for(size_t i = 0; i < graph.edges.size(); i++){
+        pre_halves[component(graph.edges[i].pre)].push_back(i);
+        post_halves[component(graph.edges[i].post)].push_back(i);
+    }
+
+    hid_t f = H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+
+    if(f < 0){
+        throw runtime_error("Could not create network file " + filename + ".");
+    }
+
+    size_t n_elements = 0, n_ops = 0;
+
+    // Components are built and written one at a time, so only one is in
+    // memory at once.
+    for(int c = 0; c < p.n_components; c++){
+        ComponentWriter w;
+
+        for(int e : ensembles[c]){
+            add_ensemble(w, e);
+        }
+
+        for(size_t i : inputs[c]){
+            add_input(w, i);
+        }
+
+        for(size_t i : pre_halves[c]){
+            add_pre_half(w, i);
+        }
+
+        for(size_t i : post_halves[c]){
+            add_post_half(w, i);
+        }
+
+        w.write(f, c);
+
+        n_elements += w.n_elements();
+        n_ops += w.n_ops();
+    }
+
+    write_int_attr(f, "n_components", p.n_components);
+
+    hid_t att_dataspace_id = H5Screate(H5S_SCALAR);
+    hid_t att_id = H5Acreate2(f, "dt", H5T_NATIVE_DOUBLE, att_dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
+    H5Awrite(att_id, H5T_NATIVE_DOUBLE, &p.dt);
+    H5Aclose(att_id);
+    H5Sclose(att_dataspace_id);
+
+    write_string_list(f, "probe_info", probe_info);
+
+    H5Fclose(f);
+
+    cout << "Wrote " << p.topology << " network to " << filename << ": "
+         << p.n_ensembles << " ensembles, " << size_t(p.n_ensembles) * p.n_neurons << " neurons, "
+         << graph.edges.size() << " connections (" << n_cross_edges << " between components), "
+         << p.n_components << " components, " << n_ops << " operators, "
+         << n_elements * sizeof(dtype) << " bytes of signals, "
+         << probe_info.size() << " probes." << endl;
+}
+
+enum genOptionIndex {
+    UNKNOWN, HELP, TOPOLOGY, ENSEMBLES, NEURONS, DIMS, FANOUT, STREAMS,
+    PARTITIONS, PROBED, DT, SEED};
+
+const option::Descriptor gen_usage[] =
+{
+ {UNKNOWN,    0, "" , "",           option::Arg::None, "USAGE: gen_network [options] <network file>\n\n"
+                                                       "Writes a synthetic network of LIF ensembles to <network file>, which can\n"
+                                                       "be run with nengo_cpp or nengo_mpi. Ensembles are assigned to components\n"
+                                                       "in contiguous blocks.\n"
+                                                       "Options:" },
+ {HELP,       0, "" , "help",       option::Arg::None, "  --help  \tPrint usage and exit." },
+ {TOPOLOGY,   0, "",  "topology",   option::Arg::NonEmpty, "  --topology  \tOne of random (each ensemble connects to --fanout others "
+                                                           "chosen at random), grid (a 2D grid, each ensemble connected both "
+                                                           "ways to its neighbours) or stream (--streams loops of ensembles). "
+                                                           "Defaults to random."},
+ {ENSEMBLES,  0, "",  "ensembles",  option::Arg::Numeric, "  --ensembles  \tNumber of ensembles. Defaults to 100."},
+ {NEURONS,    0, "",  "neurons",    option::Arg::Numeric, "  --neurons  \tNumber of neurons per ensemble. Defaults to 50."},
+ {DIMS,       0, "",  "dims",       option::Arg::Numeric, "  --dims  \tDimensionality of each ensemble. Defaults to 1."},
+ {FANOUT,     0, "",  "fanout",     option::Arg::Numeric, "  --fanout  \tOutgoing connections per ensemble in a random graph. "
+                                                          "Defaults to 2."},
+ {STREAMS,    0, "",  "streams",    option::Arg::Numeric, "  --streams  \tNumber of streams in a stream network. Defaults to 1."},
+ {PARTITIONS, 0, "",  "partitions", option::Arg::Numeric, "  --partitions  \tNumber of components. Defaults to 1."},
+ {PROBED,     0, "",  "probed",     option::Arg::NonEmpty, "  --probed  \tFraction of ensembles whose decoded output is probed. "
+                                                           "Defaults to 0."},
+ {DT,         0, "",  "dt",         option::Arg::NonEmpty, "  --dt  \tTime step of the network. Defaults to 0.001."},
+ {SEED,       0, "",  "seed",       option::Arg::Numeric, "  --seed  \tSeed for the graph and the signal values. Defaults to 1."},
+ {UNKNOWN,    0, "" , "",           option::Arg::None, "\nExamples:\n"
+                                                       "  gen_network --ensembles 100000 --fanout 4 --partitions 512 random.net\n"
+                                                       "  gen_network --topology stream --streams 64 --ensembles 6400 "
+                                                       "--partitions 16 stream.net\n" },
+ {0,0,0,0,0,0}
+};
+
+int main(int argc, char **argv){
+    argc -= (argc > 0); argv += (argc > 0); // skip program name argv[0] if present
+    option::Stats  stats(gen_usage, argc, argv);
+    option::Option options[stats.options_max], buffer[stats.buffer_max];
+    option::Parser parse(gen_usage, argc, argv, options, buffer);
+
+    if(parse.error()){
+        return 1;
+    }
+
+    if(options[HELP] || parse.nonOptionsCount() != 1){
+        option::printUsage(std::cout, gen_usage);
+        return options[HELP] ? 0 : 1;
+    }
+
+    NetworkParams p;
+    p.topology = options[TOPOLOGY] ? options[TOPOLOGY].arg : "random";
+    p.n_ensembles = options[ENSEMBLES] ? boost::lexical_cast<int>(options[ENSEMBLES].arg) : 100;
+    p.n_neurons = options[NEURONS] ? boost::lexical_cast<int>(options[NEURONS].arg) : 50;
+    p.dims = options[DIMS] ? boost::lexical_cast<int>(options[DIMS].arg) : 1;
+    p.fanout = options[FANOUT] ? boost::lexical_cast<int>(options[FANOUT].arg) : 2;
+    p.n_streams = options[STREAMS] ? boost::lexical_cast<int>(options[STREAMS].arg) : 1;
+    p.n_components = options[PARTITIONS] ? boost::lexical_cast<int>(options[PARTITIONS].arg) : 1;
+    p.probed = options[PROBED] ? boost::lexical_cast<double>(options[PROBED].arg) : 0.0;
+    p.dt = options[DT] ? boost::lexical_cast<double>(options[DT].arg) : 0.001;
+    p.tau_rc = 0.02;
+    p.tau_ref = 0.002;
+    p.tau_synapse = 0.005;
+    p.seed = options[SEED] ? boost::lexical_cast<unsigned>(options[SEED].arg) : 1;
+
+    if(p.n_ensembles < 1 || p.n_neurons < 1 || p.dims < 1 || p.fanout < 0 ||
+       p.n_streams < 1 || p.n_components < 1){
+        cerr << "Counts must be positive." << endl;
+        return 1;
+    }
+
+    if(p.n_components > p.n_ensembles){
+        cerr << "There must be at least as many ensembles as partitions." << endl;
+        return 1;
+    }
+
+    if(p.n_neurons > MAX_SIGNAL_DIM || p.dims > MAX_SIGNAL_DIM){
+        cerr << "Neurons and dimensions per ensemble must be at most " << MAX_SIGNAL_DIM << "." << endl;
+        return 1;
+    }
+
+    if(p.probed < 0.0 || p.probed > 1.0 || p.dt <= 0.0){
+        cerr << "--probed must be between 0 and 1, and --dt positive." << endl;
+        return 1;
+    }
+
+    try{
+        NetworkGenerator generator(p);
+        generator.write(parse.nonOption(0));
+    }catch(const runtime_error& e){
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,237 @@
+#include "memory.hpp"
+
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+
+#include <unistd.h>
+#include <sys/resource.h>
+
+// Per-process values gathered by report_memory: the categories of
+// MemoryUsage (with operator state summed over classes), then the current
+// and peak resident set size.
+enum MemoryEntry{
+    MEM_SIGNALS, MEM_FOLDED, MEM_NODE_SHARED, MEM_IMAGE, MEM_INIT_VALUES,
+    MEM_OPERATOR_STATE, MEM_MPI_BUFFERS, MEM_PROBE_BUFFERS, MEM_RSS, MEM_PEAK_RSS,
+    MEM_ENTRY_SIZE};
+
+MemoryUsage::MemoryUsage()
+:signals(0), folded_signals(0), node_shared_signals(0), image_signals(0),
+init_values(0), mpi_buffers(0), probe_buffers(0){}
+
+uint64_t MemoryUsage::total() const{
+    uint64_t n = signals + folded_signals + node_shared_signals + image_signals
+                 + init_values + mpi_buffers + probe_buffers;
+
+    for(auto& kv: operator_state){
+        n += kv.second;
+    }
+
+    return n;
+}
+
+uint64_t current_rss_bytes(){
+    ifstream statm("/proc/self/statm");
+
+    uint64_t size = 0, resident = 0;
+    if(!(statm >> size >> resident)){
+        return 0;
+    }
+
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+uint64_t peak_rss_bytes(){
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0){
+        return 0;
+    }
+
+    // Reported in kilobytes on Linux.
+    return uint64_t(usage.ru_maxrss) * 1024;
+}
+
+// Total, and largest value with the rank it is on, of one category.
+struct MemoryTotal{
+    MemoryTotal(): total(0), largest(0), rank(0){}
+
+    void add(uint64_t bytes, int r){
+        total += bytes;
+        if(bytes > largest){
+            largest = bytes;
+            rank = r;
+        }
+    }
+
+    uint64_t total;
+    uint64_t largest;
+    int rank;
+};
+
+static void print_memory_row(string name, const MemoryTotal& t, int n_processors){
+    const double MiB = 1024.0 * 1024.0;
+
+    cout << "  " << left << setw(28) << name << right
+         << setw(12) << t.total / MiB
+         << setw(12) << t.total / MiB / n_processors
+         << setw(12) << t.largest / MiB
+         << "  (rank " << t.rank << ")" << endl;
+}
+
+void report_memory(const MemoryUsage& usage, MPI_Comm comm){
+    int rank = 0, n_processors = 1;
+
+    if(comm != MPI_COMM_NULL){
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &n_processors);
+    }
+
+    uint64_t operator_state = 0;
+    stringstream classes;
+
+    for(auto& kv: usage.operator_state){
+        operator_state += kv.second;
+        classes << kv.first << " " << kv.second << "\n";
+    }
+
+    // The peak reported by the kernel can lag slightly behind the current
+    // resident set size.
+    uint64_t rss = current_rss_bytes();
+
+    uint64_t entry[MEM_ENTRY_SIZE] = {
+        usage.signals, usage.folded_signals, usage.node_shared_signals,
+        usage.image_signals, usage.init_values, operator_state, usage.mpi_buffers,
+        usage.probe_buffers, rss, max(rss, peak_rss_bytes())};
+
+    // The operator classes differ between processes, so are gathered as
+    // "<class> <bytes>" lines.
+    string local_classes = classes.str();
+    int length = local_classes.size();
+
+    vector<uint64_t> all(rank == 0 ? n_processors * MEM_ENTRY_SIZE : 0);
+    vector<int> lengths(rank == 0 ? n_processors : 0);
+    vector<int> displs(lengths.size());
+    string all_classes;
+
+    if(comm == MPI_COMM_NULL){
+        all.assign(entry, entry + MEM_ENTRY_SIZE);
+        all_classes = local_classes;
+    }else{
+        MPI_Gather(entry, MEM_ENTRY_SIZE, MPI_UINT64_T, all.data(), MEM_ENTRY_SIZE, MPI_UINT64_T, 0, comm);
+        MPI_Gather(&length, 1, MPI_INT, lengths.data(), 1, MPI_INT, 0, comm);
+
+        int total_length = 0;
+        for(int r = 0; r < int(lengths.size()); r++){
+            displs[r] = total_length;
+            total_length += lengths[r];
+        }
+
+        all_classes.resize(total_length);
+        MPI_Gatherv(
+            (void*) local_classes.data(), length, MPI_CHAR, &all_classes[0],
+            lengths.data(), displs.data(), MPI_CHAR, 0, comm);
+    }
+
+    if(rank != 0){
+        return;
+    }
+
+    vector<MemoryTotal> totals(MEM_ENTRY_SIZE);
+    MemoryTotal estimate;
+    vector<uint64_t> process_estimates(n_processors, 0);
+
+    for(int r = 0; r < n_processors; r++){
+        uint64_t* e = &all[r * MEM_ENTRY_SIZE];
+
+        for(int i = 0; i < MEM_ENTRY_SIZE; i++){
+            totals[i].add(e[i], r);
+
+            if(i < MEM_RSS){
+                process_estimates[r] += e[i];
+            }
+        }
+
+        estimate.add(process_estimates[r], r);
+    }
+
+    map<string, MemoryTotal> class_totals;
+
+    for(int r = 0; r < n_processors; r++){
+        int begin = comm == MPI_COMM_NULL ? 0 : displs[r];
+        int end = comm == MPI_COMM_NULL ? all_classes.size() : begin + lengths[r];
+
+        stringstream lines(all_classes.substr(begin, end - begin));
+
+        string name;
+        uint64_t bytes;
+        while(lines >> name >> bytes){
+            class_totals[name].add(bytes, r);
+        }
+    }
+
+    streamsize precision = cout.precision(2);
+    ios::fmtflags flags = cout.flags();
+    cout << fixed;
+
+    cout << "Memory use of " << n_processors << " processes before the simulation (MiB):" << endl;
+    cout << "  " << left << setw(28) << "" << right << setw(12) << "total"
+         << setw(12) << "mean" << setw(12) << "max" << endl;
+
+    print_memory_row("signals", totals[MEM_SIGNALS], n_processors);
+    print_memory_row("folded signals", totals[MEM_FOLDED], n_processors);
+    print_memory_row("node-shared signals", totals[MEM_NODE_SHARED], n_processors);
+    print_memory_row("network image signals", totals[MEM_IMAGE], n_processors);
+    print_memory_row("signal initial values", totals[MEM_INIT_VALUES], n_processors);
+    print_memory_row("operator state", totals[MEM_OPERATOR_STATE], n_processors);
+
+    for(auto& kv: class_totals){
+        print_memory_row("  " + kv.first, kv.second, n_processors);
+    }
+
+    print_memory_row("MPI staging buffers", totals[MEM_MPI_BUFFERS], n_processors);
+    print_memory_row("probe buffers", totals[MEM_PROBE_BUFFERS], n_processors);
+    print_memory_row("estimated total", estimate, n_processors);
+    print_memory_row("resident now", totals[MEM_RSS], n_processors);
+    print_memory_row("peak resident", totals[MEM_PEAK_RSS], n_processors);
+
+    // Whatever the estimate leaves out (the program, MPI, HDF5, the chunk's
+    // maps) shows up as the difference from the peak resident set size.
+    if(totals[MEM_PEAK_RSS].total > 0){
+        const double MiB = 1024.0 * 1024.0;
+
+        double mean_excess = 0.0;
+        double max_excess = 0.0, min_excess = 0.0;
+        int max_rank = 0, min_rank = 0;
+
+        for(int r = 0; r < n_processors; r++){
+            uint64_t peak = all[r * MEM_ENTRY_SIZE + MEM_PEAK_RSS];
+            double excess = (double(peak) - double(process_estimates[r])) / MiB;
+            mean_excess += excess / n_processors;
+
+            if(r == 0 || excess > max_excess){
+                max_excess = excess;
+                max_rank = r;
+            }
+
+            if(r == 0 || excess < min_excess){
+                min_excess = excess;
+                min_rank = r;
+            }
+        }
+
+        cout << "Peak resident minus estimate (MiB): mean " << mean_excess
+             << ", min " << min_excess << " (rank " << min_rank << ")"
+             << ", max " << max_excess << " (rank " << max_rank << ")" << endl;
+
+        if(min_excess < 0.0){
+            cout << "Some of the estimated memory has not been touched yet, "
+                 << "so is not resident." << endl;
+        }
+    }
+
+    cout.flags(flags);
+    cout.precision(precision);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <cstdint>
+
+#include <mpi.h>
+
+using namespace std;
+
+/* Bytes of memory used by one chunk, by what they hold. Worked out from the
+ * sizes of the chunk's signals, operators and buffers, so it leaves out
+ * allocator overhead, the chunk's maps and the program itself. */
+struct MemoryUsage{
+    MemoryUsage();
+
+    // Storage of the signals owned by this process.
+    uint64_t signals;
+
+    // Storage of read-only signals folded into one copy (see fold_signals).
+    uint64_t folded_signals;
+
+    // This process's signals stored in memory shared by the node (see
+    // NodeSharedSignals). The same bytes are counted on every process.
+    uint64_t node_shared_signals;
+
+    // Signals placed in the mapping of a network image (see
+    // MpiSimulatorChunk::from_image). Pages that are only read are shared
+    // with the page cache.
+    uint64_t image_signals;
+
+    // Copies of the initial values of mutable signals, used by reset.
+    uint64_t init_values;
+
+    // Memory owned by operators (see Operator::state_bytes), by class.
+    map<string, uint64_t> operator_state;
+
+    // Staging buffers of the MPI operators.
+    uint64_t mpi_buffers;
+
+    // Samples held by probes between flushes, and their flush buffers.
+    uint64_t probe_buffers;
+
+    uint64_t total() const;
+};
+
+// Resident set size of this process now, and the largest it has been, in
+// bytes. 0 where this cannot be found out.
+uint64_t current_rss_bytes();
+uint64_t peak_rss_bytes();
+
+/* Gather the memory usage of every chunk in `comm` on rank 0, which prints
+ * the total, mean and largest process for each category, then compares the
+ * estimate of each process with its peak resident set size. Collective over
+ * `comm`, which may be MPI_COMM_NULL if there is only one chunk. */
+void report_memory(const MemoryUsage& usage, MPI_Comm comm);
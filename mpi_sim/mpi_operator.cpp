@@ -1,5 +1,44 @@
 #include "mpi_operator.hpp"
 
+void MPIOperator::wait(){
+    if(collect_stats || active_trace){
+        auto begin = timing_clock::now();
+        MPI_Wait(&request, &status);
+        auto end = timing_clock::now();
+
+        if(collect_stats){
+            wait_ns += elapsed_ns(begin, end);
+        }
+
+        if(active_trace){
+            active_trace->record(TRACE_MPI_WAIT, begin, end);
+        }
+    }else{
+        MPI_Wait(&request, &status);
+    }
+}
+
+void MPIOperator::reset_comm_stats(bool collect){
+    collect_stats = collect;
+    n_messages = 0;
+    wait_ns = 0;
+}
+
+void MPIOperator::add_comm_stats(map<int, PeerCommStats>& peers) const{
+    PeerCommStats& stats = peers[peer()];
+    uint64_t n_bytes = n_messages * size * sizeof(dtype);
+
+    if(sends()){
+        stats.messages_sent += n_messages;
+        stats.bytes_sent += n_bytes;
+        stats.send_wait_ns += wait_ns;
+    }else{
+        stats.messages_received += n_messages;
+        stats.bytes_received += n_bytes;
+        stats.recv_wait_ns += wait_ns;
+    }
+}
+
 MPISend::MPISend(int dst, int tag, SignalView content)
 :MPIOperator(tag), dst(dst), content(content){
 
@@ -21,12 +60,13 @@ void MPISend::operator() (){
     if(first_call){
         first_call = false;
     }else{
-        MPI_Wait(&request, &status);
+        wait();
     }
 
     memcpy(buffer.get(), content_data, size * sizeof(dtype));
 
     MPI_Isend(buffer.get(), size, MPI_DOUBLE, dst, tag, comm, &request);
+    n_messages++;
 
     mpi_dbg(*this);
 }
@@ -36,12 +76,13 @@ void MPIRecv::operator() (){
     if(first_call){
         first_call = false;
     }else{
-        MPI_Wait(&request, &status);
+        wait();
 
         memcpy(content_data, buffer.get(), size * sizeof(dtype));
     }
 
     MPI_Irecv(buffer.get(), size, MPI_DOUBLE, src, tag, comm, &request);
+    n_messages++;
 
     mpi_dbg(*this);
 }
@@ -134,7 +175,7 @@ void MergedMPISend::operator() (){
     if(first_call){
         first_call = false;
     }else{
-        MPI_Wait(&request, &status);
+        wait();
     }
 
     dtype* buffer_offset = buffer.get();
@@ -149,6 +190,7 @@ void MergedMPISend::operator() (){
     }
 
     MPI_Isend(buffer.get(), size, MPI_DOUBLE, dst, tag, comm, &request);
+    n_messages++;
 
     mpi_dbg(*this);
 }
@@ -158,7 +200,7 @@ void MergedMPIRecv::operator() (){
     if(first_call){
         first_call = false;
     }else{
-        MPI_Wait(&request, &status);
+        wait();
 
         dtype* buffer_offset = buffer.get();
 
@@ -173,6 +215,7 @@ void MergedMPIRecv::operator() (){
     }
 
     MPI_Irecv(buffer.get(), size, MPI_DOUBLE, src, tag, comm, &request);
+    n_messages++;
 
     mpi_dbg(*this);
 }
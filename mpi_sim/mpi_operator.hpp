@@ -1,25 +1,53 @@
 #pragma once
 
+#include <map>
 #include <mpi.h>
+
 #include "operator.hpp"
+#include "timing.hpp"
+#include "trace.hpp"
 
 using namespace std;
 
 class MPIOperator: public Operator{
 
 public:
-    MPIOperator():first_call(true){}
-    MPIOperator(int tag):tag(tag), first_call(true){}
+    MPIOperator():first_call(true), collect_stats(false), n_messages(0), wait_ns(0){}
+    MPIOperator(int tag):tag(tag), first_call(true), collect_stats(false), n_messages(0), wait_ns(0){}
     string classname() const { return "MPIOperator"; }
 
     virtual void operator() () = 0;
     virtual string to_string() const = 0;
-    void complete(){ MPI_Wait(&request, &status); }
+    void complete(){ wait(); }
     void set_communicator(MPI_Comm comm){ this->comm = comm; }
 
+    // The rank this operator sends to or receives from.
+    virtual int peer() const = 0;
+    virtual bool sends() const = 0;
+
+    /* Zero the message count and wait time, and start (or stop) recording
+     * them. Recording adds two clock reads to each wait. */
+    void reset_comm_stats(bool collect);
+
+    // Add the messages and wait time recorded so far to those for peer().
+    void add_comm_stats(map<int, PeerCommStats>& peers) const;
+
+    // Time spent in MPI_Wait since reset_comm_stats, if recording.
+    uint64_t wait_time_ns() const { return wait_ns; }
+
+    // The staging buffer that messages are copied into or out of.
+    size_t state_bytes() const { return size * sizeof(dtype); }
+
 protected:
+    // MPI_Wait on the pending request, timing it if stats are collected.
+    void wait();
+
     bool first_call;
 
+    bool collect_stats;
+    uint64_t n_messages;
+    uint64_t wait_ns;
+
     int tag;
     MPI_Comm comm;
     MPI_Request request;
@@ -35,6 +63,9 @@ public:
     MPISend(int dst, int tag, SignalView content);
     string classname() const { return "MPISend"; }
 
+    int peer() const { return dst; }
+    bool sends() const { return true; }
+
     void operator()();
     virtual string to_string() const;
 
@@ -51,6 +82,9 @@ public:
     MPIRecv(int src, int tag, SignalView content);
     string classname() const { return "MPIRecv"; }
 
+    int peer() const { return src; }
+    bool sends() const { return false; }
+
     void operator()();
     virtual string to_string() const;
 
@@ -77,6 +111,9 @@ public:
 
     string classname() const { return "MergedMPISend"; }
 
+    int peer() const { return dst; }
+    bool sends() const { return true; }
+
     void operator()();
     virtual string to_string() const;
 
@@ -95,6 +132,9 @@ public:
 
     string classname() const { return "MergedMPIRecv"; }
 
+    int peer() const { return src; }
+    bool sends() const { return false; }
+
     void operator()();
     virtual string to_string() const;
 
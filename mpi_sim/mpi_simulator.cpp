@@ -3,10 +3,18 @@
 int n_processors_available = 1;
 
 // This constructor assumes that MPI_Initialize has already been called.
-MpiSimulator::MpiSimulator(bool mpi_merged, bool collect_timings)
-:Simulator(collect_timings), comm(MPI_COMM_WORLD), mpi_merged(mpi_merged){
+MpiSimulator::MpiSimulator(bool mpi_merged, bool collect_timings, int n_io_servers)
+:Simulator(collect_timings), mpi_merged(mpi_merged), n_io_servers(n_io_servers),
+comm(MPI_COMM_WORLD), io_comm(MPI_COMM_WORLD){
     MPI_Comm_size(comm, &n_processors);
 
+    if(n_io_servers < 0 || 2 * n_io_servers > n_processors){
+        stringstream msg;
+        msg << "Cannot use " << n_io_servers << " I/O servers with " << n_processors
+            << " processors. There must be at least as many compute processors as I/O servers.";
+        throw runtime_error(msg.str());
+    }
+
     int buflen = 512;
     char name[buflen];
     MPI_Get_processor_name(name, &buflen);
@@ -21,9 +29,18 @@ MpiSimulator::MpiSimulator(bool mpi_merged, bool collect_timings)
     wake_workers();
     bcast_send_int(mpi_merged ? 1 : 0, comm);
     bcast_send_int(collect_timings ? 1 : 0, comm);
+    bcast_send_int(n_io_servers, comm);
+
+    if(n_io_servers > 0){
+        MPI_Comm_split(io_comm, 0, 0, &comm);
+        MPI_Comm_size(comm, &n_processors);
+
+        cout << "Master reserving " << n_io_servers << " processor(s) as I/O servers." << endl;
+    }
 
     chunk = unique_ptr<MpiSimulatorChunk>(
         new MpiSimulatorChunk(0, n_processors, mpi_merged, collect_timings));
+    chunk->set_io_servers(n_io_servers, io_comm);
 }
 
 MpiSimulator::~MpiSimulator(){
@@ -49,8 +66,36 @@ void MpiSimulator::from_file(string filename){
 
     in_file.close();
 
+    string cache_prefix;
+    if(network_image_mode == NETWORK_IMAGE_CACHE){
+        cache_prefix = build_cache_prefix(
+            network_image_name, filename, n_processors, mpi_merged);
+    }
+
     for(int i = 0; i < n_processors-1; i++){
         send_string(filename, i+1, setup_tag, comm);
+        send_string(probe_stream_name, i+1, setup_tag, comm);
+        send_int(log_per_rank ? 1 : 0, i+1, setup_tag, comm);
+        send_string(network_image_name, i+1, setup_tag, comm);
+        send_int(network_image_mode, i+1, setup_tag, comm);
+        send_string(cache_prefix, i+1, setup_tag, comm);
+        send_int(fold_signals ? 1 : 0, i+1, setup_tag, comm);
+        send_int(timing_period, i+1, setup_tag, comm);
+        send_int(trace ? 1 : 0, i+1, setup_tag, comm);
+        send_int(perf_counters ? 1 : 0, i+1, setup_tag, comm);
+        send_int(memory_report ? 1 : 0, i+1, setup_tag, comm);
+    }
+
+    if(network_image_mode == NETWORK_IMAGE_CACHE){
+        bool cached = resolve_build_cache(*chunk, cache_prefix, comm);
+
+        cout << (cached ? "Loading network from build cache: " : "Saving network to build cache: ")
+             << cache_prefix << endl;
+    }
+
+    for(int i = 0; i < n_io_servers; i++){
+        send_string(filename, n_processors + i, setup_tag, io_comm);
+        send_int(log_per_rank ? 1 : 0, n_processors + i, setup_tag, io_comm);
     }
 
     // Use parallel property lists
@@ -60,12 +105,10 @@ void MpiSimulator::from_file(string filename){
     hid_t read_plist = H5Pcreate(H5P_DATASET_XFER);
     H5Pset_dxpl_mpio(read_plist, H5FD_MPIO_INDEPENDENT);
 
-    chunk->from_file(filename, file_plist, read_plist);
+    chunk->from_file(filename, file_plist, read_plist, comm);
 
-    probe_counts.resize(n_processors);
     for(const ProbeSpec& pi : chunk->probe_info){
         probe_data[pi.probe_key] = vector<unique_ptr<BaseSignal>>();
-        probe_counts[pi.component % n_processors] += 1;
     }
 
     H5Pclose(file_plist);
@@ -81,10 +124,70 @@ void MpiSimulator::from_file(string filename){
     write_to_loadtimes_file(delta);
 }
 
+void MpiSimulator::from_buffers(
+        dtype dt, int n_components, const vector<string>& packed,
+        const vector<string>& probe_info){
+
+    clock_t begin = clock();
+
+    label = "network in memory";
+
+    if(n_io_servers > 0){
+        throw runtime_error("I/O servers can only be used with a network file.");
+    }
+
+    if(network_image_mode == NETWORK_IMAGE_LOAD || network_image_mode == NETWORK_IMAGE_CACHE){
+        throw runtime_error(
+            "Network images can only be loaded, or cached, for networks read from a file.");
+    }
+
+    // Checked here, before any setup message is sent, since the workers
+    // would otherwise be left waiting for the network metadata.
+    if(int(packed.size()) != n_components){
+        stringstream msg;
+        msg << "Got " << packed.size() << " packed components for a network with "
+            << n_components << " components.";
+        throw runtime_error(msg.str());
+    }
+
+    for(int i = 0; i < n_processors-1; i++){
+        send_string("", i+1, setup_tag, comm);
+        send_string(probe_stream_name, i+1, setup_tag, comm);
+        send_int(log_per_rank ? 1 : 0, i+1, setup_tag, comm);
+        send_string(network_image_name, i+1, setup_tag, comm);
+        send_int(network_image_mode, i+1, setup_tag, comm);
+        send_string("", i+1, setup_tag, comm);
+        send_int(fold_signals ? 1 : 0, i+1, setup_tag, comm);
+        send_int(timing_period, i+1, setup_tag, comm);
+        send_int(trace ? 1 : 0, i+1, setup_tag, comm);
+        send_int(perf_counters ? 1 : 0, i+1, setup_tag, comm);
+        send_int(memory_report ? 1 : 0, i+1, setup_tag, comm);
+    }
+
+    chunk->from_buffers(dt, n_components, packed, probe_info, comm);
+
+    for(const ProbeSpec& pi : chunk->probe_info){
+        probe_data[pi.probe_key] = vector<unique_ptr<BaseSignal>>();
+    }
+
+    // Master barrier 1
+    MPI_Barrier(comm);
+
+    clock_t end = clock();
+    double delta = double(end - begin) / CLOCKS_PER_SEC;
+    cout << "Loading network from memory took " << delta << " seconds." << endl;
+
+    write_to_loadtimes_file(delta);
+}
+
 void MpiSimulator::finalize_build(){
     chunk->finalize_build(comm);
 }
 
+void MpiSimulator::set_rank_cost_file(string filename){
+    rank_cost_file = filename;
+}
+
 void MpiSimulator::run_n_steps(int steps, bool progress, string log_filename){
     clock_t begin = clock();
 
@@ -96,6 +199,11 @@ void MpiSimulator::run_n_steps(int steps, bool progress, string log_filename){
          << " to " << n_processors - 1 << " workers." << endl;
     MPI_Bcast(&steps, 1, MPI_INT, 0, comm);
 
+    for(int i = 0; i < n_io_servers; i++){
+        send_int(steps, n_processors + i, setup_tag, io_comm);
+        send_string(log_filename, n_processors + i, setup_tag, io_comm);
+    }
+
     cout << "Master starting simulation: " << steps << " steps." << endl;
 
     chunk->set_log_filename(log_filename);
@@ -104,6 +212,15 @@ void MpiSimulator::run_n_steps(int steps, bool progress, string log_filename){
     // Master barrier 2
     MPI_Barrier(comm);
 
+    if(n_processors > 1){
+        // The balance files are only written when asked for, like the
+        // timings files.
+        bool write_balance = collect_timings || !rank_cost_file.empty();
+        report_load_balance(
+            write_balance ? chunk->get_run_prefix() : "",
+            chunk->get_run_load(), rank_cost_file, comm);
+    }
+
     if(!chunk->is_logging()){
         gather_probe_data();
     }
@@ -126,25 +243,44 @@ void MpiSimulator::gather_probe_data(){
     // Gather data on the worker processes
     cout << "Master gathering probe data from workers..." << endl;
 
-    for(int processor_idx = 1; processor_idx < n_processors; processor_idx++){
+    // The master contributes nothing to the collective, its own probe
+    // data has already been harvested above.
+    vector<key_type> header;
+    vector<dtype> data;
 
-        int probe_count = probe_counts[processor_idx];
+    vector<int> header_counts(n_processors), data_counts(n_processors);
+    vector<int> header_displs(n_processors), data_displs(n_processors);
 
-        for(unsigned i = 0; i < probe_count; i++){
-            key_type probe_key = recv_key(processor_idx, probe_tag, comm);
+    gather_probe_buffers(
+        header, data, header_counts, data_counts,
+        header_displs, data_displs, comm);
 
-            run_dbg("Master receiving probe data from chunk " << processor_idx << endl
+    for(int processor_idx = 1; processor_idx < n_processors; processor_idx++){
+        key_type* h = header.data() + header_displs[processor_idx];
+        key_type* h_end = h + header_counts[processor_idx];
+        dtype* d = data.data() + data_displs[processor_idx];
+
+        while(h < h_end){
+            key_type probe_key = h[0];
+            int n_samples = h[1];
+            int size1 = h[2];
+            int size2 = h[3];
+            h += PROBE_HEADER_SIZE;
+
+            run_dbg("Master unpacking probe data from chunk " << processor_idx << endl
                     << "with key " << probe_key << "..." << endl);
 
-            int data_length = recv_int(processor_idx, probe_tag, comm);
+            auto& probe_vector = probe_data.at(probe_key);
+            probe_vector.reserve(probe_vector.size() + n_samples);
 
-            auto& data = probe_data[probe_key];
-            data.reserve(data.size() + data_length);
+            for(int j = 0; j < n_samples; j++){
+                auto matrix = unique_ptr<BaseSignal>(new BaseSignal(size1, size2));
 
-            for(int j = 0; j < data_length; j++){
-                unique_ptr<BaseSignal> matrix = recv_matrix(processor_idx, probe_tag, comm);
+                // Assumes matrices stored in row-major
+                copy(d, d + size1 * size2, matrix->data().begin());
+                d += size1 * size2;
 
-                data.push_back(move(matrix));
+                probe_vector.push_back(move(matrix));
             }
         }
     }
@@ -172,9 +308,19 @@ void MpiSimulator::close(){
     MPI_Bcast(&steps, 1, MPI_INT, 0, comm);
 
     chunk->close_simulation_log();
+    chunk->release_shared_signals();
+
+    for(int i = 0; i < n_io_servers; i++){
+        send_int(-1, n_processors + i, setup_tag, io_comm);
+    }
 
     // Master barrier 4
     MPI_Barrier(comm);
+
+    if(comm != io_comm){
+        MPI_Comm_free(&comm);
+        comm = io_comm;
+    }
 }
 
 string MpiSimulator::to_string() const{
@@ -260,45 +406,115 @@ void worker_start(MPI_Comm comm){
         dbg("Reading collect_timings...");
         int collect_timings = bcast_recv_int(comm);
 
+        dbg("Reading number of I/O servers...");
+        int n_io_servers = bcast_recv_int(comm);
+
+        // If there are I/O servers, they are the last processes, and the
+        // rest of the processes simulate the network on their own communicator.
+        MPI_Comm sim_comm = comm;
+
+        if(n_io_servers > 0){
+            int is_server = rank >= n_processors - n_io_servers;
+            MPI_Comm_split(comm, is_server, rank, &sim_comm);
+
+            if(is_server){
+                io_server_start(comm, sim_comm, n_io_servers);
+                MPI_Comm_free(&sim_comm);
+                continue;
+            }
+        }
+
+        int n_sim_processors;
+        MPI_Comm_size(sim_comm, &n_sim_processors);
+
         dbg("Reading filename...");
-        string filename = recv_string(0, setup_tag, comm);
+        string filename = recv_string(0, setup_tag, sim_comm);
+
+        dbg("Reading probe stream name...");
+        string probe_stream_name = recv_string(0, setup_tag, sim_comm);
+
+        dbg("Reading log mode...");
+        int log_per_rank = recv_int(0, setup_tag, sim_comm);
+
+        dbg("Reading network image settings...");
+        string network_image_name = recv_string(0, setup_tag, sim_comm);
+        int network_image_mode = recv_int(0, setup_tag, sim_comm);
+        string cache_prefix = recv_string(0, setup_tag, sim_comm);
+
+        dbg("Reading signal folding...");
+        int fold_signals = recv_int(0, setup_tag, sim_comm);
+
+        dbg("Reading timing period...");
+        int timing_period = recv_int(0, setup_tag, sim_comm);
+
+        dbg("Reading trace mode...");
+        int trace = recv_int(0, setup_tag, sim_comm);
+
+        dbg("Reading hardware counter mode...");
+        int perf_counters = recv_int(0, setup_tag, sim_comm);
+
+        dbg("Reading memory report mode...");
+        int memory_report = recv_int(0, setup_tag, sim_comm);
 
         dbg("Creating chunk...");
-        MpiSimulatorChunk chunk(rank, n_processors, bool(mpi_merged), bool(collect_timings));
+        MpiSimulatorChunk chunk(rank, n_sim_processors, bool(mpi_merged), bool(collect_timings));
+        chunk.set_probe_stream(probe_stream_name);
+        chunk.set_log_per_rank(bool(log_per_rank));
+        chunk.set_io_servers(n_io_servers, comm);
+        chunk.set_network_image(network_image_name, network_image_mode);
+        chunk.set_fold_signals(bool(fold_signals));
+        chunk.set_timing_period(timing_period);
+        chunk.set_trace(bool(trace));
+        chunk.set_perf_counters(bool(perf_counters));
+        chunk.set_memory_report(bool(memory_report));
+
+        if(network_image_mode == NETWORK_IMAGE_CACHE){
+            resolve_build_cache(chunk, cache_prefix, sim_comm);
+        }
 
-        // Use parallel property lists
-        hid_t file_plist = H5Pcreate(H5P_FILE_ACCESS);
-        H5Pset_fapl_mpio(file_plist, comm, MPI_INFO_NULL);
+        if(filename.empty()){
+            // The master has the network in memory, and sends us our part.
+            dbg("Receiving network from master...");
+            chunk.from_buffers(0.0, 0, vector<string>(), vector<string>(), sim_comm);
 
-        hid_t read_plist = H5Pcreate(H5P_DATASET_XFER);
-        H5Pset_dxpl_mpio(read_plist, H5FD_MPIO_INDEPENDENT);
+        }else{
+            // Use parallel property lists
+            hid_t file_plist = H5Pcreate(H5P_FILE_ACCESS);
+            H5Pset_fapl_mpio(file_plist, sim_comm, MPI_INFO_NULL);
 
-        dbg("Loading from file...");
-        chunk.from_file(filename, file_plist, read_plist);
-        chunk.finalize_build(comm);
+            hid_t read_plist = H5Pcreate(H5P_DATASET_XFER);
+            H5Pset_dxpl_mpio(read_plist, H5FD_MPIO_INDEPENDENT);
 
-        H5Pclose(file_plist);
-        H5Pclose(read_plist);
+            dbg("Loading from file...");
+            chunk.from_file(filename, file_plist, read_plist, sim_comm);
 
-        // Worker barrier 1
-        MPI_Barrier(comm);
+            H5Pclose(file_plist);
+            H5Pclose(read_plist);
+        }
+
+        // Worker barrier 1. Comes before finalize_build, since the master
+        // only finalizes its chunk after its own barrier 1 and finalize_build
+        // makes collective calls on sim_comm.
+        MPI_Barrier(sim_comm);
+
+        chunk.finalize_build(sim_comm);
 
         while(true){
             dbg("Worker " << rank << " waiting for signal to start simulation...");
             int steps;
-            MPI_Bcast(&steps, 1, MPI_INT, 0, comm);
+            MPI_Bcast(&steps, 1, MPI_INT, 0, sim_comm);
 
             if(steps == 0){
                 // Reset
                 dbg("Worker " << rank << " received the signal to reset the simulation." << endl);
 
                 unsigned seed;
-                MPI_Bcast(&seed, 1, MPI_UNSIGNED, 0, comm);
+                MPI_Bcast(&seed, 1, MPI_UNSIGNED, 0, sim_comm);
 
                 chunk.reset(seed);
 
                 // Worker barrier 5
-                MPI_Barrier(comm);
+                MPI_Barrier(sim_comm);
 
             }else if(steps > 0){
                 // Simulate
@@ -308,41 +524,174 @@ void worker_start(MPI_Comm comm){
                 chunk.run_n_steps(steps, false);
 
                 // Worker barrier 2
-                MPI_Barrier(comm);
+                MPI_Barrier(sim_comm);
+
+                report_load_balance("", chunk.get_run_load(), "", sim_comm);
 
                 if(!chunk.is_logging()){
                     // If we're not logging, send the probe data back to the master
-                    for(auto& pair : chunk.probe_map){
-                        key_type key = pair.first;
-                        shared_ptr<Probe>& probe = pair.second;
-
-                        send_key(key, 0, probe_tag, comm);
-
-                        vector<unique_ptr<BaseSignal>> probe_data = probe->harvest_data();
-
-                        send_int(probe_data.size(), 0, probe_tag, comm);
-
-                        for(auto& pd : probe_data){
-                            send_matrix(move(pd), 0, probe_tag, comm);
-                        }
-                    }
+                    vector<key_type> header;
+                    vector<dtype> data;
+                    pack_probe_data(chunk.probe_map, header, data);
+
+                    vector<int> header_counts, data_counts, header_displs, data_displs;
+                    gather_probe_buffers(
+                        header, data, header_counts, data_counts,
+                        header_displs, data_displs, sim_comm);
                 }
 
                 // Worker barrier 3
-                MPI_Barrier(comm);
+                MPI_Barrier(sim_comm);
             }else{
                 dbg("Worker " << rank << " received the signal to close the simulation." << endl);
 
                 chunk.close_simulation_log();
+                chunk.release_shared_signals();
 
                 // Worker barrier 4
-                MPI_Barrier(comm);
+                MPI_Barrier(sim_comm);
+
+                if(sim_comm != comm){
+                    MPI_Comm_free(&sim_comm);
+                }
+
                 break;
             }
         }
     }
 }
 
+// comm: Communicator containing all processes, with the master process
+// having rank 0 and the I/O servers at the end.
+// server_comm: Communicator containing only the I/O servers.
+void io_server_start(MPI_Comm comm, MPI_Comm server_comm, int n_io_servers){
+
+    int rank, n_processors, server;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &n_processors);
+    MPI_Comm_rank(server_comm, &server);
+
+    int n_clients = n_processors - n_io_servers;
+
+    dbg("I/O server " << server << " reading filename...");
+    string filename = recv_string(0, setup_tag, comm);
+    int log_per_rank = recv_int(0, setup_tag, comm);
+
+    // Servers only need dt and the probe info, not the rest of the network.
+    // The first server reads them and shares them with the others.
+    dtype dt;
+    string encoded;
+
+    if(server == 0){
+        hid_t f = H5Fopen(filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+
+        hid_t attr = H5Aopen(f, "dt", H5P_DEFAULT);
+        H5Aread(attr, H5T_NATIVE_DOUBLE, &dt);
+        H5Aclose(attr);
+
+        encoded = encode_probe_info(read_probe_info(f, H5P_DEFAULT));
+        H5Fclose(f);
+    }
+
+    int n_chars = encoded.size();
+    MPI_Bcast(&dt, 1, MPI_DOUBLE, 0, server_comm);
+    MPI_Bcast(&n_chars, 1, MPI_INT, 0, server_comm);
+
+    encoded.resize(n_chars);
+    MPI_Bcast(&encoded[0], n_chars, MPI_CHAR, 0, server_comm);
+
+    vector<ProbeSpec> probe_info = decode_probe_info(encoded);
+
+    int n_my_clients = 0;
+    for(int client = 0; client < n_clients; client++){
+        if(io_server_index(client, n_clients, n_io_servers) == unsigned(server)){
+            n_my_clients++;
+        }
+    }
+
+    while(true){
+        int steps = recv_int(0, setup_tag, comm);
+
+        if(steps < 0){
+            dbg("I/O server " << server << " received the signal to close the simulation." << endl);
+            break;
+        }
+
+        string log_filename = recv_string(0, setup_tag, comm);
+
+        if(log_filename.length() == 0){
+            continue;
+        }
+
+        unique_ptr<SimulationLog> sim_log;
+        if(log_per_rank){
+            sim_log = unique_ptr<SimulationLog>(
+                new RankSimulationLog(n_io_servers, server, probe_info, dt, server_comm, n_clients));
+        }else if(n_io_servers != 1){
+            sim_log = unique_ptr<SimulationLog>(
+                new ParallelSimulationLog(n_io_servers, server, probe_info, dt, server_comm, n_clients));
+        }else{
+            sim_log = unique_ptr<SimulationLog>(new SimulationLog(probe_info, dt));
+        }
+
+        if(server == 0){
+            sim_log->prep_for_simulation(log_filename, steps);
+        }else{
+            sim_log->prep_for_simulation();
+        }
+
+        // Every client sends the same number of rounds, so every server makes
+        // the same number of calls to flush_events, which may be collective.
+        int n_round_ends = 0, n_run_ends = 0;
+        key_type header[IO_HEADER_SIZE];
+
+        while(n_run_ends < n_my_clients){
+            MPI_Status status;
+            MPI_Recv(header, IO_HEADER_SIZE, MPI_LONG_LONG_INT, MPI_ANY_SOURCE, io_tag, comm, &status);
+
+            if(header[0] == IO_BLOCK){
+                int src = status.MPI_SOURCE;
+                int count;
+
+                MPI_Probe(src, io_tag, comm, &status);
+                MPI_Get_count(&status, MPI_DOUBLE, &count);
+
+                shared_ptr<dtype> buffer(new dtype[count], default_delete<dtype[]>());
+                MPI_Recv(buffer.get(), count, MPI_DOUBLE, src, io_tag, comm, MPI_STATUS_IGNORE);
+
+                sim_log->write(header[1], buffer, header[2]);
+
+            }else if(header[0] == IO_ROUND_END){
+                n_round_ends++;
+
+                if(n_round_ends % n_my_clients == 0){
+                    sim_log->flush_events();
+                }
+
+            }else{
+                n_run_ends++;
+            }
+        }
+
+        sim_log->close();
+    }
+}
+
+bool resolve_build_cache(MpiSimulatorChunk& chunk, string prefix, MPI_Comm comm){
+    int rank, n_processors;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &n_processors);
+
+    // All processes have to agree, since opening the network file is collective.
+    int cached = network_image_valid(
+        network_image_filename(prefix, rank), rank, n_processors) ? 1 : 0;
+    MPI_Allreduce(MPI_IN_PLACE, &cached, 1, MPI_INT, MPI_MIN, comm);
+
+    chunk.set_network_image(prefix, cached ? NETWORK_IMAGE_LOAD : NETWORK_IMAGE_SAVE);
+
+    return bool(cached);
+}
+
 void MpiSimulator::write_to_time_file(char* filename, double delta){
     if(filename){
         ofstream f(filename, ios::app);
@@ -465,6 +814,100 @@ void send_matrix(unique_ptr<BaseSignal> matrix, int dst, int tag, MPI_Comm comm)
     MPI_Send(data_buffer.get(), size1 * size2, MPI_DOUBLE, dst, tag, comm);
 }
 
+void pack_probe_data(
+        map<key_type, shared_ptr<Probe>>& probe_map,
+        vector<key_type>& header, vector<dtype>& data){
+
+    header.clear();
+    data.clear();
+
+    for(auto& pair : probe_map){
+        vector<unique_ptr<BaseSignal>> probe_data = pair.second->harvest_data();
+
+        int n_samples = probe_data.size();
+        int size1 = n_samples > 0 ? probe_data[0]->size1() : 0;
+        int size2 = n_samples > 0 ? probe_data[0]->size2() : 0;
+
+        header.push_back(pair.first);
+        header.push_back(n_samples);
+        header.push_back(size1);
+        header.push_back(size2);
+
+        data.reserve(data.size() + n_samples * size1 * size2);
+
+        // Assumes matrices stored in row-major
+        for(auto& pd : probe_data){
+            data.insert(data.end(), pd->data().begin(), pd->data().end());
+        }
+    }
+}
+
+void gather_probe_buffers(
+        vector<key_type>& header, vector<dtype>& data,
+        vector<int>& header_counts, vector<int>& data_counts,
+        vector<int>& header_displs, vector<int>& data_displs, MPI_Comm comm){
+
+    static_assert(sizeof(key_type) == sizeof(uint64_t),
+                  "Probe headers are sent as MPI_UINT64_T.");
+
+    int rank, n_processors;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &n_processors);
+
+    // Sizes are gathered as long long so that an oversized buffer on any
+    // process is seen by the master rather than truncated. The master then
+    // tells every process whether the gather can go ahead, so that all of
+    // them throw together instead of leaving the others in the collective.
+    long long counts[2] = {(long long) header.size(), (long long) data.size()};
+    vector<long long> all_counts(rank == 0 ? 2 * n_processors : 0);
+
+    MPI_Gather(counts, 2, MPI_LONG_LONG, all_counts.data(), 2, MPI_LONG_LONG, 0, comm);
+
+    long long header_total = 0, data_total = 0;
+
+    if(rank == 0){
+        for(int i = 0; i < n_processors; i++){
+            header_total += all_counts[2*i];
+            data_total += all_counts[2*i + 1];
+        }
+    }
+
+    long long totals[2] = {header_total, data_total};
+    MPI_Bcast(totals, 2, MPI_LONG_LONG, 0, comm);
+    header_total = totals[0];
+    data_total = totals[1];
+
+    if(header_total > INT_MAX || data_total > INT_MAX){
+        stringstream msg;
+        msg << "Probe data is too large to be gathered on the master ("
+            << data_total << " values in total). Log to a file instead.";
+        throw runtime_error(msg.str());
+    }
+
+    if(rank == 0){
+        for(int i = 0; i < n_processors; i++){
+            header_counts[i] = all_counts[2*i];
+            data_counts[i] = all_counts[2*i + 1];
+
+            header_displs[i] = i == 0 ? 0 : header_displs[i-1] + header_counts[i-1];
+            data_displs[i] = i == 0 ? 0 : data_displs[i-1] + data_counts[i-1];
+        }
+
+        header.resize(header_total);
+        data.resize(data_total);
+    }
+
+    MPI_Gatherv(
+        rank == 0 ? MPI_IN_PLACE : header.data(), int(counts[0]), MPI_UINT64_T,
+        header.data(), header_counts.data(), header_displs.data(),
+        MPI_UINT64_T, 0, comm);
+
+    MPI_Gatherv(
+        rank == 0 ? MPI_IN_PLACE : data.data(), int(counts[1]), MPI_DOUBLE,
+        data.data(), data_counts.data(), data_displs.data(),
+        MPI_DOUBLE, 0, comm);
+}
+
 int bcast_recv_int(MPI_Comm comm){
     int src = 0;
 
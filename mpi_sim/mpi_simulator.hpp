@@ -5,6 +5,7 @@
 #include <string>
 #include <memory>
 #include <exception>
+#include <climits>
 
 #include <mpi.h>
 
@@ -18,16 +19,34 @@ using namespace std;
 const int setup_tag = 1;
 const int probe_tag = 2;
 
+// Number of entries per probe in the header of a packed probe buffer:
+// probe key, number of samples, size1, size2.
+const int PROBE_HEADER_SIZE = 4;
+
 extern int n_processors_available;
 
 class MpiSimulator: public Simulator{
 public:
-    MpiSimulator(bool mpi_merged, bool collect_timings);
+    // The last `n_io_servers` processes are reserved for writing probe data
+    // to file (see io_server_start), and take no part in the simulation.
+    MpiSimulator(bool mpi_merged, bool collect_timings, int n_io_servers=0);
     ~MpiSimulator();
 
     void from_file(string filename) override;
+
+    /* Scatters the packed components to the workers. Workers are told to
+     * expect them by an empty network filename. */
+    void from_buffers(
+        dtype dt, int n_components, const vector<string>& packed,
+        const vector<string>& probe_info) override;
     void finalize_build() override;
 
+    /* After each run, the master reports how evenly the work was spread
+     * over the processes (see report_load_balance). If `filename` is not
+     * empty, the cost of each rank is also written there, for use by the
+     * work_balanced partitioner. */
+    void set_rank_cost_file(string filename);
+
     void run_n_steps(int steps, bool progress, string log_filename) override;
 
     void gather_probe_data() override;
@@ -47,11 +66,13 @@ public:
 protected:
     int n_processors;
     bool mpi_merged;
+    int n_io_servers;
+    string rank_cost_file;
 
+    // Communicator for the processes simulating the network, and a
+    // communicator containing those processes followed by the I/O servers.
     MPI_Comm comm;
-
-    // Used to gather probe data from workers after simulation.
-    vector<int> probe_counts;
+    MPI_Comm io_comm;
 };
 
 void mpi_init();
@@ -63,6 +84,17 @@ void kill_workers();
 void worker_start();
 void worker_start(MPI_Comm comm);
 
+/* Run by processes reserved as I/O servers, for the lifetime of one
+ * MpiSimulator. Receives the blocks of probe data sent by its compute
+ * processes (see IOClientSimulationLog) and writes them to file. */
+void io_server_start(MPI_Comm comm, MPI_Comm server_comm, int n_io_servers);
+
+/* Collectively decide whether the chunks on comm load their images from the
+ * build cache entry `prefix` (if every process has a valid image there) or
+ * rebuild from the network file and save new images, and set the chunk's
+ * network image mode accordingly. Returns true if the cache is used. */
+bool resolve_build_cache(MpiSimulatorChunk& chunk, string prefix, MPI_Comm comm);
+
 string recv_string(int src, int tag, MPI_Comm comm);
 void send_string(string s, int dst, int tag, MPI_Comm comm);
 
@@ -78,5 +110,21 @@ void send_key(key_type i, int dst, int tag, MPI_Comm comm);
 unique_ptr<BaseSignal> recv_matrix(int src, int tag, MPI_Comm comm);
 void send_matrix(unique_ptr<BaseSignal> matrix, int dst, int tag, MPI_Comm comm);
 
+/* Harvest the data from all probes in probe_map, packing it into a header
+ * (PROBE_HEADER_SIZE entries per probe) and one contiguous data buffer. */
+void pack_probe_data(
+    map<key_type, shared_ptr<Probe>>& probe_map,
+    vector<key_type>& header, vector<dtype>& data);
+
+/* Collectively gather packed probe buffers on the master. On the master,
+ * header and data are replaced by the concatenation of the buffers from all
+ * processes, and the counts/displs vectors (which must have one entry per
+ * process) give the location of each process's contribution. If the gathered
+ * buffers would not fit in an int count, every process throws. */
+void gather_probe_buffers(
+    vector<key_type>& header, vector<dtype>& data,
+    vector<int>& header_counts, vector<int>& data_counts,
+    vector<int>& header_displs, vector<int>& data_displs, MPI_Comm comm);
+
 int bcast_recv_int(MPI_Comm comm);
 void bcast_send_int(int i, MPI_Comm comm);
@@ -7,7 +7,8 @@
 #include "simulator.hpp"
 
 
-enum serialOptionIndex {UNKNOWN, HELP, NO_PROG, TIMING, LOG, SEED};
+enum serialOptionIndex {UNKNOWN, HELP, NO_PROG, TIMING, LOG, SEED, STREAM, SAVE_IMAGE, LOAD_IMAGE, BUILD_CACHE, FOLD_SIGNALS, TIMING_EVERY, TRACE, COUNTERS,
+    MEMREPORT};
 
 const option::Descriptor serial_usage[] =
 {
@@ -19,11 +20,41 @@ const option::Descriptor serial_usage[] =
                                                    "Options:" },
  {HELP,     0, "" , "help",     option::Arg::None, "  --help  \tPrint usage and exit." },
  {NO_PROG,  0, "",  "noprog",   option::Arg::None, "  --noprog  \tSupply to omit the progress bar." },
- {TIMING,   0, "",  "timing",   option::Arg::None, "  --timing  \tSupply to collect timing info." },
+ {TIMING,   0, "",  "timing",   option::Arg::None, "  --timing  \tSupply to collect wall-clock timings of each step and operator. "
+                                                               "Each process writes them to <log>_timings_<rank>.json and .csv, "
+                                                               "where <log> is the log filename without its extension."},
+ {TIMING_EVERY, 0, "", "timing-every", option::Arg::Numeric, "  --timing-every  \tTime operators on every Nth step only, to keep the "
+                                                               "cost of timing low. Implies --timing. Defaults to 1."},
+ {COUNTERS, 0, "",  "counters", option::Arg::None, "  --counters  \tSupply to also read hardware performance counters (cycles, "
+                                                               "instructions, LLC misses, stalled cycles) around each timed "
+                                                               "operator, and report them per operator class in the timings "
+                                                               "files. Implies --timing. Needs permission to use perf events."},
+ {TRACE,    0, "",  "trace",    option::Arg::None, "  --trace  \tSupply to record a timeline of operators, MPI waits, probe flushes "
+                                                               "and log writes on every process, written to <log>_trace.json. "
+                                                               "Open it with chrome://tracing or ui.perfetto.dev."},
+ {MEMREPORT, 0, "", "memreport", option::Arg::None, "  --memreport  \tSupply to print the memory used before the simulation "
+                                                               "starts: signals, their initial values, operator state and "
+                                                               "probe buffers, and the peak resident set size."},
  {LOG,      0, "",  "log",      option::Arg::NonEmpty, "  --log  \tName of file to log results to using HDF5. "
                                                                "If not specified, the log filename is the same as the "
                                                                "name of the network file, but with the .h5 extension."},
  {SEED,     0, "",  "seed",     option::Arg::Numeric, "  --seed  \tSeed for stochastic processes in the network."},
+ {STREAM,   0, "",  "stream",   option::Arg::NonEmpty, "  --stream  \tName of a shared memory ring buffer to publish flushed probe data to, "
+                                                               "for watching probes while the simulation runs. One buffer, "
+                                                               "/<name>_<rank>, is created per process. Blocks are dropped "
+                                                               "if the reader falls behind."},
+ {SAVE_IMAGE, 0, "", "save-image", option::Arg::NonEmpty, "  --save-image  \tAfter loading the network file, save what each process read "
+                                                               "to a network image, <prefix>_<rank>.img, which later runs with the "
+                                                               "same number of processes can load with --load-image."},
+ {LOAD_IMAGE, 0, "", "load-image", option::Arg::NonEmpty, "  --load-image  \tLoad each process's part of the network from the image "
+                                                               "<prefix>_<rank>.img made by --save-image, instead of from the "
+                                                               "network file. Much faster for large networks."},
+ {BUILD_CACHE, 0, "", "build-cache", option::Arg::NonEmpty, "  --build-cache  \tDirectory for caching network images. If the directory holds "
+                                                               "images for this network file and number of processes, they are "
+                                                               "loaded; otherwise the network file is read and images are saved "
+                                                               "there for later runs."},
+ {FOLD_SIGNALS, 0, "", "fold-signals", option::Arg::None, "  --fold-signals  \tSupply to store read-only signals that have identical "
+                                                               "contents under different keys only once per process."},
  {UNKNOWN,  0, "" , ""   ,      option::Arg::None, "\nExamples:\n"
                                                    "  nengo_cpp --progress basal_ganglia.net 1.0\n"
                                                    "  nengo_cpp --log ~/spaun_results.h5 spaun.net 7.5\n" },
@@ -73,8 +104,16 @@ int main(int argc, char **argv){
     bool show_progress = !bool(options[NO_PROG]);
     cout << "Show progress bar: " << show_progress << endl;
 
-    bool collect_timings = bool(options[TIMING]);
+    bool perf_counters = bool(options[COUNTERS]);
+    bool collect_timings = bool(options[TIMING]) || bool(options[TIMING_EVERY]) || perf_counters;
     cout << "Collect timing info: " << collect_timings << endl;
+    cout << "Read hardware counters: " << perf_counters << endl;
+
+    unsigned timing_period = 1;
+    if(options[TIMING_EVERY]){
+        timing_period = max(boost::lexical_cast<unsigned>(options[TIMING_EVERY].arg), 1u);
+        cout << "Will time operators every " << timing_period << " steps." << endl;
+    }
 
     string log_filename;
     if(options[LOG]){
@@ -90,10 +129,48 @@ int main(int argc, char **argv){
     }
 
     cout << "Will simulate with seed: " << seed << endl;
+
+    string probe_stream_name;
+    if(options[STREAM]){
+        probe_stream_name = options[STREAM].arg;
+        cout << "Will stream probe data to shared memory: " << probe_stream_name << endl;
+    }
+
+    string network_image_name;
+    int network_image_mode = NETWORK_IMAGE_NONE;
+    if(options[SAVE_IMAGE]){
+        network_image_name = options[SAVE_IMAGE].arg;
+        network_image_mode = NETWORK_IMAGE_SAVE;
+        cout << "Will save network image: " << network_image_name << endl;
+    }else if(options[LOAD_IMAGE]){
+        network_image_name = options[LOAD_IMAGE].arg;
+        network_image_mode = NETWORK_IMAGE_LOAD;
+        cout << "Will load network image: " << network_image_name << endl;
+    }else if(options[BUILD_CACHE]){
+        network_image_name = options[BUILD_CACHE].arg;
+        network_image_mode = NETWORK_IMAGE_CACHE;
+        cout << "Will use build cache: " << network_image_name << endl;
+    }
+
+    bool fold_signals = bool(options[FOLD_SIGNALS]);
+    cout << "Fold identical read-only signals: " << fold_signals << endl;
+
+    bool trace = bool(options[TRACE]);
+    cout << "Record trace: " << trace << endl;
+
+    bool memory_report = bool(options[MEMREPORT]);
+    cout << "Report memory use: " << memory_report << endl;
     cout << endl;
 
     cout << "Building network..." << endl;
     auto sim = unique_ptr<Simulator>(new Simulator(collect_timings));
+    sim->set_probe_stream(probe_stream_name);
+    sim->set_network_image(network_image_name, network_image_mode);
+    sim->set_fold_signals(fold_signals);
+    sim->set_timing_period(timing_period);
+    sim->set_trace(trace);
+    sim->set_perf_counters(perf_counters);
+    sim->set_memory_report(memory_report);
     sim->from_file(net_filename);
     sim->finalize_build();
 
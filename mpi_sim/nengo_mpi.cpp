@@ -9,10 +9,14 @@
 
 #include "chunk.hpp"
 #include "mpi_simulator.hpp"
+#include "predict.hpp"
 
 using namespace std;
 
-enum serialOptionIndex {UNKNOWN, HELP, NO_PROG, TIMING, LOG, SEED, MERGED};
+enum serialOptionIndex {
+    UNKNOWN, HELP, NO_PROG, TIMING, LOG, SEED, MERGED, STREAM, LOG_PER_RANK, IO_SERVERS,
+    SAVE_IMAGE, LOAD_IMAGE, BUILD_CACHE, FOLD_SIGNALS, TIMING_EVERY, TRACE, COUNTERS,
+    RANK_COSTS, MEMREPORT, PREDICT, OP_COSTS, LATENCY, BANDWIDTH};
 
 const option::Descriptor serial_usage[] =
 {
@@ -24,15 +28,69 @@ const option::Descriptor serial_usage[] =
                                                    "Options:" },
  {HELP,     0, "" , "help",     option::Arg::None, "  --help  \tPrint usage and exit." },
  {NO_PROG,  0, "",  "noprog",   option::Arg::None, "  --noprog  \tSupply to omit the progress bar." },
- {TIMING,   0, "",  "timing",   option::Arg::None, "  --timing  \tSupply to collect timing info." },
+ {TIMING,   0, "",  "timing",   option::Arg::None, "  --timing  \tSupply to collect wall-clock timings of each step and operator. "
+                                                               "Each process writes them to <log>_timings_<rank>.json and .csv, "
+                                                               "where <log> is the log filename without its extension. Messages "
+                                                               "and MPI wait times between each pair of processes are "
+                                                               "written to <log>_comm.csv."},
+ {TIMING_EVERY, 0, "", "timing-every", option::Arg::Numeric, "  --timing-every  \tTime operators on every Nth step only, to keep the "
+                                                               "cost of timing low. Implies --timing. Defaults to 1."},
+ {COUNTERS, 0, "",  "counters", option::Arg::None, "  --counters  \tSupply to also read hardware performance counters (cycles, "
+                                                               "instructions, LLC misses, stalled cycles) around each timed "
+                                                               "operator, and report them per operator class in the timings "
+                                                               "files. Implies --timing. Needs permission to use perf events."},
+ {TRACE,    0, "",  "trace",    option::Arg::None, "  --trace  \tSupply to record a timeline of operators, MPI waits, probe flushes "
+                                                               "and log writes on every process, written to <log>_trace.json. "
+                                                               "Open it with chrome://tracing or ui.perfetto.dev."},
+ {MEMREPORT, 0, "", "memreport", option::Arg::None, "  --memreport  \tSupply to print the memory used by each process before the "
+                                                               "simulation starts: signals, their initial values, operator "
+                                                               "state, MPI and probe buffers, and the peak resident set size."},
  {LOG,      0, "",  "log",      option::Arg::NonEmpty, "  --log  \tName of file to log results to using HDF5. "
                                                                "If not specified, the log filename is the same as the "
                                                                "name of the network file, but with the .h5 extension."},
  {SEED,     0, "",  "seed",     option::Arg::Numeric, "  --seed  \tSeed for stochastic processes in the network."},
  {MERGED,   0, "",  "merged",   option::Arg::None, "  --merged  \tSupply to use merged communication mode."},
+ {STREAM,   0, "",  "stream",   option::Arg::NonEmpty, "  --stream  \tName of a shared memory ring buffer to publish flushed probe data to, "
+                                                               "for watching probes while the simulation runs. One buffer, "
+                                                               "/<name>_<rank>, is created per process. Blocks are dropped "
+                                                               "if the reader falls behind."},
+ {LOG_PER_RANK, 0, "", "log-per-rank", option::Arg::None, "  --log-per-rank  \tSupply to have each process write the probes it owns "
+                                                               "to its own file, <log>_<rank>.h5, using serial HDF5. The files can "
+                                                               "be combined afterwards with nengo_mpi_merge."},
+ {IO_SERVERS, 0, "", "io-servers", option::Arg::Numeric, "  --io-servers  \tNumber of processes to reserve for writing probe data to "
+                                                               "file. Simulating processes send their probe data to these "
+                                                               "I/O servers and continue without waiting for it to be written. "
+                                                               "The servers are the processes with the highest ranks."},
+ {SAVE_IMAGE, 0, "", "save-image", option::Arg::NonEmpty, "  --save-image  \tAfter loading the network file, save what each process read "
+                                                               "to a network image, <prefix>_<rank>.img, which later runs with the "
+                                                               "same number of processes can load with --load-image."},
+ {LOAD_IMAGE, 0, "", "load-image", option::Arg::NonEmpty, "  --load-image  \tLoad each process's part of the network from the image "
+                                                               "<prefix>_<rank>.img made by --save-image, instead of from the "
+                                                               "network file. Much faster for large networks."},
+ {BUILD_CACHE, 0, "", "build-cache", option::Arg::NonEmpty, "  --build-cache  \tDirectory for caching network images. If the directory holds "
+                                                               "images for this network file and number of processes, they are "
+                                                               "loaded; otherwise the network file is read and images are saved "
+                                                               "there for later runs."},
+ {FOLD_SIGNALS, 0, "", "fold-signals", option::Arg::None, "  --fold-signals  \tSupply to store read-only signals that have identical "
+                                                               "contents under different keys only once per process."},
+ {RANK_COSTS, 0, "", "rank-costs", option::Arg::NonEmpty, "  --rank-costs  \tFile to write the measured compute time of each process to, "
+                                                               "as CSV. Pass it to the work_balanced partitioner to weight "
+                                                               "the next partition by these costs."},
+ {PREDICT,  0, "",  "predict",  option::Arg::Numeric, "  --predict  \tPredict the step time of the network on the given number of "
+                                                               "processes, and exit without running it. Only the operators and "
+                                                               "signal shapes are read from the network file. The simulation "
+                                                               "time may be left out."},
+ {OP_COSTS, 0, "",  "op-costs", option::Arg::NonEmpty, "  --op-costs  \tCSV written by bench_ops on the machine the network will run "
+                                                               "on, to fit the cost of each operator class to for --predict. "
+                                                               "Built-in costs are used for classes it does not cover."},
+ {LATENCY,  0, "",  "latency",  option::Arg::NonEmpty, "  --latency  \tSeconds taken by each MPI message, for --predict. "
+                                                               "Defaults to 2e-6."},
+ {BANDWIDTH, 0, "", "bandwidth", option::Arg::NonEmpty, "  --bandwidth  \tBytes per second each process can send and receive, "
+                                                               "for --predict. Defaults to 5e9."},
  {UNKNOWN,  0, "" , ""   ,      option::Arg::None, "\nExamples:\n"
                                                    "  nengo_mpi --noprog basal_ganglia.net 1.0\n"
-                                                   "  nengo_mpi --log ~/spaun_results.h5 spaun.net 7.5\n" },
+                                                   "  nengo_mpi --log ~/spaun_results.h5 spaun.net 7.5\n"
+                                                   "  nengo_mpi --predict 64 --op-costs ops.csv spaun.net\n" },
  {0,0,0,0,0,0}
 };
 
@@ -53,13 +111,17 @@ int master_start(int argc, char **argv){
     }
 
     string net_filename;
-    float sim_length;
+    float sim_length = 0.0;
+
+    bool predict = bool(options[PREDICT]);
 
     // Handle mandatory options.
-    if(parse.nonOptionsCount() != 2){
+    if(parse.nonOptionsCount() != 2 && !(predict && parse.nonOptionsCount() == 1)){
         cout << "Please specify a network to simulate and a simulation time." << endl << endl;
         option::printUsage(std::cout, serial_usage);
         return 0;
+    }else if(parse.nonOptionsCount() == 1){
+        net_filename = parse.nonOptions()[0];
     }else{
         net_filename = parse.nonOptions()[0];
 
@@ -75,14 +137,52 @@ int master_start(int argc, char **argv){
         }
     }
 
+    if(predict){
+        int n_processors = boost::lexical_cast<int>(options[PREDICT].arg);
+        bool mpi_merged = bool(options[MERGED]);
+
+        OpCostModel op_costs;
+        if(options[OP_COSTS]){
+            cout << "Will fit operator costs to: " << options[OP_COSTS].arg << endl;
+            op_costs.read_bench_csv(options[OP_COSTS].arg);
+        }
+
+        MessageModel messages;
+        if(options[LATENCY]){
+            messages.latency = boost::lexical_cast<double>(options[LATENCY].arg);
+        }
+        if(options[BANDWIDTH]){
+            messages.bandwidth = boost::lexical_cast<double>(options[BANDWIDTH].arg);
+        }
+        cout << "Message latency: " << messages.latency << " s, bandwidth: "
+             << messages.bandwidth << " bytes/s" << endl;
+        cout << endl;
+
+        NetworkPrediction prediction = predict_network(
+            net_filename, n_processors, mpi_merged, op_costs, messages);
+        print_prediction(prediction, sim_length);
+
+        kill_workers();
+
+        return 0;
+    }
+
     cout << "Will load network from file: " << net_filename << "." << endl;
     cout << "Will run simulation for " << sim_length << " second(s)." << endl;
 
     bool show_progress = !bool(options[NO_PROG]);
     cout << "Show progress bar: " << show_progress << endl;
 
-    bool collect_timings = bool(options[TIMING]);
+    bool perf_counters = bool(options[COUNTERS]);
+    bool collect_timings = bool(options[TIMING]) || bool(options[TIMING_EVERY]) || perf_counters;
     cout << "Collect timing info: " << collect_timings << endl;
+    cout << "Read hardware counters: " << perf_counters << endl;
+
+    unsigned timing_period = 1;
+    if(options[TIMING_EVERY]){
+        timing_period = max(boost::lexical_cast<unsigned>(options[TIMING_EVERY].arg), 1u);
+        cout << "Will time operators every " << timing_period << " steps." << endl;
+    }
 
     bool mpi_merged = bool(options[MERGED]);
     cout << "Merged communication mode: " << mpi_merged << endl;
@@ -100,10 +200,65 @@ int master_start(int argc, char **argv){
         seed = boost::lexical_cast<unsigned>(options[SEED].arg);
     }
     cout << "Will simulate with seed: " << seed << endl;
+
+    string probe_stream_name;
+    if(options[STREAM]){
+        probe_stream_name = options[STREAM].arg;
+        cout << "Will stream probe data to shared memory: " << probe_stream_name << endl;
+    }
+
+    bool log_per_rank = bool(options[LOG_PER_RANK]);
+    cout << "Log to one file per process: " << log_per_rank << endl;
+
+    int n_io_servers = 0;
+    if(options[IO_SERVERS]){
+        n_io_servers = boost::lexical_cast<int>(options[IO_SERVERS].arg);
+    }
+    cout << "Number of I/O servers: " << n_io_servers << endl;
+
+    string network_image_name;
+    int network_image_mode = NETWORK_IMAGE_NONE;
+    if(options[SAVE_IMAGE]){
+        network_image_name = options[SAVE_IMAGE].arg;
+        network_image_mode = NETWORK_IMAGE_SAVE;
+        cout << "Will save network image: " << network_image_name << endl;
+    }else if(options[LOAD_IMAGE]){
+        network_image_name = options[LOAD_IMAGE].arg;
+        network_image_mode = NETWORK_IMAGE_LOAD;
+        cout << "Will load network image: " << network_image_name << endl;
+    }else if(options[BUILD_CACHE]){
+        network_image_name = options[BUILD_CACHE].arg;
+        network_image_mode = NETWORK_IMAGE_CACHE;
+        cout << "Will use build cache: " << network_image_name << endl;
+    }
+
+    bool fold_signals = bool(options[FOLD_SIGNALS]);
+    cout << "Fold identical read-only signals: " << fold_signals << endl;
+
+    bool trace = bool(options[TRACE]);
+    cout << "Record trace: " << trace << endl;
+
+    bool memory_report = bool(options[MEMREPORT]);
+    cout << "Report memory use: " << memory_report << endl;
+
+    string rank_cost_file;
+    if(options[RANK_COSTS]){
+        rank_cost_file = options[RANK_COSTS].arg;
+        cout << "Will write the cost of each process to: " << rank_cost_file << endl;
+    }
     cout << endl;
 
     cout << "Building network..." << endl;
-    auto sim = unique_ptr<MpiSimulator>(new MpiSimulator(mpi_merged, collect_timings));
+    auto sim = unique_ptr<MpiSimulator>(new MpiSimulator(mpi_merged, collect_timings, n_io_servers));
+    sim->set_probe_stream(probe_stream_name);
+    sim->set_log_per_rank(log_per_rank);
+    sim->set_network_image(network_image_name, network_image_mode);
+    sim->set_fold_signals(fold_signals);
+    sim->set_timing_period(timing_period);
+    sim->set_trace(trace);
+    sim->set_perf_counters(perf_counters);
+    sim->set_memory_report(memory_report);
+    sim->set_rank_cost_file(rank_cost_file);
     sim->from_file(net_filename);
     sim->finalize_build();
 
@@ -0,0 +1,504 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <exception>
+
+#include <mpi.h>
+#include <hdf5.h>
+
+#include "optionparser.h"
+
+#include "psim_log.hpp"
+
+using namespace std;
+
+/* Combines the files written by `nengo_mpi --log-per-rank` into a single
+ * file with the same layout as the file written by the shared parallel log.
+ * By default the data is copied into the new file using parallel HDF5 (on top
+ * of MPI-IO); the processes of the merge split the per-rank files between them.
+ * Alternatively, with --virtual, a small master file is written which refers
+ * to the per-rank files through HDF5 virtual datasets, and no data is copied. */
+
+enum mergeOptionIndex {UNKNOWN, HELP, OUT, VIRTUAL};
+
+const option::Descriptor merge_usage[] =
+{
+ {UNKNOWN, 0, "" , "",          option::Arg::None, "USAGE: nengo_mpi_merge [options] <log file> \n\n"
+                                                   "where <log file> is the name of the log passed to nengo_mpi along\n"
+                                                   "with --log-per-rank. The per-process files <log>_<rank>.h5 are\n"
+                                                   "combined into a single file. Can be run with any number of processes.\n"
+                                                   "Options:" },
+ {HELP,     0, "" , "help",     option::Arg::None, "  --help  \tPrint usage and exit." },
+ {OUT,      0, "",  "out",      option::Arg::NonEmpty, "  --out  \tName of the merged file. Defaults to <log file>."},
+ {VIRTUAL,  0, "",  "virtual",  option::Arg::None, "  --virtual  \tWrite a master file made of virtual datasets that "
+                                                   "refer to the per-process files, instead of copying the data."},
+ {UNKNOWN,  0, "" , ""   ,      option::Arg::None, "\nExamples:\n"
+                                                   "  mpirun -np 4 nengo_mpi_merge results.h5\n"
+                                                   "  nengo_mpi_merge --virtual --out all.h5 results.h5\n" },
+ {0,0,0,0,0,0}
+};
+
+// Size of the blocks in which data is copied between files, in bytes.
+const size_t MERGE_BLOCK_SIZE = 64 * 1024 * 1024;
+
+// Description of one probe's data in one of the per-rank files.
+struct ProbeRecord{
+    string key;
+    string storage;
+    unsigned source;
+
+    // dense: shape of the dataset; events: n_samples, n_events
+    hsize_t dim0;
+    hsize_t dim1;
+
+    int n_cols;
+    dtype amplitude;
+    string name;
+
+    string to_line() const{
+        stringstream ss;
+        ss.precision(17);
+        ss << key << PROBE_DELIM << storage << PROBE_DELIM << source << PROBE_DELIM
+           << dim0 << PROBE_DELIM << dim1 << PROBE_DELIM << n_cols << PROBE_DELIM
+           << amplitude << PROBE_DELIM << name << endl;
+        return ss.str();
+    }
+
+    static ProbeRecord from_line(string line){
+        vector<string> tokens;
+        size_t start = 0;
+        for(int i = 0; i < 7; i++){
+            size_t end = line.find(PROBE_DELIM, start);
+            tokens.push_back(line.substr(start, end - start));
+            start = end + 1;
+        }
+
+        ProbeRecord r;
+        r.key = tokens[0];
+        r.storage = tokens[1];
+        r.source = boost::lexical_cast<unsigned>(tokens[2]);
+        r.dim0 = boost::lexical_cast<hsize_t>(tokens[3]);
+        r.dim1 = boost::lexical_cast<hsize_t>(tokens[4]);
+        r.n_cols = boost::lexical_cast<int>(tokens[5]);
+        r.amplitude = boost::lexical_cast<dtype>(tokens[6]);
+        r.name = line.substr(start);
+        return r;
+    }
+};
+
+string read_string_attr(hid_t obj_id, string attr_name){
+    hid_t att_id = H5Aopen(obj_id, attr_name.c_str(), H5P_DEFAULT);
+    hid_t type_id = H5Aget_type(att_id);
+
+    size_t size = H5Tget_size(type_id);
+    vector<char> buffer(size + 1, '\0');
+    H5Aread(att_id, type_id, buffer.data());
+
+    H5Tclose(type_id);
+    H5Aclose(att_id);
+
+    return string(buffer.data());
+}
+
+unsigned read_uint_attr(hid_t obj_id, string attr_name){
+    unsigned value;
+    hid_t att_id = H5Aopen(obj_id, attr_name.c_str(), H5P_DEFAULT);
+    H5Aread(att_id, H5T_NATIVE_UINT, &value);
+    H5Aclose(att_id);
+    return value;
+}
+
+void write_string_attr(hid_t obj_id, string attr_name, string value){
+    hid_t str_type = H5Tcopy(H5T_C_S1);
+    H5Tset_size(str_type, MAX_PROBE_NAME_LENGTH);
+    H5Tset_strpad(str_type, H5T_STR_NULLTERM);
+
+    hid_t att_dataspace_id = H5Screate(H5S_SCALAR);
+    hid_t att_id = H5Acreate2(obj_id, attr_name.c_str(), str_type, att_dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
+    H5Awrite(att_id, str_type, value.substr(0, MAX_PROBE_NAME_LENGTH - 1).c_str());
+
+    H5Aclose(att_id);
+    H5Sclose(att_dataspace_id);
+    H5Tclose(str_type);
+}
+
+void write_scalar_attr(hid_t obj_id, string attr_name, hid_t type_id, const void* value){
+    hid_t att_dataspace_id = H5Screate(H5S_SCALAR);
+    hid_t att_id = H5Acreate2(obj_id, attr_name.c_str(), type_id, att_dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
+    H5Awrite(att_id, type_id, value);
+    H5Aclose(att_id);
+    H5Sclose(att_dataspace_id);
+}
+
+hid_t open_rank_file(string log_filename, unsigned processor){
+    string fn = rank_log_filename(log_filename, processor);
+
+    H5E_BEGIN_TRY{
+        hid_t f = H5Fopen(fn.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+
+        if(f >= 0){
+            return f;
+        }
+    }H5E_END_TRY
+
+    stringstream msg;
+    msg << "Could not open per-process log file " << fn << "." << endl;
+    throw runtime_error(msg.str());
+}
+
+herr_t collect_record(hid_t group_id, const char* link_name, const H5L_info_t*, void* data){
+    vector<ProbeRecord>* records = (vector<ProbeRecord>*) data;
+
+    hid_t obj_id = H5Oopen(group_id, link_name, H5P_DEFAULT);
+    bool is_group = H5Iget_type(obj_id) == H5I_GROUP;
+    H5Oclose(obj_id);
+
+    ProbeRecord r;
+    r.key = link_name;
+    r.n_cols = 0;
+    r.amplitude = 0.0;
+
+    if(is_group){
+        hid_t probe_group = H5Gopen2(group_id, link_name, H5P_DEFAULT);
+
+        r.storage = read_string_attr(probe_group, "storage");
+        r.name = read_string_attr(probe_group, "name");
+
+        hid_t att_id = H5Aopen(probe_group, "n_cols", H5P_DEFAULT);
+        H5Aread(att_id, H5T_NATIVE_INT, &r.n_cols);
+        H5Aclose(att_id);
+
+        att_id = H5Aopen(probe_group, "amplitude", H5P_DEFAULT);
+        H5Aread(att_id, H5T_NATIVE_DOUBLE, &r.amplitude);
+        H5Aclose(att_id);
+
+        hsize_t dims[2];
+        hid_t dset_id = H5Dopen2(probe_group, "index", H5P_DEFAULT);
+        hid_t space_id = H5Dget_space(dset_id);
+        H5Sget_simple_extent_dims(space_id, dims, NULL);
+        r.dim0 = dims[0];
+        H5Sclose(space_id);
+        H5Dclose(dset_id);
+
+        dset_id = H5Dopen2(probe_group, "events", H5P_DEFAULT);
+        space_id = H5Dget_space(dset_id);
+        H5Sget_simple_extent_dims(space_id, dims, NULL);
+        r.dim1 = dims[0];
+        H5Sclose(space_id);
+        H5Dclose(dset_id);
+
+        H5Gclose(probe_group);
+
+    }else{
+        hid_t dset_id = H5Dopen2(group_id, link_name, H5P_DEFAULT);
+
+        r.storage = PROBE_STORAGE_DENSE;
+        r.name = read_string_attr(dset_id, "name");
+
+        hsize_t dims[2];
+        hid_t space_id = H5Dget_space(dset_id);
+        H5Sget_simple_extent_dims(space_id, dims, NULL);
+        r.dim0 = dims[0];
+        r.dim1 = dims[1];
+        H5Sclose(space_id);
+        H5Dclose(dset_id);
+    }
+
+    records->push_back(r);
+
+    return 0;
+}
+
+// Every process reads the probe records from a subset of the per-rank
+// files, then the records are exchanged so that all processes have all of them.
+vector<ProbeRecord> gather_records(string log_filename, unsigned n_processors, MPI_Comm comm){
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    stringstream local;
+    for(unsigned p = rank; p < n_processors; p += size){
+        hid_t f = open_rank_file(log_filename, p);
+
+        vector<ProbeRecord> records;
+        H5Literate(f, H5_INDEX_NAME, H5_ITER_INC, NULL, collect_record, &records);
+        H5Fclose(f);
+
+        for(auto& r : records){
+            r.source = p;
+            local << r.to_line();
+        }
+    }
+
+    string local_str = local.str();
+    int local_size = local_str.size();
+
+    vector<int> counts(size), displs(size, 0);
+    MPI_Allgather(&local_size, 1, MPI_INT, counts.data(), 1, MPI_INT, comm);
+
+    for(int i = 1; i < size; i++){
+        displs[i] = displs[i-1] + counts[i-1];
+    }
+
+    vector<char> all(displs[size-1] + counts[size-1] + 1, '\0');
+    MPI_Allgatherv(
+        (void*) local_str.data(), local_size, MPI_CHAR,
+        all.data(), counts.data(), displs.data(), MPI_CHAR, comm);
+
+    vector<ProbeRecord> records;
+    stringstream all_ss(string(all.data()));
+    string line;
+    while(getline(all_ss, line)){
+        if(line.length() > 0){
+            records.push_back(ProbeRecord::from_line(line));
+        }
+    }
+
+    return records;
+}
+
+// Copy all of `src_dset_id` into `dst_dset_id` in blocks along the first dimension.
+void copy_dataset(hid_t src_dset_id, hid_t dst_dset_id, hid_t xfer_plist){
+    hid_t src_space = H5Dget_space(src_dset_id);
+    int rank = H5Sget_simple_extent_ndims(src_space);
+
+    hsize_t dims[2] = {0, 1};
+    H5Sget_simple_extent_dims(src_space, dims, NULL);
+
+    hid_t type_id = H5Dget_type(src_dset_id);
+    size_t row_bytes = H5Tget_size(type_id) * (rank > 1 ? dims[1] : 1);
+    hsize_t rows_per_block = max(hsize_t(1), hsize_t(MERGE_BLOCK_SIZE / max(row_bytes, size_t(1))));
+
+    vector<char> buffer(min(rows_per_block, dims[0]) * row_bytes);
+    hid_t dst_space = H5Dget_space(dst_dset_id);
+
+    for(hsize_t row = 0; row < dims[0]; row += rows_per_block){
+        hsize_t offset[2] = {row, 0};
+        hsize_t count[2] = {min(rows_per_block, dims[0] - row), dims[1]};
+
+        hid_t mem_space = H5Screate_simple(rank, count, NULL);
+
+        H5Sselect_hyperslab(src_space, H5S_SELECT_SET, offset, NULL, count, NULL);
+        H5Dread(src_dset_id, type_id, mem_space, src_space, H5P_DEFAULT, buffer.data());
+
+        H5Sselect_hyperslab(dst_space, H5S_SELECT_SET, offset, NULL, count, NULL);
+        H5Dwrite(dst_dset_id, type_id, mem_space, dst_space, xfer_plist, buffer.data());
+
+        H5Sclose(mem_space);
+    }
+
+    H5Sclose(dst_space);
+    H5Tclose(type_id);
+    H5Sclose(src_space);
+}
+
+hid_t create_dataset(hid_t loc_id, string name, hid_t type_id, int rank, hsize_t* dims, hid_t dcpl){
+    hid_t space_id = H5Screate_simple(rank, dims, NULL);
+    hid_t dset_id = H5Dcreate2(loc_id, name.c_str(), type_id, space_id, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+    H5Sclose(space_id);
+    return dset_id;
+}
+
+// Datasets making up the data for a probe in the merged file, paired
+// with their paths in the per-rank file.
+vector<pair<hid_t, string>> create_probe(hid_t file_id, const ProbeRecord& r, string source_file, bool virt){
+    vector<pair<hid_t, string>> dsets;
+
+    // (path, type, rank, dims) of each dataset for this probe
+    struct Layout{ string path; hid_t type; int rank; hsize_t dims[2]; };
+    vector<Layout> layouts;
+
+    hid_t attr_loc;
+
+    if(r.storage == PROBE_STORAGE_EVENTS){
+        attr_loc = H5Gcreate2(file_id, r.key.c_str(), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+
+        write_string_attr(attr_loc, "name", r.name);
+        write_string_attr(attr_loc, "storage", r.storage);
+        write_scalar_attr(attr_loc, "n_cols", H5T_NATIVE_INT, &r.n_cols);
+        write_scalar_attr(attr_loc, "amplitude", H5T_NATIVE_DOUBLE, &r.amplitude);
+
+        layouts.push_back({r.key + "/events", H5T_NATIVE_UINT, 2, {r.dim1, 2}});
+        layouts.push_back({r.key + "/index", H5T_NATIVE_ULLONG, 1, {r.dim0, 0}});
+    }else{
+        layouts.push_back({r.key, H5T_NATIVE_DOUBLE, 2, {r.dim0, r.dim1}});
+    }
+
+    for(auto& l : layouts){
+        hid_t dcpl = H5P_DEFAULT;
+
+        if(virt){
+#if H5_VERSION_GE(1, 10, 0)
+            dcpl = H5Pcreate(H5P_DATASET_CREATE);
+            hid_t space_id = H5Screate_simple(l.rank, l.dims, NULL);
+            H5Pset_virtual(dcpl, space_id, source_file.c_str(), l.path.c_str(), space_id);
+            H5Sclose(space_id);
+#else
+            throw runtime_error("Virtual datasets require HDF5 1.10 or later.");
+#endif
+        }
+
+        hid_t dset_id = create_dataset(file_id, l.path, l.type, l.rank, l.dims, dcpl);
+
+        if(dcpl != H5P_DEFAULT){
+            H5Pclose(dcpl);
+        }
+
+        dsets.push_back(make_pair(dset_id, l.path));
+    }
+
+    if(r.storage == PROBE_STORAGE_EVENTS){
+        H5Gclose(attr_loc);
+    }else{
+        write_string_attr(dsets[0].first, "name", r.name);
+    }
+
+    return dsets;
+}
+
+string dirname_of(string path){
+    size_t slash = path.find_last_of('/');
+    return slash == string::npos ? "" : path.substr(0, slash + 1);
+}
+
+void merge_virtual(string log_filename, string out_filename, const vector<ProbeRecord>& records){
+    hid_t file_id = H5Fcreate(out_filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+
+    for(auto& r : records){
+        // Sources are found relative to the master file when it is in the same directory.
+        string source_file = rank_log_filename(log_filename, r.source);
+        if(dirname_of(source_file) == dirname_of(out_filename)){
+            source_file = source_file.substr(dirname_of(source_file).length());
+        }
+
+        for(auto& d : create_probe(file_id, r, source_file, true)){
+            H5Dclose(d.first);
+        }
+    }
+
+    H5Fclose(file_id);
+}
+
+void merge_copy(string log_filename, string out_filename, const vector<ProbeRecord>& records, MPI_Comm comm){
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    hid_t fapl = H5Pcreate(H5P_FILE_ACCESS);
+    H5Pset_fapl_mpio(fapl, comm, MPI_INFO_NULL);
+    hid_t file_id = H5Fcreate(out_filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, fapl);
+    H5Pclose(fapl);
+
+    hid_t xfer_plist = H5Pcreate(H5P_DATASET_XFER);
+    H5Pset_dxpl_mpio(xfer_plist, H5FD_MPIO_INDEPENDENT);
+
+    // Dataset creation is collective, so every process creates every
+    // dataset, but only copies the data that came from its own files.
+    map<unsigned, vector<pair<hid_t, string>>> to_copy;
+    vector<hid_t> all_dsets;
+
+    for(auto& r : records){
+        auto dsets = create_probe(file_id, r, "", false);
+
+        for(auto& d : dsets){
+            all_dsets.push_back(d.first);
+
+            if(int(r.source % size) == rank){
+                to_copy[r.source].push_back(d);
+            }
+        }
+    }
+
+    for(auto& kv : to_copy){
+        hid_t src_file = open_rank_file(log_filename, kv.first);
+
+        for(auto& d : kv.second){
+            hid_t src_dset = H5Dopen2(src_file, d.second.c_str(), H5P_DEFAULT);
+            copy_dataset(src_dset, d.first, xfer_plist);
+            H5Dclose(src_dset);
+        }
+
+        H5Fclose(src_file);
+    }
+
+    for(hid_t d : all_dsets){
+        H5Dclose(d);
+    }
+
+    H5Pclose(xfer_plist);
+    H5Fclose(file_id);
+}
+
+int merge(int argc, char **argv, MPI_Comm comm){
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    argc -= (argc > 0); argv += (argc > 0); // skip program name argv[0] if present
+    option::Stats  stats(merge_usage, argc, argv);
+    option::Option options[stats.options_max], buffer[stats.buffer_max];
+    option::Parser parse(merge_usage, argc, argv, options, buffer);
+
+    if (parse.error()){
+        return 1;
+    }
+
+    if (options[HELP] || argc == 0 || parse.nonOptionsCount() != 1) {
+        if(rank == 0){
+            option::printUsage(std::cout, merge_usage);
+        }
+        return 0;
+    }
+
+    string log_filename = parse.nonOptions()[0];
+    string out_filename = options[OUT] ? options[OUT].arg : log_filename;
+    bool virt = bool(options[VIRTUAL]);
+
+    unsigned n_processors = 0;
+    if(rank == 0){
+        hid_t f = open_rank_file(log_filename, 0);
+        n_processors = read_uint_attr(f, "n_processors");
+        H5Fclose(f);
+
+        cout << "Merging logs from " << n_processors << " processes into "
+             << out_filename << (virt ? " (virtual)." : ".") << endl;
+    }
+
+    MPI_Bcast(&n_processors, 1, MPI_UNSIGNED, 0, comm);
+
+    vector<ProbeRecord> records = gather_records(log_filename, n_processors, comm);
+
+    if(virt){
+        if(rank == 0){
+            merge_virtual(log_filename, out_filename, records);
+        }
+    }else{
+        merge_copy(log_filename, out_filename, records, comm);
+    }
+
+    if(rank == 0){
+        cout << "Merged " << records.size() << " probes." << endl;
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv){
+
+    MPI_Init(&argc, &argv);
+
+    int ret = 0;
+
+    try{
+        ret = merge(argc, argv, MPI_COMM_WORLD);
+    }catch(exception& e){
+        cout << "nengo_mpi_merge: " << e.what() << endl;
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    MPI_Finalize();
+
+    return ret;
+}
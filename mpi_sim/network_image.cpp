@@ -0,0 +1,478 @@
+#include "network_image.hpp"
+
+#include <fstream>
+#include <cstring>
+
+#include <iomanip>
+#include <cerrno>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// All sections start on a multiple of this many bytes.
+const uint64_t IMAGE_ALIGNMENT = 64;
+
+static uint64_t align_up(uint64_t n){
+    return (n + IMAGE_ALIGNMENT - 1) / IMAGE_ALIGNMENT * IMAGE_ALIGNMENT;
+}
+
+string network_image_filename(string prefix, int rank){
+    stringstream ss;
+    ss << prefix << "_" << rank << ".img";
+    return ss.str();
+}
+
+bool network_image_valid(string filename, int rank, int n_processors){
+    ifstream in(filename, ios::binary);
+
+    NetworkImageHeader header;
+    if(!in.read((char*) &header, sizeof(header))){
+        return false;
+    }
+
+    in.seekg(0, ios::end);
+    uint64_t size = in.tellg();
+
+    return header.magic == NETWORK_IMAGE_MAGIC && header.version == NETWORK_IMAGE_VERSION &&
+           header.file_size == size && int(header.rank) == rank &&
+           int(header.n_processors) == n_processors;
+}
+
+// The splitmix64 finalizer.
+static uint64_t mix64(uint64_t x){
+    x += 0x9e3779b97f4a7c15;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+    return x ^ (x >> 31);
+}
+
+uint64_t hash_network_file(string filename){
+    ifstream in(filename, ios::binary);
+
+    if(!in.good()){
+        stringstream msg;
+        msg << "Could not open network file " << filename << " for hashing.";
+        throw runtime_error(msg.str());
+    }
+
+    // Each 64-bit word (the last one zero-padded) is combined into the hash
+    // with the splitmix64 finalizer, in which every input bit affects every
+    // output bit. A plain multiplicative hash over words only carries
+    // changes upwards, so e.g. flips of the sign bits of two doubles cancel.
+    // The length is mixed in last so that files differing only in trailing
+    // zeros differ.
+    uint64_t hash = 0xcbf29ce484222325;
+    uint64_t length = 0;
+
+    vector<uint64_t> buffer(1 << 17);
+
+    while(in){
+        in.read((char*) buffer.data(), buffer.size() * sizeof(uint64_t));
+        size_t n_bytes = in.gcount();
+
+        size_t n_words = (n_bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+        if(n_bytes % sizeof(uint64_t)){
+            memset(
+                (char*) buffer.data() + n_bytes, 0, n_words * sizeof(uint64_t) - n_bytes);
+        }
+
+        for(size_t i = 0; i < n_words; i++){
+            hash = mix64(hash ^ buffer[i]);
+        }
+
+        length += n_bytes;
+    }
+
+    return mix64(hash ^ length);
+}
+
+string build_cache_prefix(
+        string cache_dir, string network_filename, int n_processors, bool merged){
+
+    if(mkdir(cache_dir.c_str(), 0755) != 0 && errno != EEXIST){
+        stringstream msg;
+        msg << "Could not create build cache directory " << cache_dir << ": " << strerror(errno);
+        throw runtime_error(msg.str());
+    }
+
+    struct stat st;
+    if(stat(network_filename.c_str(), &st) != 0){
+        stringstream msg;
+        msg << "Could not read the size of network file " << network_filename
+            << ": " << strerror(errno);
+        throw runtime_error(msg.str());
+    }
+
+    stringstream ss;
+    ss << cache_dir << "/" << hex << setw(16) << setfill('0')
+       << hash_network_file(network_filename) << dec << "_" << st.st_size
+       << "_" << n_processors;
+
+    if(merged){
+        ss << "_merged";
+    }
+
+    return ss.str();
+}
+
+// *** NetworkImageWriter ***
+
+void NetworkImageWriter::add_op(
+        string type_string, float index, const vector<NetworkImageArg>& op_args){
+
+    NetworkImageOp op;
+    op.type = add_string(type_string);
+    op.index = index;
+    op.first_arg = args.size();
+    op.n_args = op_args.size();
+
+    ops.push_back(op);
+    args.insert(args.end(), op_args.begin(), op_args.end());
+}
+
+void NetworkImageWriter::add_probe(const ProbeSpec& ps){
+    probes.push_back(add_string(ps.encode()));
+}
+
+uint64_t NetworkImageWriter::add_data(const dtype* values, size_t n){
+    uint64_t offset = data.size();
+    data.insert(data.end(), values, values + n);
+    return offset;
+}
+
+uint64_t NetworkImageWriter::add_string(const string& s){
+    uint64_t offset = strings.size();
+    strings.append(s);
+    strings.push_back('\0');
+    return offset;
+}
+
+void NetworkImageWriter::write(
+        string filename, int rank, int n_processors, dtype dt,
+        const map<key_type, shared_ptr<BaseSignal>>& signals,
+        const map<key_type, string>& labels,
+        const vector<ProbeSpec>& probe_info){
+
+    vector<NetworkImageSignal> signal_records;
+
+    for(auto& kv : signals){
+        const BaseSignal& sig = *kv.second;
+
+        NetworkImageSignal record;
+        record.key = kv.first;
+        record.shape1 = sig.size1();
+        record.shape2 = sig.size2();
+        record.data = add_data(&(sig.data()[0]), sig.data().size());
+        record.label = add_string(labels.at(kv.first));
+
+        signal_records.push_back(record);
+    }
+
+    vector<uint64_t> probe_info_strings;
+    for(const ProbeSpec& ps : probe_info){
+        probe_info_strings.push_back(add_string(ps.encode()));
+    }
+
+    NetworkImageHeader header;
+    memset(&header, 0, sizeof(header));
+
+    header.magic = NETWORK_IMAGE_MAGIC;
+    header.version = NETWORK_IMAGE_VERSION;
+    header.rank = rank;
+    header.n_processors = n_processors;
+    header.dt = dt;
+
+    uint64_t offset = align_up(sizeof(NetworkImageHeader));
+
+    header.n_signals = signal_records.size();
+    header.signals_offset = offset;
+    offset = align_up(offset + signal_records.size() * sizeof(NetworkImageSignal));
+
+    header.n_ops = ops.size();
+    header.ops_offset = offset;
+    offset = align_up(offset + ops.size() * sizeof(NetworkImageOp));
+
+    header.n_args = args.size();
+    header.args_offset = offset;
+    offset = align_up(offset + args.size() * sizeof(NetworkImageArg));
+
+    header.n_probes = probes.size();
+    header.probes_offset = offset;
+    offset = align_up(offset + probes.size() * sizeof(uint64_t));
+
+    header.n_probe_info = probe_info_strings.size();
+    header.probe_info_offset = offset;
+    offset = align_up(offset + probe_info_strings.size() * sizeof(uint64_t));
+
+    header.strings_size = strings.size();
+    header.strings_offset = offset;
+    offset = align_up(offset + strings.size());
+
+    header.data_size = data.size();
+    header.data_offset = offset;
+    offset += data.size() * sizeof(dtype);
+
+    header.file_size = offset;
+
+    // Write to a temporary file and rename it into place, so that a
+    // concurrent reader never sees a partially written image.
+    string tmp_filename = filename + ".tmp";
+    ofstream out(tmp_filename, ios::binary | ios::trunc);
+
+    if(!out.good()){
+        stringstream msg;
+        msg << "Could not open " << tmp_filename << " for writing network image.";
+        throw runtime_error(msg.str());
+    }
+
+    auto write_section = [&](uint64_t section_offset, const void* src, uint64_t n_bytes){
+        uint64_t pos = out.tellp();
+        string padding(section_offset - pos, '\0');
+        out.write(padding.data(), padding.size());
+        out.write((const char*) src, n_bytes);
+    };
+
+    write_section(0, &header, sizeof(header));
+    write_section(
+        header.signals_offset, signal_records.data(),
+        signal_records.size() * sizeof(NetworkImageSignal));
+    write_section(header.ops_offset, ops.data(), ops.size() * sizeof(NetworkImageOp));
+    write_section(header.args_offset, args.data(), args.size() * sizeof(NetworkImageArg));
+    write_section(header.probes_offset, probes.data(), probes.size() * sizeof(uint64_t));
+    write_section(
+        header.probe_info_offset, probe_info_strings.data(),
+        probe_info_strings.size() * sizeof(uint64_t));
+    write_section(header.strings_offset, strings.data(), strings.size());
+    write_section(header.data_offset, data.data(), data.size() * sizeof(dtype));
+
+    out.close();
+
+    if(!out.good() || rename(tmp_filename.c_str(), filename.c_str()) != 0){
+        stringstream msg;
+        msg << "Could not write network image " << filename << ".";
+        throw runtime_error(msg.str());
+    }
+}
+
+// *** RecordingOpArgs ***
+
+NetworkImageArg& RecordingOpArgs::record(int i, NetworkImageArgKind kind) const{
+    NetworkImageArg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.position = i;
+    arg.kind = kind;
+
+    recorded.push_back(arg);
+    return recorded.back();
+}
+
+SignalSpec RecordingOpArgs::signal(int i) const{
+    SignalSpec ss = args.signal(i);
+
+    NetworkImageArg& arg = record(i, IMAGE_ARG_SIGNAL);
+    arg.integer = ss.key;
+    arg.shape1 = ss.shape1;
+    arg.shape2 = ss.shape2;
+    arg.stride1 = ss.stride1;
+    arg.stride2 = ss.stride2;
+    arg.offset = ss.offset;
+
+    return ss;
+}
+
+dtype RecordingOpArgs::real(int i) const{
+    dtype value = args.real(i);
+    record(i, IMAGE_ARG_REAL).real = value;
+    return value;
+}
+
+int RecordingOpArgs::integer(int i) const{
+    int value = args.integer(i);
+    record(i, IMAGE_ARG_INTEGER).integer = value;
+    return value;
+}
+
+key_type RecordingOpArgs::key(int i) const{
+    key_type value = args.key(i);
+    record(i, IMAGE_ARG_KEY).integer = value;
+    return value;
+}
+
+unique_ptr<BaseSignal> RecordingOpArgs::array(int i, bool get_size) const{
+    unique_ptr<BaseSignal> value = args.array(i, get_size);
+
+    NetworkImageArg& arg = record(i, IMAGE_ARG_ARRAY);
+    arg.shape1 = value->size1();
+    arg.shape2 = value->size2();
+    arg.integer = writer.add_data(&(value->data()[0]), value->data().size());
+
+    return value;
+}
+
+vector<int> RecordingOpArgs::index_vector(int i) const{
+    vector<int> value = args.index_vector(i);
+    vector<dtype> as_dtype(value.begin(), value.end());
+
+    NetworkImageArg& arg = record(i, IMAGE_ARG_INDEX_VECTOR);
+    arg.shape1 = value.size();
+    arg.shape2 = 1;
+    arg.integer = writer.add_data(as_dtype.data(), as_dtype.size());
+
+    return value;
+}
+
+string RecordingOpArgs::str(int i) const{
+    string value = args.str(i);
+    record(i, IMAGE_ARG_STRING).integer = writer.add_string(value);
+    return value;
+}
+
+// *** NetworkImage ***
+
+NetworkImage::NetworkImage(string filename)
+:filename(filename), base(NULL), size(0){
+
+    int fd = open(filename.c_str(), O_RDONLY);
+
+    if(fd < 0){
+        stringstream msg;
+        msg << "Could not open network image " << filename << ": " << strerror(errno);
+        throw runtime_error(msg.str());
+    }
+
+    struct stat st;
+    fstat(fd, &st);
+    size = st.st_size;
+
+    if(size < sizeof(NetworkImageHeader)){
+        close(fd);
+
+        stringstream msg;
+        msg << "File " << filename << " is too small to be a network image.";
+        throw runtime_error(msg.str());
+    }
+
+    // Writable so that signals placed in the image can be written; with
+    // MAP_PRIVATE the writes go to private copies of the pages, never to
+    // the file.
+    void* addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(addr == MAP_FAILED){
+        stringstream msg;
+        msg << "Could not map network image " << filename << ": " << strerror(errno);
+        throw runtime_error(msg.str());
+    }
+
+    base = (char*) addr;
+
+    const NetworkImageHeader& h = header();
+    if(h.magic != NETWORK_IMAGE_MAGIC || h.version != NETWORK_IMAGE_VERSION || h.file_size != size){
+        munmap((void*) base, size);
+        base = NULL;
+
+        stringstream msg;
+        msg << "File " << filename << " is not a network image of version "
+            << NETWORK_IMAGE_VERSION << ", or is truncated.";
+        throw runtime_error(msg.str());
+    }
+
+    if(h.data_size > 0){
+        register_signal_segment(base + h.data_offset, h.data_size * sizeof(dtype));
+    }
+}
+
+NetworkImage::~NetworkImage(){
+    if(base){
+        if(header().data_size > 0){
+            unregister_signal_segment(base + header().data_offset);
+        }
+
+        munmap((void*) base, size);
+    }
+}
+
+// *** ImageOpArgs ***
+
+const NetworkImageArg& ImageOpArgs::find(int i, NetworkImageArgKind kind) const{
+    const NetworkImageArg* op_args = image.args() + op.first_arg;
+
+    for(uint64_t j = 0; j < op.n_args; j++){
+        if(op_args[j].position == i){
+            if(op_args[j].kind != kind){
+                stringstream msg;
+                msg << "Argument " << i << " of " << image.strings() + op.type
+                    << " operator in network image " << image.filename
+                    << " was stored with a different type.";
+                throw logic_error(msg.str());
+            }
+
+            return op_args[j];
+        }
+    }
+
+    stringstream msg;
+    msg << "Argument " << i << " of " << image.strings() + op.type
+        << " operator not found in network image " << image.filename << ".";
+    throw out_of_range(msg.str());
+}
+
+SignalSpec ImageOpArgs::signal(int i) const{
+    const NetworkImageArg& arg = find(i, IMAGE_ARG_SIGNAL);
+
+    SignalSpec ss;
+    ss.key = arg.integer;
+    ss.shape1 = arg.shape1;
+    ss.shape2 = arg.shape2;
+    ss.stride1 = arg.stride1;
+    ss.stride2 = arg.stride2;
+    ss.offset = arg.offset;
+
+    return ss;
+}
+
+dtype ImageOpArgs::real(int i) const{
+    return find(i, IMAGE_ARG_REAL).real;
+}
+
+int ImageOpArgs::integer(int i) const{
+    return find(i, IMAGE_ARG_INTEGER).integer;
+}
+
+key_type ImageOpArgs::key(int i) const{
+    return find(i, IMAGE_ARG_KEY).integer;
+}
+
+unique_ptr<BaseSignal> ImageOpArgs::array(int i, bool) const{
+    const NetworkImageArg& arg = find(i, IMAGE_ARG_ARRAY);
+
+    unique_ptr<BaseSignal> result(new BaseSignal(arg.shape1, arg.shape2));
+    const dtype* src = image.data() + arg.integer;
+    copy(src, src + result->data().size(), result->data().begin());
+
+    return result;
+}
+
+vector<int> ImageOpArgs::index_vector(int i) const{
+    const NetworkImageArg& arg = find(i, IMAGE_ARG_INDEX_VECTOR);
+
+    const dtype* src = image.data() + arg.integer;
+    return vector<int>(src, src + arg.shape1);
+}
+
+string ImageOpArgs::str(int i) const{
+    return string(image.strings() + find(i, IMAGE_ARG_STRING).integer);
+}
+
+string ImageOpArgs::to_string() const{
+    stringstream out;
+
+    const NetworkImageArg* op_args = image.args() + op.first_arg;
+    for(uint64_t j = 0; j < op.n_args; j++){
+        out << op_args[j].position << ": kind " << op_args[j].kind << endl;
+    }
+
+    return out.str();
+}
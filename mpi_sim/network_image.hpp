@@ -0,0 +1,240 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <memory>
+#include <sstream>
+#include <exception>
+#include <cstdint>
+
+#include "operator.hpp"
+#include "spec.hpp"
+
+using namespace std;
+
+/* Network images.
+ *
+ * A network image is a flat binary file holding everything one process
+ * reads from a network file: its signals (with their initial values), the
+ * typed arguments of its operators, its probes and the global probe info.
+ * Loading an image is an mmap plus a pass over fixed-size records, with no
+ * HDF5 and no string parsing. An image is only valid for the network,
+ * number of processes and rank it was saved with.
+ *
+ * Layout: a NetworkImageHeader, followed by sections located by the
+ * offsets in the header (all offsets are bytes from the start of the file
+ * and 64-byte aligned). Records refer to each other and to the strings and
+ * data sections with indices/offsets rather than pointers, so the image
+ * can be used wherever it is mapped.
+ *
+ * A build cache directory holds images keyed by the network they were made
+ * from (see build_cache_prefix); a changed network file gets a new key, and
+ * an entry that is missing or unreadable is rebuilt from the network file. */
+
+const uint64_t NETWORK_IMAGE_MAGIC = 0x6e656e676f696d67; // "nengoimg"
+const uint32_t NETWORK_IMAGE_VERSION = 1;
+
+// Modes for MpiSimulatorChunk::set_network_image.
+const int NETWORK_IMAGE_NONE = 0;
+const int NETWORK_IMAGE_SAVE = 1;
+const int NETWORK_IMAGE_LOAD = 2;
+const int NETWORK_IMAGE_CACHE = 3;
+
+/* Name of the image file for the given rank: <prefix>_<rank>.img */
+string network_image_filename(string prefix, int rank);
+
+/* Whether `filename` is an image of the current version, saved by process
+ * `rank` of `n_processors`. False if the file does not exist. */
+bool network_image_valid(string filename, int rank, int n_processors);
+
+/* 64-bit hash of the contents of a network file. */
+uint64_t hash_network_file(string filename);
+
+/* Image prefix for a network in a build cache directory, creating the
+ * directory if necessary. Cached images are keyed by the hash and size of
+ * the network file, the number of processes and the communication mode:
+ * <cache_dir>/<hash>_<size>_<n_processors>[_merged] */
+string build_cache_prefix(
+    string cache_dir, string network_filename, int n_processors, bool merged);
+
+struct NetworkImageHeader{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t rank;
+    uint32_t n_processors;
+    uint32_t padding;
+    double dt;
+
+    uint64_t n_signals;    // NetworkImageSignal records
+    uint64_t signals_offset;
+    uint64_t n_ops;        // NetworkImageOp records
+    uint64_t ops_offset;
+    uint64_t n_args;       // NetworkImageArg records
+    uint64_t args_offset;
+    uint64_t n_probes;     // offsets into the strings section
+    uint64_t probes_offset;
+    uint64_t n_probe_info; // offsets into the strings section
+    uint64_t probe_info_offset;
+    uint64_t strings_size; // null-terminated strings
+    uint64_t strings_offset;
+    uint64_t data_size;    // number of dtype elements
+    uint64_t data_offset;
+
+    uint64_t file_size;
+};
+
+struct NetworkImageSignal{
+    uint64_t key;
+    uint32_t shape1;
+    uint32_t shape2;
+    uint64_t data;  // element offset into the data section
+    uint64_t label; // offset into the strings section
+};
+
+struct NetworkImageOp{
+    uint64_t type;  // offset into the strings section
+    double index;
+    uint64_t first_arg;
+    uint64_t n_args;
+};
+
+enum NetworkImageArgKind{
+    IMAGE_ARG_INTEGER, IMAGE_ARG_KEY, IMAGE_ARG_REAL, IMAGE_ARG_SIGNAL,
+    IMAGE_ARG_ARRAY, IMAGE_ARG_INDEX_VECTOR, IMAGE_ARG_STRING
+};
+
+/* One argument of an operator, as read by MpiSimulatorChunk::add_op. */
+struct NetworkImageArg{
+    int32_t position;
+    int32_t kind;
+
+    // Integer and key arguments, signal keys, and the offset of array
+    // (into data) and string (into strings) arguments.
+    int64_t integer;
+    double real;
+
+    // Signal arguments use all five, arrays use shape1 and shape2.
+    int32_t shape1;
+    int32_t shape2;
+    int32_t stride1;
+    int32_t stride2;
+    int32_t offset;
+    int32_t padding;
+};
+
+/* Accumulates the contents of an image while a chunk is built. */
+class NetworkImageWriter{
+public:
+    void add_op(string type_string, float index, const vector<NetworkImageArg>& op_args);
+    void add_probe(const ProbeSpec& ps);
+
+    uint64_t add_data(const dtype* values, size_t n);
+    uint64_t add_string(const string& s);
+
+    void write(
+        string filename, int rank, int n_processors, dtype dt,
+        const map<key_type, shared_ptr<BaseSignal>>& signals,
+        const map<key_type, string>& labels,
+        const vector<ProbeSpec>& probe_info);
+
+protected:
+    vector<NetworkImageOp> ops;
+    vector<NetworkImageArg> args;
+    vector<uint64_t> probes;
+    vector<dtype> data;
+    string strings;
+};
+
+/* OpArgs that forwards to another OpArgs and records every argument
+ * that is read, so that the operator can be rebuilt from an image. */
+class RecordingOpArgs: public OpArgs {
+public:
+    RecordingOpArgs(const OpArgs& args, NetworkImageWriter& writer)
+    :args(args), writer(writer){};
+
+    SignalSpec signal(int i) const override;
+    dtype real(int i) const override;
+    int integer(int i) const override;
+    key_type key(int i) const override;
+    unique_ptr<BaseSignal> array(int i, bool get_size) const override;
+    vector<int> index_vector(int i) const override;
+    string str(int i) const override;
+
+    string to_string() const override { return args.to_string(); }
+
+    mutable vector<NetworkImageArg> recorded;
+
+protected:
+    NetworkImageArg& record(int i, NetworkImageArgKind kind) const;
+
+    const OpArgs& args;
+    NetworkImageWriter& writer;
+};
+
+/* A private (copy-on-write) mapping of an image file. The data section is
+ * registered as a signal segment, so signals can be placed directly in the
+ * image (see MpiSimulatorChunk::from_image): pages nobody writes to stay
+ * shared with the page cache, and a page is only copied for this process
+ * when a signal on it is first written. Must outlive the signals placed in
+ * it. */
+class NetworkImage{
+public:
+    NetworkImage(string filename);
+    ~NetworkImage();
+
+    // Storage of a signal of the image, inside the mapping.
+    dtype* signal_storage(const NetworkImageSignal& signal){
+        return (dtype*) (base + header().data_offset) + signal.data;
+    }
+
+    // Whether `p` points into the data section of the image.
+    bool contains(const void* p) const{
+        const char* data_begin = base + header().data_offset;
+        const char* data_end = data_begin + header().data_size * sizeof(dtype);
+        return (const char*) p >= data_begin && (const char*) p < data_end;
+    }
+
+    const NetworkImageHeader& header() const { return *(const NetworkImageHeader*) base; }
+
+    const NetworkImageSignal* signals() const { return section<NetworkImageSignal>(header().signals_offset); }
+    const NetworkImageOp* ops() const { return section<NetworkImageOp>(header().ops_offset); }
+    const NetworkImageArg* args() const { return section<NetworkImageArg>(header().args_offset); }
+    const uint64_t* probes() const { return section<uint64_t>(header().probes_offset); }
+    const uint64_t* probe_info() const { return section<uint64_t>(header().probe_info_offset); }
+    const char* strings() const { return section<char>(header().strings_offset); }
+    const dtype* data() const { return section<dtype>(header().data_offset); }
+
+    string filename;
+
+protected:
+    template<class T> const T* section(uint64_t offset) const {
+        return (const T*) (base + offset);
+    }
+
+    char* base;
+    size_t size;
+};
+
+/* OpArgs that replays the arguments recorded for one operator of an image. */
+class ImageOpArgs: public OpArgs {
+public:
+    ImageOpArgs(const NetworkImage& image, const NetworkImageOp& op)
+    :image(image), op(op){};
+
+    SignalSpec signal(int i) const override;
+    dtype real(int i) const override;
+    int integer(int i) const override;
+    key_type key(int i) const override;
+    unique_ptr<BaseSignal> array(int i, bool get_size) const override;
+    vector<int> index_vector(int i) const override;
+    string str(int i) const override;
+
+    string to_string() const override;
+
+protected:
+    const NetworkImageArg& find(int i, NetworkImageArgKind kind) const;
+
+    const NetworkImage& image;
+    const NetworkImageOp& op;
+};
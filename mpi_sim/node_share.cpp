@@ -0,0 +1,182 @@
+#include "node_share.hpp"
+
+#include <array>
+#include <cstring>
+
+// A signal as seen by the other processes on a node: hash, size1, size2.
+typedef array<uint64_t, 3> SharedSignalId;
+
+struct SharedSignalEntry{
+    int owner;
+    int n_holders;
+    int last_holder;
+    uint64_t offset; // in elements, into the owner's part of the segment
+};
+
+NodeSharedSignals::NodeSharedSignals(
+        const map<key_type, shared_ptr<BaseSignal>>& candidates, MPI_Comm comm)
+:node_comm(MPI_COMM_NULL), win(MPI_WIN_NULL), n_node(1), rank_in_node(0), saved(0){
+
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node_comm);
+    MPI_Comm_size(node_comm, &n_node);
+    MPI_Comm_rank(node_comm, &rank_in_node);
+
+    if(n_node == 1){
+        MPI_Comm_free(&node_comm);
+        return;
+    }
+
+    vector<shared_ptr<BaseSignal>> local;
+    vector<uint64_t> local_ids;
+
+    for(auto& kv : candidates){
+        const BaseSignal& sig = *kv.second;
+
+        if(sig.size1() * sig.size2() >= NODE_SHARE_MIN_SIZE){
+            local.push_back(kv.second);
+            local_ids.push_back(hash_signal(sig));
+            local_ids.push_back(sig.size1());
+            local_ids.push_back(sig.size2());
+        }
+    }
+
+    int n_local = local_ids.size();
+    vector<int> counts(n_node), displs(n_node);
+    MPI_Allgather(&n_local, 1, MPI_INT, counts.data(), 1, MPI_INT, node_comm);
+
+    int n_total = 0;
+    for(int i = 0; i < n_node; i++){
+        displs[i] = n_total;
+        n_total += counts[i];
+    }
+
+    vector<uint64_t> ids(n_total);
+    MPI_Allgatherv(
+        local_ids.data(), n_local, MPI_UINT64_T,
+        ids.data(), counts.data(), displs.data(), MPI_UINT64_T, node_comm);
+
+    // Every process makes the same assignment from the gathered ids.
+    map<SharedSignalId, SharedSignalEntry> entries;
+
+    for(int r = 0; r < n_node; r++){
+        for(int i = displs[r]; i < displs[r] + counts[r]; i += 3){
+            SharedSignalId id = {{ids[i], ids[i+1], ids[i+2]}};
+            auto entry = entries.find(id);
+
+            if(entry == entries.end()){
+                entries[id] = {r, 1, r, 0};
+            }else if(entry->second.last_holder != r){
+                entry->second.n_holders++;
+                entry->second.last_holder = r;
+            }
+        }
+    }
+
+    vector<uint64_t> segment_sizes(n_node, 0);
+    for(auto& kv : entries){
+        if(kv.second.n_holders > 1){
+            kv.second.offset = segment_sizes[kv.second.owner];
+            segment_sizes[kv.second.owner] += kv.first[1] * kv.first[2];
+        }
+    }
+
+    uint64_t total_size = 0;
+    for(uint64_t size : segment_sizes){
+        total_size += size;
+    }
+
+    if(total_size == 0){
+        MPI_Comm_free(&node_comm);
+        return;
+    }
+
+    // Each owner allocates the part of the segment holding its signals.
+    dtype* base;
+    MPI_Win_allocate_shared(
+        segment_sizes[rank_in_node] * sizeof(dtype), sizeof(dtype),
+        MPI_INFO_NULL, node_comm, &base, &win);
+
+    vector<dtype*> parts(n_node);
+    for(int r = 0; r < n_node; r++){
+        MPI_Aint size;
+        int disp_unit;
+        MPI_Win_shared_query(win, r, &size, &disp_unit, &parts[r]);
+
+        if(size > 0){
+            register_signal_segment(parts[r], size);
+            bases.push_back(parts[r]);
+        }
+    }
+
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+
+    for(size_t i = 0; i < local.size(); i++){
+        SharedSignalId id = {{local_ids[3*i], local_ids[3*i+1], local_ids[3*i+2]}};
+        const SharedSignalEntry& entry = entries.at(id);
+
+        if(entry.n_holders > 1 && entry.owner == rank_in_node){
+            const auto& data = local[i]->data();
+            copy(data.begin(), data.end(), parts[rank_in_node] + entry.offset);
+        }
+    }
+
+    MPI_Win_sync(win);
+    MPI_Barrier(node_comm);
+    MPI_Win_sync(win);
+
+    int64_t freed = 0;
+
+    for(size_t i = 0; i < local.size(); i++){
+        SharedSignalId id = {{local_ids[3*i], local_ids[3*i+1], local_ids[3*i+2]}};
+        const SharedSignalEntry& entry = entries.at(id);
+
+        if(entry.n_holders == 1){
+            continue;
+        }
+
+        BaseSignal& sig = *local[i];
+        dtype* storage = parts[entry.owner] + entry.offset;
+        size_t n_bytes = sig.data().size() * sizeof(dtype);
+
+        // Guard against hash collisions.
+        if(memcmp(&sig.data()[0], storage, n_bytes) == 0){
+            place_signal(sig, storage);
+            shared.push_back(local[i]);
+            freed += n_bytes;
+        }
+    }
+
+    MPI_Win_unlock_all(win);
+
+    int64_t node_freed;
+    MPI_Allreduce(&freed, &node_freed, 1, MPI_INT64_T, MPI_SUM, node_comm);
+
+    saved = node_freed - int64_t(total_size * sizeof(dtype));
+}
+
+void NodeSharedSignals::release(){
+    if(win == MPI_WIN_NULL){
+        return;
+    }
+
+    for(auto& sig : shared){
+        // Copying allocates ordinary storage; the swap leaves the segment's
+        // storage with the copy, which does not free it.
+        BaseSignal copy(*sig);
+        sig->data().swap(copy.data());
+    }
+
+    shared.clear();
+
+    for(dtype* base : bases){
+        unregister_signal_segment(base);
+    }
+
+    bases.clear();
+
+    MPI_Win_free(&win);
+    MPI_Comm_free(&node_comm);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+#include <mpi.h>
+
+#include "operator.hpp"
+#include "utils.hpp"
+
+using namespace std;
+
+// Signals with fewer elements than this are not worth sharing.
+const size_t NODE_SHARE_MIN_SIZE = 256;
+
+/* Read-only signals stored once for all the processes on a node.
+ *
+ * Networks such as Spaun replicate the same weight matrices across many
+ * components, so processes on the same node often hold identical copies.
+ * Each process hashes its candidate signals and the hashes are gathered on
+ * the node. Every signal (shape and hash) held by at least two processes of
+ * the node is copied once, by the lowest rank holding it, into a segment
+ * allocated with MPI_Win_allocate_shared. Each process whose own copy is
+ * identical to the one in the segment then uses the segment instead (see
+ * place_signal), freeing its copy. Copies that only match by hash are kept.
+ *
+ * The candidate signals must never be written to while they are shared. */
+class NodeSharedSignals{
+public:
+    /* Collective over `comm`. */
+    NodeSharedSignals(const map<key_type, shared_ptr<BaseSignal>>& candidates, MPI_Comm comm);
+
+    /* Give the shared signals their own storage again and free the segment.
+     * Collective over the processes of `comm` on this node. If it is never
+     * called, the segment stays allocated until MPI is finalized. */
+    void release();
+
+    // Number of this process's signals stored in the segment.
+    size_t n_shared() const { return shared.size(); }
+
+    // Number of processes on this node, and this process's rank among them.
+    int node_size() const { return n_node; }
+    int node_rank() const { return rank_in_node; }
+
+    // Bytes of signal storage saved on this node, net of the segment itself.
+    int64_t bytes_saved() const { return saved; }
+
+protected:
+    MPI_Comm node_comm;
+    MPI_Win win;
+
+    int n_node;
+    int rank_in_node;
+    int64_t saved;
+
+    // Start of each non-empty part of the segment, for unregistering.
+    vector<dtype*> bases;
+
+    vector<shared_ptr<BaseSignal>> shared;
+};
@@ -0,0 +1,382 @@
+#include "op_table.hpp"
+
+#include <cstring>
+
+static hid_t signal_ref_type(){
+    hid_t t = H5Tcreate(H5T_COMPOUND, sizeof(OpTableSignalRef));
+    H5Tinsert(t, "key", HOFFSET(OpTableSignalRef, key), H5T_NATIVE_INT64);
+    H5Tinsert(t, "shape1", HOFFSET(OpTableSignalRef, shape1), H5T_NATIVE_INT32);
+    H5Tinsert(t, "shape2", HOFFSET(OpTableSignalRef, shape2), H5T_NATIVE_INT32);
+    H5Tinsert(t, "stride1", HOFFSET(OpTableSignalRef, stride1), H5T_NATIVE_INT32);
+    H5Tinsert(t, "stride2", HOFFSET(OpTableSignalRef, stride2), H5T_NATIVE_INT32);
+    H5Tinsert(t, "offset", HOFFSET(OpTableSignalRef, offset), H5T_NATIVE_INT32);
+    return t;
+}
+
+static hid_t array_ref_type(){
+    hid_t t = H5Tcreate(H5T_COMPOUND, sizeof(OpTableArrayRef));
+    H5Tinsert(t, "offset", HOFFSET(OpTableArrayRef, offset), H5T_NATIVE_INT64);
+    H5Tinsert(t, "size1", HOFFSET(OpTableArrayRef, size1), H5T_NATIVE_INT32);
+    H5Tinsert(t, "size2", HOFFSET(OpTableArrayRef, size2), H5T_NATIVE_INT32);
+    return t;
+}
+
+OpTable::OpTable(
+        hid_t group, string type_string,
+        shared_ptr<vector<dtype>> params, hid_t read_plist)
+:type_string(type_string), row_size(0), rows(0), params(params){
+
+    hid_t dset = H5Dopen(group, type_string.c_str(), H5P_DEFAULT);
+    hid_t file_type = H5Dget_type(dset);
+
+    int n_members = H5Tget_nmembers(file_type);
+
+    // Build an in-memory row type with the same member names as the file type,
+    // so that HDF5 converts whatever widths were written to native ones.
+    vector<hid_t> member_types;
+    vector<string> member_names;
+
+    for(int i = 0; i < n_members; i++){
+        char* name = H5Tget_member_name(file_type, i);
+        member_names.push_back(string(name));
+        H5free_memory(name);
+
+        H5T_class_t member_class = H5Tget_member_class(file_type, i);
+
+        OpTableField field;
+        hid_t member_type;
+
+        if(member_class == H5T_INTEGER){
+            field = OP_FIELD_INTEGER;
+            member_type = H5Tcopy(H5T_NATIVE_INT64);
+
+        }else if(member_class == H5T_FLOAT){
+            field = OP_FIELD_REAL;
+            member_type = H5Tcopy(H5T_NATIVE_DOUBLE);
+
+        }else if(member_class == H5T_COMPOUND){
+            hid_t nested = H5Tget_member_type(file_type, i);
+            bool is_signal = H5Tget_member_index(nested, "key") >= 0;
+            H5Tclose(nested);
+
+            if(is_signal){
+                field = OP_FIELD_SIGNAL;
+                member_type = signal_ref_type();
+            }else{
+                field = OP_FIELD_ARRAY;
+                member_type = array_ref_type();
+            }
+
+        }else{
+            stringstream msg;
+            msg << "Member " << member_names.back() << " of operator table "
+                << type_string << " has an unsupported type.";
+            throw runtime_error(msg.str());
+        }
+
+        offsets.push_back(row_size);
+        fields.push_back(field);
+        member_types.push_back(member_type);
+        row_size += field_size(field);
+    }
+
+    H5Tclose(file_type);
+
+    if(n_members == 0 || member_names[0] != "index" || fields[0] != OP_FIELD_REAL){
+        stringstream msg;
+        msg << "Operator table " << type_string << " does not begin with a float index.";
+        throw runtime_error(msg.str());
+    }
+
+    hid_t mem_type = H5Tcreate(H5T_COMPOUND, row_size);
+    for(int i = 0; i < n_members; i++){
+        H5Tinsert(mem_type, member_names[i].c_str(), offsets[i], member_types[i]);
+        H5Tclose(member_types[i]);
+    }
+
+    hid_t dspace = H5Dget_space(dset);
+    hsize_t shape[1];
+    H5Sget_simple_extent_dims(dspace, shape, NULL);
+    H5Sclose(dspace);
+
+    rows = shape[0];
+    data.resize(rows * row_size);
+
+    if(rows > 0){
+        herr_t err = H5Dread(dset, mem_type, H5S_ALL, H5S_ALL, read_plist, data.data());
+
+        if(err < 0){
+            stringstream msg;
+            msg << "Could not read operator table " << type_string << ".";
+            throw runtime_error(msg.str());
+        }
+    }
+
+    H5Tclose(mem_type);
+    H5Dclose(dset);
+}
+
+OpTable::OpTable(
+        string type_string, const vector<OpTableField>& fields,
+        const char* rows, size_t n_rows, shared_ptr<vector<dtype>> params)
+:type_string(type_string), fields(fields), row_size(0), rows(n_rows), params(params){
+
+    for(OpTableField field : fields){
+        offsets.push_back(row_size);
+        row_size += field_size(field);
+    }
+
+    if(fields.empty() || fields[0] != OP_FIELD_REAL){
+        stringstream msg;
+        msg << "Operator table " << type_string << " does not begin with a float index.";
+        throw runtime_error(msg.str());
+    }
+
+    data.assign(rows, rows + n_rows * row_size);
+}
+
+size_t OpTable::field_size(OpTableField field){
+    size_t size = 0;
+
+    switch(field){
+        case OP_FIELD_INTEGER:
+            size = sizeof(int64_t);
+            break;
+        case OP_FIELD_REAL:
+            size = sizeof(double);
+            break;
+        case OP_FIELD_SIGNAL:
+            size = sizeof(OpTableSignalRef);
+            break;
+        case OP_FIELD_ARRAY:
+            size = sizeof(OpTableArrayRef);
+            break;
+        default:{
+            stringstream msg;
+            msg << "Unknown operator table field kind " << field << ".";
+            throw runtime_error(msg.str());
+        }
+    }
+
+    // Keep every member 8-byte aligned.
+    return (size + 7) / 8 * 8;
+}
+
+OpTableRow::OpTableRow(const OpTable& table, size_t row)
+:table(table), data(table.data.data() + row * table.row_size){
+}
+
+const char* OpTableRow::field(int i) const{
+    // Argument i is stored after the index member.
+    if(i < 0 || i + 1 >= (int) table.fields.size()){
+        stringstream msg;
+        msg << "Operator table " << table.type_string << " has no argument " << i << ".";
+        throw out_of_range(msg.str());
+    }
+
+    return data + table.offsets[i + 1];
+}
+
+float OpTableRow::index() const{
+    double index;
+    memcpy(&index, data + table.offsets[0], sizeof(double));
+    return index;
+}
+
+SignalSpec OpTableRow::signal(int i) const{
+    if(table.fields[i + 1] != OP_FIELD_SIGNAL){
+        stringstream msg;
+        msg << "Argument " << i << " of operator table "
+            << table.type_string << " is not a signal reference.";
+        throw logic_error(msg.str());
+    }
+
+    OpTableSignalRef ref;
+    memcpy(&ref, field(i), sizeof(OpTableSignalRef));
+
+    SignalSpec ss;
+    ss.key = ref.key;
+    ss.shape1 = ref.shape1;
+    ss.shape2 = ref.shape2;
+    ss.stride1 = ref.stride1;
+    ss.stride2 = ref.stride2;
+    ss.offset = ref.offset;
+
+    return ss;
+}
+
+dtype OpTableRow::real(int i) const{
+    const char* f = field(i);
+
+    if(table.fields[i + 1] == OP_FIELD_REAL){
+        double value;
+        memcpy(&value, f, sizeof(double));
+        return value;
+    }else if(table.fields[i + 1] == OP_FIELD_INTEGER){
+        int64_t value;
+        memcpy(&value, f, sizeof(int64_t));
+        return value;
+    }
+
+    stringstream msg;
+    msg << "Argument " << i << " of operator table "
+        << table.type_string << " is not a number.";
+    throw logic_error(msg.str());
+}
+
+int OpTableRow::integer(int i) const{
+    return int(key(i));
+}
+
+key_type OpTableRow::key(int i) const{
+    if(table.fields[i + 1] == OP_FIELD_INTEGER){
+        int64_t value;
+        memcpy(&value, field(i), sizeof(int64_t));
+        return value;
+    }
+
+    return key_type(real(i));
+}
+
+OpTableArrayRef OpTableRow::array_ref(int i) const{
+    if(table.fields[i + 1] != OP_FIELD_ARRAY){
+        stringstream msg;
+        msg << "Argument " << i << " of operator table "
+            << table.type_string << " is not an array reference.";
+        throw logic_error(msg.str());
+    }
+
+    OpTableArrayRef ref;
+    memcpy(&ref, field(i), sizeof(OpTableArrayRef));
+
+    if(ref.offset < 0 || ref.size1 < 0 || ref.size2 < 0 ||
+       size_t(ref.offset) + size_t(ref.size1) * ref.size2 > table.params->size()){
+
+        stringstream msg;
+        msg << "Argument " << i << " of operator table " << table.type_string
+            << " refers to data outside of " << OP_TABLE_PARAMS << ".";
+        throw out_of_range(msg.str());
+    }
+
+    return ref;
+}
+
+unique_ptr<BaseSignal> OpTableRow::array(int i, bool) const{
+    OpTableArrayRef ref = array_ref(i);
+
+    unique_ptr<BaseSignal> result(new BaseSignal(ref.size1, ref.size2));
+    const dtype* src = table.params->data() + ref.offset;
+
+    for(int j = 0; j < ref.size1; j++){
+        for(int k = 0; k < ref.size2; k++){
+            (*result)(j, k) = src[j * ref.size2 + k];
+        }
+    }
+
+    return result;
+}
+
+vector<int> OpTableRow::index_vector(int i) const{
+    OpTableArrayRef ref = array_ref(i);
+
+    const dtype* src = table.params->data() + ref.offset;
+    return vector<int>(src, src + size_t(ref.size1) * ref.size2);
+}
+
+string OpTableRow::str(int) const{
+    stringstream msg;
+    msg << "Operator table " << table.type_string << " cannot store string arguments.";
+    throw logic_error(msg.str());
+}
+
+string OpTableRow::to_string() const{
+    stringstream out;
+
+    for(int i = 0; i + 1 < (int) table.fields.size(); i++){
+        out << i << ": ";
+
+        switch(table.fields[i + 1]){
+            case OP_FIELD_INTEGER:
+                out << key(i);
+                break;
+            case OP_FIELD_REAL:
+                out << real(i);
+                break;
+            case OP_FIELD_SIGNAL:{
+                SignalSpec ss = signal(i);
+                out << ss.key << ":" << ss.shape1 << "," << ss.shape2 << ":"
+                    << ss.stride1 << "," << ss.stride2 << ":" << ss.offset;
+                break;
+            }
+            case OP_FIELD_ARRAY:{
+                OpTableArrayRef ref;
+                memcpy(&ref, field(i), sizeof(OpTableArrayRef));
+                out << OP_TABLE_PARAMS << "[" << ref.offset << "], shape ("
+                    << ref.size1 << ", " << ref.size2 << ")";
+                break;
+            }
+        }
+
+        out << endl;
+    }
+
+    return out.str();
+}
+
+vector<unique_ptr<OpTable>> read_op_tables(hid_t component_group, hid_t read_plist){
+    hid_t group = H5Gopen(component_group, OP_TABLE_GROUP.c_str(), H5P_DEFAULT);
+
+    int version = 0;
+    hid_t attr = H5Aopen(group, "version", H5P_DEFAULT);
+    H5Aread(attr, H5T_NATIVE_INT, &version);
+    H5Aclose(attr);
+
+    if(version != OP_TABLE_VERSION){
+        stringstream msg;
+        msg << "Network file has operator tables of version " << version
+            << ", but this build of nengo_mpi reads version " << OP_TABLE_VERSION << ".";
+        throw runtime_error(msg.str());
+    }
+
+    // Array parameters shared by all tables in the group.
+    auto params = make_shared<vector<dtype>>();
+
+    hid_t dset = H5Dopen(group, OP_TABLE_PARAMS.c_str(), H5P_DEFAULT);
+    hid_t dspace = H5Dget_space(dset);
+    hsize_t shape[1];
+    H5Sget_simple_extent_dims(dspace, shape, NULL);
+    H5Sclose(dspace);
+
+    params->resize(shape[0]);
+    if(shape[0] > 0){
+        H5Dread(dset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, read_plist, params->data());
+    }
+    H5Dclose(dset);
+
+    H5G_info_t info;
+    H5Gget_info(group, &info);
+
+    vector<unique_ptr<OpTable>> tables;
+
+    for(hsize_t i = 0; i < info.nlinks; i++){
+        ssize_t name_size = H5Lget_name_by_idx(
+            group, ".", H5_INDEX_NAME, H5_ITER_INC, i, NULL, 0, H5P_DEFAULT);
+
+        vector<char> name(name_size + 1);
+        H5Lget_name_by_idx(
+            group, ".", H5_INDEX_NAME, H5_ITER_INC, i, name.data(), name_size + 1, H5P_DEFAULT);
+
+        string type_string(name.data());
+
+        if(type_string == OP_TABLE_PARAMS){
+            continue;
+        }
+
+        tables.push_back(unique_ptr<OpTable>(
+            new OpTable(group, type_string, params, read_plist)));
+    }
+
+    H5Gclose(group);
+
+    return tables;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <sstream>
+#include <exception>
+#include <cstdint>
+
+#include <hdf5.h>
+
+#include "operator.hpp"
+#include "spec.hpp"
+
+using namespace std;
+
+/* Binary operator tables.
+ *
+ * Networks written by model.py store the operators of each component in an
+ * ``op_tables'' group rather than (or alongside) the ``operators'' string
+ * list. The group has an integer ``version'' attribute and contains one
+ * compound dataset per operator type, named after the type (e.g. "LIF"),
+ * with one row per operator. The first member of each row is ``index'',
+ * the operator's position in the global ordering; the remaining members are
+ * the operator's arguments, in the same order as in the op string. Each
+ * argument member is one of:
+ *
+ *     integer          : fixed-width integer (read as int64)
+ *     float            : fixed-width float (read as float64)
+ *     signal reference : compound {key, shape1, shape2, stride1, stride2, offset}
+ *     array reference  : compound {offset, size1, size2}, pointing at a
+ *                        row-major (size1, size2) block of the float64
+ *                        ``op_params'' dataset in the same group.
+ *
+ * Operators that cannot be expressed this way (e.g. SpaunStimulus) remain in
+ * the ``operators'' string list. */
+
+const int OP_TABLE_VERSION = 1;
+const string OP_TABLE_GROUP = "op_tables";
+const string OP_TABLE_PARAMS = "op_params";
+
+struct OpTableSignalRef{
+    int64_t key;
+    int32_t shape1;
+    int32_t shape2;
+    int32_t stride1;
+    int32_t stride2;
+    int32_t offset;
+};
+
+struct OpTableArrayRef{
+    int64_t offset;
+    int32_t size1;
+    int32_t size2;
+};
+
+enum OpTableField{
+    OP_FIELD_INTEGER, OP_FIELD_REAL, OP_FIELD_SIGNAL, OP_FIELD_ARRAY
+};
+
+class OpTable;
+
+/* One row of an OpTable. Only valid while the table is alive. */
+class OpTableRow: public OpArgs {
+public:
+    OpTableRow(const OpTable& table, size_t row);
+
+    float index() const;
+
+    SignalSpec signal(int i) const override;
+    dtype real(int i) const override;
+    int integer(int i) const override;
+    key_type key(int i) const override;
+    unique_ptr<BaseSignal> array(int i, bool get_size) const override;
+    vector<int> index_vector(int i) const override;
+    string str(int i) const override;
+
+    string to_string() const override;
+
+protected:
+    const char* field(int i) const;
+    OpTableArrayRef array_ref(int i) const;
+
+    const OpTable& table;
+    const char* data;
+};
+
+/* All operators of one type belonging to a component. */
+class OpTable{
+public:
+    OpTable(
+        hid_t group, string type_string,
+        shared_ptr<vector<dtype>> params, hid_t read_plist);
+
+    /* A table whose `n_rows` rows are already laid out in memory (see
+     * field_size), as in a packed component. */
+    OpTable(
+        string type_string, const vector<OpTableField>& fields,
+        const char* rows, size_t n_rows, shared_ptr<vector<dtype>> params);
+
+    /* Number of bytes a field of the given kind takes up in a row. Fields
+     * are stored one after another, starting with ``index''. */
+    static size_t field_size(OpTableField field);
+
+    size_t n_rows() const { return rows; }
+    OpTableRow row(size_t i) const { return OpTableRow(*this, i); }
+
+    /* Number of arguments in each row (not counting ``index''), and the
+     * kind of argument i. */
+    int n_arguments() const { return int(fields.size()) - 1; }
+    OpTableField argument_kind(int i) const { return fields.at(i + 1); }
+
+    string type_string;
+
+protected:
+    friend class OpTableRow;
+
+    // Per-member kind and byte offset in the in-memory row, ``index'' first.
+    vector<OpTableField> fields;
+    vector<size_t> offsets;
+
+    size_t row_size;
+    size_t rows;
+    vector<char> data;
+
+    shared_ptr<vector<dtype>> params;
+};
+
+/* Read every operator table of a component. The component group must
+ * contain an op_tables group (check with H5Lexists first). */
+vector<unique_ptr<OpTable>> read_op_tables(hid_t component_group, hid_t read_plist);
@@ -476,6 +476,16 @@ void Synapse::reset(unsigned seed){
     }
 }
 
+size_t Synapse::state_bytes() const{
+    size_t n = signal_bytes(numer) + signal_bytes(denom);
+
+    for(size_t i = 0; i < x.size(); i++){
+        n += (x[i].capacity() + y[i].capacity()) * sizeof(dtype);
+    }
+
+    return n;
+}
+
 // ********************************************************************************
 TriangleSynapse::TriangleSynapse(
     SignalView input, SignalView output, dtype n0, dtype ndiff, int n_taps)
@@ -536,6 +546,16 @@ void TriangleSynapse::reset(unsigned seed){
     }
 }
 
+size_t TriangleSynapse::state_bytes() const{
+    size_t n = 0;
+
+    for(int i = 0; i < x.size(); i++){
+        n += x[i].capacity() * sizeof(dtype);
+    }
+
+    return n;
+}
+
 // ********************************************************************************
 WhiteNoise::WhiteNoise(
     SignalView output, dtype mean, dtype std, bool do_scale, bool inc, dtype dt)
@@ -1060,3 +1080,41 @@ string shape_string(const SignalView signal){
     ss << "(" << signal.size1() << ", " << signal.size2() << ")";
     return ss.str();
 }
+
+// ********************************************************************************
+// Registered signal segments, as (start, end) addresses. Only changed while no
+// operators are being built, so lookups from several threads are safe.
+static vector<pair<uintptr_t, uintptr_t>> signal_segments;
+
+void register_signal_segment(const void* base, size_t size){
+    uintptr_t start = (uintptr_t) base;
+    signal_segments.push_back({start, start + size});
+}
+
+void unregister_signal_segment(const void* base){
+    for(auto s = signal_segments.begin(); s != signal_segments.end(); s++){
+        if(s->first == (uintptr_t) base){
+            signal_segments.erase(s);
+            return;
+        }
+    }
+}
+
+bool in_signal_segment(const void* p){
+    uintptr_t address = (uintptr_t) p;
+
+    for(auto& s : signal_segments){
+        if(address >= s.first && address < s.second){
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void place_signal(BaseSignal& signal, dtype* storage){
+    // The allocator of `placed` hands out `storage`; once swapped, `placed`
+    // frees the signal's old storage.
+    array_type placed(signal.data().size(), SignalAllocator<dtype>(storage));
+    signal.data().swap(placed);
+}
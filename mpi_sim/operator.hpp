@@ -28,11 +28,75 @@ namespace ublas = boost::numeric::ublas;
 
 typedef double dtype;
 
-typedef ublas::unbounded_array<dtype> array_type;
-typedef ublas::matrix<dtype> BaseSignal;
+/* Register a segment of memory that signals may be placed in (see
+ * place_signal). Signals never free storage inside a registered segment. */
+void register_signal_segment(const void* base, size_t size);
+void unregister_signal_segment(const void* base);
+bool in_signal_segment(const void* p);
+
+/* A block of memory that signals can be placed in, registered for as long
+ * as it exists. Must outlive the signals placed in it. */
+class SignalSegment{
+public:
+    SignalSegment(size_t n): storage(new dtype[n]), n(n){
+        register_signal_segment(storage.get(), n * sizeof(dtype));
+    }
+
+    ~SignalSegment(){
+        unregister_signal_segment(storage.get());
+    }
+
+    dtype* data(){ return storage.get(); }
+
+    // Number of elements.
+    size_t size() const{ return n; }
+
+private:
+    unique_ptr<dtype[]> storage;
+    size_t n;
+};
+
+/* Allocator for the storage of BaseSignals. The same as std::allocator,
+ * except that it can hand out storage in a registered segment once (the
+ * placement), which it then never frees. */
+template<class T> class SignalAllocator: public std::allocator<T>{
+public:
+    template<class U> struct rebind{ typedef SignalAllocator<U> other; };
+
+    SignalAllocator(T* placement=nullptr): placement(placement){}
+
+    template<class U> SignalAllocator(const SignalAllocator<U>&): placement(nullptr){}
+
+    T* allocate(size_t n){
+        if(placement){
+            T* p = placement;
+            placement = nullptr;
+            return p;
+        }
+
+        return std::allocator<T>::allocate(n);
+    }
+
+    void deallocate(T* p, size_t n){
+        if(!in_signal_segment(p)){
+            std::allocator<T>::deallocate(p, n);
+        }
+    }
+
+private:
+    T* placement;
+};
+
+typedef ublas::unbounded_array<dtype, SignalAllocator<dtype>> array_type;
+typedef ublas::matrix<dtype, ublas::row_major, array_type> BaseSignal;
 typedef ublas::matrix_slice<BaseSignal> SignalView;
 typedef ublas::scalar_matrix<dtype> ScalarSignal;
 
+// Bytes of storage held by a BaseSignal.
+inline size_t signal_bytes(const BaseSignal& signal){
+    return signal.data().size() * sizeof(dtype);
+}
+
 /* Type of keys for various maps in the MpiSimulatorChunk. Keys are typically
  * addresses of python objects, so we need to use long long ints (64 bits). */
 typedef uintmax_t key_type;
@@ -73,6 +137,10 @@ public:
 
     virtual unsigned get_seed_modifier() const{ return unsigned(index); }
 
+    // Bytes of memory owned by the operator itself, such as filter histories
+    // and temporaries. Signals are owned by the chunk, so are not included.
+    virtual size_t state_bytes() const{ return 0; }
+
 protected:
     float index;
 };
@@ -117,6 +185,10 @@ public:
     void operator()();
     virtual string to_string() const;
 
+    virtual size_t state_bytes() const{
+        return (seq_A.capacity() + seq_B.capacity()) * sizeof(int);
+    }
+
 protected:
     SignalView B;
     SignalView A;
@@ -231,6 +303,8 @@ public:
 
     virtual void reset(unsigned seed);
 
+    virtual size_t state_bytes() const;
+
 protected:
     SignalView input;
     SignalView output;
@@ -254,6 +328,8 @@ public:
 
     virtual void reset(unsigned seed);
 
+    virtual size_t state_bytes() const;
+
 protected:
     SignalView input;
     SignalView output;
@@ -309,6 +385,8 @@ public:
 
     virtual void reset(unsigned seed);
 
+    virtual size_t state_bytes() const{ return signal_bytes(coefs); }
+
 protected:
     SignalView output;
     BaseSignal coefs;
@@ -327,6 +405,9 @@ public:
     void operator()();
     virtual string to_string() const;
 
+    // mult and dV are only sized on the first step.
+    virtual size_t state_bytes() const{ return 2 * n_neurons * sizeof(dtype); }
+
 protected:
     dtype dt;
     dtype dt_inv;
@@ -374,6 +455,8 @@ public:
     void operator()();
     virtual string to_string() const;
 
+    virtual size_t state_bytes() const{ return LIF::state_bytes() + n_neurons * sizeof(dtype); }
+
 protected:
     dtype tau_n;
     dtype inc_n;
@@ -392,6 +475,9 @@ public:
     void operator()();
     virtual string to_string() const;
 
+    // temp is only sized on the first step.
+    virtual size_t state_bytes() const{ return n_neurons * sizeof(dtype); }
+
 protected:
     dtype dt;
     dtype tau_n;
@@ -444,6 +530,9 @@ public:
     void operator()();
     virtual string to_string() const;
 
+    // dV, dU and voltage_squared are only sized on the first step.
+    virtual size_t state_bytes() const{ return 3 * n_neurons * sizeof(dtype); }
+
 protected:
     int n_neurons;
     dtype tau_recovery;
@@ -514,6 +603,8 @@ public:
     void operator()();
     virtual string to_string() const;
 
+    virtual size_t state_bytes() const{ return signal_bytes(scale); }
+
 protected:
     dtype alpha;
 
@@ -528,4 +619,9 @@ protected:
 
 string signal_to_string(const SignalView signal);
 string signal_to_string(const BaseSignal signal);
-string shape_string(const SignalView signal);
\ No newline at end of file
+string shape_string(const SignalView signal);
+
+/* Make `signal` use `storage`, which must lie in a registered segment and
+ * have room for all of its elements, instead of its own storage. The values
+ * in `storage` are kept, the signal's current values are discarded. */
+void place_signal(BaseSignal& signal, dtype* storage);
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include "perf_counters.hpp"
+
+#include <cstring>
+#include <cerrno>
+
+#if defined(__linux__) && !defined(NO_PERF_EVENTS)
+#define USE_PERF_EVENTS 1
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+const char* perf_counter_names[N_PERF_COUNTERS] = {
+    "cycles", "instructions", "llc_misses", "stalled_cycles_backend"};
+
+#ifdef USE_PERF_EVENTS
+
+static const uint64_t perf_counter_configs[N_PERF_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_STALLED_CYCLES_BACKEND};
+
+static int open_perf_event(uint64_t config, int group_fd){
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = group_fd < 0 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+
+    return syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+PerfCounters::PerfCounters()
+:n_open(0){
+    for(int c = 0; c < N_PERF_COUNTERS; c++){
+        fds[c] = -1;
+        group_index[c] = -1;
+    }
+
+    // Cycles lead the group; without them there is nothing to report.
+    for(int c = 0; c < N_PERF_COUNTERS; c++){
+        fds[c] = open_perf_event(perf_counter_configs[c], fds[PERF_CYCLES]);
+
+        if(fds[c] >= 0){
+            group_index[c] = n_open++;
+        }else if(c == PERF_CYCLES){
+            error_msg = string("perf_event_open failed: ") + strerror(errno);
+            return;
+        }
+    }
+}
+
+PerfCounters::~PerfCounters(){
+    for(int c = N_PERF_COUNTERS - 1; c >= 0; c--){
+        if(fds[c] >= 0){
+            close(fds[c]);
+        }
+    }
+}
+
+void PerfCounters::start(){
+    if(is_available()){
+        ioctl(fds[PERF_CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds[PERF_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+void PerfCounters::stop(){
+    if(is_available()){
+        ioctl(fds[PERF_CYCLES], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+void PerfCounters::read(PerfCounts& counts){
+    counts.fill(0);
+
+    if(!is_available()){
+        return;
+    }
+
+    // PERF_FORMAT_GROUP: the number of counters, then their values.
+    uint64_t values[N_PERF_COUNTERS + 1];
+    if(::read(fds[PERF_CYCLES], values, sizeof(values)) < 0){
+        return;
+    }
+
+    for(int c = 0; c < N_PERF_COUNTERS; c++){
+        if(group_index[c] >= 0){
+            counts[c] = values[group_index[c] + 1];
+        }
+    }
+}
+
+#else
+
+PerfCounters::PerfCounters()
+:n_open(0), error_msg("perf events are not supported on this platform"){
+    for(int c = 0; c < N_PERF_COUNTERS; c++){
+        fds[c] = -1;
+        group_index[c] = -1;
+    }
+}
+
+PerfCounters::~PerfCounters(){}
+void PerfCounters::start(){}
+void PerfCounters::stop(){}
+
+void PerfCounters::read(PerfCounts& counts){
+    counts.fill(0);
+}
+
+#endif
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <cstdint>
+
+using namespace std;
+
+// Hardware events counted for each operator. Not every processor (or
+// kernel) supports every event; see PerfCounters::counts.
+enum PerfCounter {
+    PERF_CYCLES, PERF_INSTRUCTIONS, PERF_LLC_MISSES, PERF_STALLED_CYCLES, N_PERF_COUNTERS};
+
+typedef array<uint64_t, N_PERF_COUNTERS> PerfCounts;
+
+// Names of the counters, as used in the timings files.
+extern const char* perf_counter_names[N_PERF_COUNTERS];
+
+/* Hardware performance counters for the calling thread, opened as one
+ * perf_event_open group so that all counters cover the same intervals.
+ * Only user-space events are counted, which unprivileged processes are
+ * usually allowed to do.
+ *
+ * If the counters cannot be opened (perf events not permitted, not
+ * supported by the processor or the platform, or disabled at build time
+ * with -DNO_PERF_EVENTS), is_available() is false, error() says why, and
+ * read() returns zeros. */
+class PerfCounters{
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    bool is_available() const { return fds[PERF_CYCLES] >= 0; }
+    bool counts(PerfCounter c) const { return fds[c] >= 0; }
+    string error() const { return error_msg; }
+
+    void start();
+    void stop();
+
+    // Current value of each counter since start; zero for counters that
+    // are not counted.
+    void read(PerfCounts& counts);
+
+private:
+    int fds[N_PERF_COUNTERS];
+
+    // Position of each counter in the group's read format.
+    int group_index[N_PERF_COUNTERS];
+    int n_open;
+
+    string error_msg;
+};
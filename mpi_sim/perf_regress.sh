@@ -0,0 +1,271 @@
+#!/bin/bash
+#
+# Performance regression check. Runs a fixed set of synthetic networks
+# (written by gen_network) through nengo_cpp, and through nengo_mpi at
+# several process counts, with --timing. The step, load and flush times are
+# read from the timings CSV files each process writes and compared with a
+# baseline. Each run is repeated and the fastest repeat kept, to filter out
+# interference from the rest of the machine. Exits with 1 if any metric is
+# slower than its baseline by more than the tolerance for that kind of
+# metric (and by more than its floor, in seconds), and with 2 if a run fails.
+#
+# Timings depend on the machine, so no baseline is committed. Make one on
+# the machine the check is run on with --update before the first check.
+#
+# Usage: perf_regress.sh [options]
+#   --bin DIR         Directory holding nengo_cpp, nengo_mpi and gen_network
+#                     (default: ~/nengo_mpi/bin).
+#   --baseline FILE   Baseline JSON (default: perf_baseline.json next to this
+#                     script).
+#   --procs "N ..."   Process counts to run nengo_mpi with (default: "2 4").
+#   --mpirun CMD      Command used to launch nengo_mpi (default: mpirun).
+#   --mpi-args ARGS   Extra options for nengo_mpi, e.g. "--merged".
+#   --time T          Simulated seconds per run (default: 1.0).
+#   --repeat N        Number of times to run each network (default: 3).
+#   --workdir DIR     Where networks and results are written (default: a
+#                     temporary directory, removed afterwards).
+#   --update          Write the measured metrics to the baseline instead of
+#                     comparing against it.
+
+BIN=${HOME}/nengo_mpi/bin
+BASELINE=$(dirname "$0")/perf_baseline.json
+PROCS="2 4"
+MPIRUN=mpirun
+MPI_ARGS=
+SIM_TIME=1.0
+REPEAT=3
+WORKDIR=
+UPDATE=0
+
+# Tolerances used when writing a new baseline: the fraction by which each
+# kind of metric may exceed its baseline. Load and flush times are short
+# and mostly I/O, so vary much more between runs than step times. The 99th
+# percentile comes from a histogram with buckets 25% apart.
+DEFAULT_TOLERANCES="step_mean=0.15 step_p99=0.6 load=0.5 flush=1.0"
+
+# Increases smaller than these, in seconds, are never regressions.
+DEFAULT_FLOORS="step_mean=0.00001 step_p99=0.0001 load=0.01 flush=0.005"
+
+# The networks: a name, then the gen_network options (--partitions is added).
+NETWORKS=(
+    "random --topology random --ensembles 256 --neurons 100 --dims 2 --fanout 4 --probed 0.1 --seed 1"
+    "grid --topology grid --ensembles 256 --neurons 100 --dims 2 --probed 0.1 --seed 2"
+    "stream --topology stream --ensembles 256 --streams 8 --neurons 100 --dims 2 --probed 0.1 --seed 3"
+)
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+        --bin) BIN=$2; shift ;;
+        --baseline) BASELINE=$2; shift ;;
+        --procs) PROCS=$2; shift ;;
+        --mpirun) MPIRUN=$2; shift ;;
+        --mpi-args) MPI_ARGS=$2; shift ;;
+        --time) SIM_TIME=$2; shift ;;
+        --repeat) REPEAT=$2; shift ;;
+        --workdir) WORKDIR=$2; shift ;;
+        --update) UPDATE=1 ;;
+        -h|--help) sed -n '2,/^$/s/^# \{0,1\}//p' "$0"; exit 0 ;;
+        *) echo "Unknown option: $1" >&2; exit 2 ;;
+    esac
+    shift
+done
+
+for exe in nengo_cpp nengo_mpi gen_network; do
+    if [ ! -x "${BIN}/${exe}" ]; then
+        echo "${BIN}/${exe} not found; build it first (make perf_check builds everything)." >&2
+        exit 2
+    fi
+done
+
+if [ ${UPDATE} -eq 0 ] && [ ! -f "${BASELINE}" ]; then
+    echo "Baseline ${BASELINE} not found; make one on this machine with --update (make perf_baseline)." >&2
+    exit 2
+fi
+
+if [ -z "${WORKDIR}" ]; then
+    WORKDIR=$(mktemp -d)
+    trap 'rm -rf "${WORKDIR}"' EXIT
+fi
+mkdir -p "${WORKDIR}"
+
+METRICS=${WORKDIR}/metrics.txt
+: > "${METRICS}"
+
+# Reduce the timings CSVs of one run (<prefix>_timings_<rank>.csv) to the
+# metrics of the slowest process: the mean and 99th percentile step time,
+# and the total load and flush time. Appends "<run>.<metric> <value>" lines
+# to `out`.
+collect_metrics(){
+    local run=$1 prefix=$2 out=$3
+
+    if ! ls "${prefix}"_timings_*.csv > /dev/null 2>&1; then
+        echo "No timings written by ${run}." >&2
+        exit 2
+    fi
+
+    # Columns: rank,scope,class,index,n_samples,total,mean,p50,p99,max
+    awk -F, -v run="${run}" '
+        $2 == "step"  { if($7 > step_mean) step_mean = $7; if($9 > step_p99) step_p99 = $9 }
+        $2 == "load"  { if($6 > load) load = $6 }
+        $2 == "flush" { if($6 > flush) flush = $6 }
+        END {
+            printf "%s.step_mean %.9g\n", run, step_mean
+            printf "%s.step_p99 %.9g\n", run, step_p99
+            printf "%s.load %.9g\n", run, load
+            printf "%s.flush %.9g\n", run, flush
+        }' "${prefix}"_timings_*.csv >> "${out}"
+}
+
+# Run one network with nengo_cpp (procs 1) or nengo_mpi.
+run_network(){
+    local name=$1 procs=$2
+    shift 2
+
+    local exe=mpi run=
+    [ "${procs}" -eq 1 ] && exe=cpp
+    run=${exe}_${name}_np${procs}
+
+    local net=${WORKDIR}/${run}.net
+    "${BIN}/gen_network" "$@" --partitions "${procs}" "${net}" > "${WORKDIR}/${run}_gen.txt" 2>&1 || {
+        echo "gen_network failed for ${run}; see ${WORKDIR}/${run}_gen.txt" >&2
+        exit 2
+    }
+
+    echo "Running ${run}..."
+
+    local repeats=${WORKDIR}/${run}_metrics.txt
+    : > "${repeats}"
+
+    for i in $(seq ${REPEAT}); do
+        local prefix=${WORKDIR}/${run}_${i}
+
+        if [ "${exe}" = cpp ]; then
+            "${BIN}/nengo_cpp" --noprog --timing --log "${prefix}.h5" "${net}" "${SIM_TIME}" \
+                > "${prefix}.txt" 2>&1
+        else
+            ${MPIRUN} -np "${procs}" "${BIN}/nengo_mpi" --noprog --timing ${MPI_ARGS} \
+                --log "${prefix}.h5" "${net}" "${SIM_TIME}" > "${prefix}.txt" 2>&1
+        fi || {
+            echo "${run} failed; see ${prefix}.txt" >&2
+            exit 2
+        }
+
+        collect_metrics "${run}" "${prefix}" "${repeats}"
+        rm -f "${prefix}"*.h5
+    done
+
+    # Keep the fastest repeat of each metric, in the order they were written.
+    awk '!($1 in best) { order[++n] = $1; best[$1] = $2 }
+         $2 < best[$1] { best[$1] = $2 }
+         END { for(i = 1; i <= n; i++) print order[i], best[order[i]] }' \
+        "${repeats}" >> "${METRICS}"
+}
+
+for network in "${NETWORKS[@]}"; do
+    set -- ${network}
+    name=$1
+    shift
+
+    run_network "${name}" 1 "$@"
+
+    for procs in ${PROCS}; do
+        run_network "${name}" "${procs}" "$@"
+    done
+done
+
+# Print "name=value" pairs as the members of a JSON object.
+json_members(){
+    local first=1
+    for t in "$@"; do
+        [ ${first} -eq 0 ] && echo ","
+        printf "    \"%s\": %s" "${t%%=*}" "${t#*=}"
+        first=0
+    done
+    echo
+}
+
+if [ ${UPDATE} -eq 1 ]; then
+    {
+        echo "{"
+        echo "  \"tolerances\": {"
+        json_members ${DEFAULT_TOLERANCES}
+        echo "  },"
+        echo "  \"floors\": {"
+        json_members ${DEFAULT_FLOORS}
+        echo "  },"
+        echo "  \"metrics\": {"
+        awk '{ printf "%s    \"%s\": %s", (NR > 1 ? ",\n" : ""), $1, $2 } END { print "" }' "${METRICS}"
+        echo "  }"
+        echo "}"
+    } > "${BASELINE}"
+
+    echo "Wrote baseline ${BASELINE}."
+    exit 0
+fi
+
+# The baseline is written one value per line (see --update), so is read a
+# line at a time: "<name>": <value> pairs inside the tolerances, floors and
+# metrics objects. These become "tol <kind> <value>", "floor <kind> <value>"
+# and "base <run>.<kind> <value>" lines.
+awk '
+    /"tolerances"/ { block = "tol"; next }
+    /"floors"/     { block = "floor"; next }
+    /"metrics"/    { block = "base"; next }
+    /^ *}/         { block = ""; next }
+    block != "" && /":/ {
+        line = $0
+        gsub(/[",]/, "", line)
+        split(line, kv, ":")
+        gsub(/ /, "", kv[1]); gsub(/ /, "", kv[2])
+        print block, kv[1], kv[2]
+    }' "${BASELINE}" > "${WORKDIR}/baseline.txt"
+
+cat "${WORKDIR}/baseline.txt" "${METRICS}" | awk '
+    $1 == "tol"   { tol[$2] = $3; next }
+    $1 == "floor" { floors[$2] = $3; next }
+    $1 == "base"  { base[$2] = $3; base_order[++n_base] = $2; next }
+    {
+        order[++n] = $1
+        value[$1] = $2
+    }
+    END {
+        regressions = 0
+        printf "%-28s %12s %12s %9s  %s\n", "metric", "baseline", "current", "change", "status"
+
+        for(i = 1; i <= n; i++){
+            m = order[i]
+            kind = m
+            sub(/^[^.]*\./, "", kind)
+
+            if(!(m in base)){
+                printf "%-28s %12s %12.6g %9s  %s\n", m, "-", value[m], "-", "new"
+                continue
+            }
+
+            limit = (kind in tol) ? tol[kind] : 0.25
+            min_increase = (kind in floors) ? floors[kind] : 0
+            change = base[m] > 0 ? value[m] / base[m] - 1 : 0
+
+            status = "ok"
+            if(change > limit && value[m] - base[m] > min_increase){
+                status = sprintf("REGRESSION (tolerance %+.0f%%)", 100 * limit)
+                regressions++
+            }
+
+            printf "%-28s %12.6g %12.6g %+8.1f%%  %s\n", m, base[m], value[m], 100 * change, status
+        }
+
+        for(i = 1; i <= n_base; i++){
+            m = base_order[i]
+            if(!(m in value)){
+                printf "%-28s %12.6g %12s %9s  %s\n", m, base[m], "-", "-", "not run"
+            }
+        }
+
+        if(regressions > 0){
+            printf "%d metric(s) regressed.\n", regressions
+            exit 1
+        }
+
+        print "No regressions."
+    }'
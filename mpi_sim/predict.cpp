@@ -0,0 +1,493 @@
+#include "predict.hpp"
+
+#include <set>
+#include <memory>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <exception>
+
+#include <hdf5.h>
+
+#include "spec.hpp"
+#include "op_table.hpp"
+
+// Fitted to bench_ops --sizes 16,64,256,1024 on a development machine.
+// Calibrate for the machine the network will run on with --op-costs.
+OpCostModel::OpCostModel()
+:default_cost({20.0, 5.0}),
+costs({
+    {"LIF", {184.0, 22.4}},
+    {"LIFRate", {61.0, 13.2}},
+    {"DotInc", {0.0, 6.2}},
+    {"ElementwiseInc", {37.0, 8.4}},
+    {"Copy", {4.0, 3.2}},
+    {"SlicedCopy", {4.0, 5.0}},
+    {"SimpleSynapse", {59.0, 7.2}},
+    {"Synapse", {17.0, 9.6}},
+    {"BCM", {327.0, 1.3}},
+    {"Oja", {182.0, 1.3}},
+    {"Voja", {0.0, 1.3}}}){}
+
+// Least squares fit of ns = fixed + per_element * elements, minimising the
+// relative rather than the absolute error so that the small sizes, which
+// have most of the fixed cost, are not swamped by the large ones. The fixed
+// cost is not allowed to be negative.
+static OpCost fit_op_cost(const vector<pair<double, double>>& points){
+    double sw = 0.0, swx = 0.0, swy = 0.0, swxx = 0.0, swxy = 0.0;
+
+    for(auto& p : points){
+        double x = p.first, y = p.second;
+
+        if(y <= 0.0){
+            continue;
+        }
+
+        double w = 1.0 / (y * y);
+        sw += w;
+        swx += w * x;
+        swy += w * y;
+        swxx += w * x * x;
+        swxy += w * x * y;
+    }
+
+    double det = sw * swxx - swx * swx;
+
+    if(det > 0.0){
+        double per_element = (sw * swxy - swx * swy) / det;
+        double fixed = (swy - per_element * swx) / sw;
+
+        if(fixed >= 0.0 && per_element >= 0.0){
+            return {fixed, per_element};
+        }
+    }
+
+    return {0.0, swxx > 0.0 ? swxy / swxx : 0.0};
+}
+
+void OpCostModel::read_bench_csv(string filename){
+    ifstream in(filename);
+
+    if(!in.good()){
+        stringstream msg;
+        msg << "Could not open operator cost file " << filename << ".";
+        throw runtime_error(msg.str());
+    }
+
+    auto split = [](const string& line){
+        vector<string> fields;
+        stringstream s(line);
+        string field;
+
+        while(getline(s, field, ',')){
+            fields.push_back(field);
+        }
+
+        return fields;
+    };
+
+    string line;
+    getline(in, line);
+    vector<string> header = split(line);
+
+    auto column = [&](string name){
+        auto it = find(header.begin(), header.end(), name);
+
+        if(it == header.end()){
+            stringstream msg;
+            msg << "Operator cost file " << filename << " has no " << name
+                << " column. Expected the CSV written by bench_ops.";
+            throw runtime_error(msg.str());
+        }
+
+        return int(it - header.begin());
+    };
+
+    int op_col = column("op");
+    int elements_col = column("elements");
+    int ns_col = column("ns_per_call");
+    int n_cols = max(op_col, max(elements_col, ns_col)) + 1;
+
+    map<string, vector<pair<double, double>>> points;
+
+    while(getline(in, line)){
+        vector<string> fields = split(line);
+
+        if(int(fields.size()) < n_cols){
+            continue;
+        }
+
+        try{
+            points[fields[op_col]].push_back({
+                boost::lexical_cast<double>(fields[elements_col]),
+                boost::lexical_cast<double>(fields[ns_col])});
+
+        }catch(const boost::bad_lexical_cast& e){
+            stringstream msg;
+            msg << "Could not read line of operator cost file " << filename
+                << ": " << line;
+            throw runtime_error(msg.str());
+        }
+    }
+
+    for(auto& kv : points){
+        costs[kv.first] = fit_op_cost(kv.second);
+    }
+}
+
+OpCost OpCostModel::cost(string type_string) const{
+    auto it = costs.find(type_string);
+    return it == costs.end() ? default_cost : it->second;
+}
+
+RankPrediction::RankPrediction()
+:n_components(0), n_ops(0), compute(0.0), n_sends(0), n_recvs(0),
+bytes_sent(0), bytes_received(0), comm(0.0){}
+
+int NetworkPrediction::bottleneck() const{
+    int slowest = 0;
+
+    for(int r = 1; r < int(ranks.size()); r++){
+        if(ranks[r].step() > ranks[slowest].step()){
+            slowest = r;
+        }
+    }
+
+    return slowest;
+}
+
+// Null-terminated strings stored in one dataset, as written for the
+// ``operators'' list of a component.
+static vector<string> read_string_list(hid_t group, string name){
+    hid_t str_type = H5Tcopy(H5T_C_S1);
+    H5Tset_strpad(str_type, H5T_STR_NULLPAD);
+
+    hid_t dset = H5Dopen(group, name.c_str(), H5P_DEFAULT);
+
+    int n_strings;
+    hid_t attr = H5Aopen(dset, "n_strings", H5P_DEFAULT);
+    H5Aread(attr, H5T_NATIVE_INT, &n_strings);
+    H5Aclose(attr);
+
+    hsize_t shape[1];
+    hid_t dspace = H5Dget_space(dset);
+    H5Sget_simple_extent_dims(dspace, shape, NULL);
+    H5Sclose(dspace);
+
+    vector<char> buffer(shape[0] + 1, '\0');
+    H5Dread(dset, str_type, H5S_ALL, H5S_ALL, H5P_DEFAULT, buffer.data());
+    H5Dclose(dset);
+    H5Tclose(str_type);
+
+    vector<string> strings;
+    const char* str_ptr = buffer.data();
+
+    for(int i = 0; i < n_strings; i++){
+        strings.push_back(string(str_ptr));
+        str_ptr += strings.back().size() + 1;
+    }
+
+    return strings;
+}
+
+// What is needed of one component: the number of elements in each of its
+// signals, and its operators.
+struct ComponentOps{
+    map<key_type, uint64_t> signal_sizes;
+    vector<unique_ptr<OpTable>> op_tables;
+    vector<string> op_strings;
+};
+
+static ComponentOps read_component_ops(hid_t f, int component){
+    ComponentOps ops;
+
+    stringstream ss;
+    ss << component;
+    hid_t group = H5Gopen(f, ss.str().c_str(), H5P_DEFAULT);
+
+    hsize_t shape[2];
+    hid_t dset = H5Dopen(group, "signal_keys", H5P_DEFAULT);
+    hid_t dspace = H5Dget_space(dset);
+    H5Sget_simple_extent_dims(dspace, shape, NULL);
+    H5Sclose(dspace);
+
+    hsize_t n_signals = shape[0];
+    vector<key_type> keys(n_signals);
+    vector<short> shapes(2 * n_signals);
+
+    if(n_signals > 0){
+        H5Dread(dset, H5T_NATIVE_LLONG, H5S_ALL, H5S_ALL, H5P_DEFAULT, keys.data());
+    }
+    H5Dclose(dset);
+
+    dset = H5Dopen(group, "signal_shapes", H5P_DEFAULT);
+    if(n_signals > 0){
+        H5Dread(dset, H5T_NATIVE_SHORT, H5S_ALL, H5S_ALL, H5P_DEFAULT, shapes.data());
+    }
+    H5Dclose(dset);
+
+    for(hsize_t i = 0; i < n_signals; i++){
+        ops.signal_sizes[keys[i]] = uint64_t(shapes[2*i]) * shapes[2*i + 1];
+    }
+
+    if(H5Lexists(group, OP_TABLE_GROUP.c_str(), H5P_DEFAULT) > 0){
+        ops.op_tables = read_op_tables(group, H5P_DEFAULT);
+    }
+
+    ops.op_strings = read_string_list(group, "operators");
+
+    H5Gclose(group);
+    return ops;
+}
+
+// Elements of the largest signal an operator works on, or 1 if it has none.
+// Signal arguments of op strings are the ones of the form
+// key:shape:stride:offset; no other kind of argument contains the delimiter.
+static uint64_t op_elements(const OpSpec& spec){
+    uint64_t elements = 1;
+
+    for(const string& arg : spec.arguments){
+        if(count(arg.begin(), arg.end(), SIGNAL_DELIM[0]) != 3){
+            continue;
+        }
+
+        try{
+            SignalSpec ss(arg);
+            elements = max(elements, uint64_t(ss.shape1) * ss.shape2);
+        }catch(const logic_error& e){
+        }
+    }
+
+    return elements;
+}
+
+static uint64_t op_elements(const OpTable& table, const OpTableRow& row){
+    uint64_t elements = 1;
+
+    for(int i = 0; i < table.n_arguments(); i++){
+        if(table.argument_kind(i) == OP_FIELD_SIGNAL){
+            SignalSpec ss = row.signal(i);
+            elements = max(elements, uint64_t(ss.shape1) * ss.shape2);
+        }
+    }
+
+    return elements;
+}
+
+// Accumulates the operators and messages of each process.
+class PredictionBuilder{
+public:
+    PredictionBuilder(NetworkPrediction& prediction, const OpCostModel& op_costs)
+    :prediction(prediction), op_costs(op_costs),
+    send_peers(prediction.n_processors), recv_peers(prediction.n_processors){}
+
+    void add_op(
+            int rank, const ComponentOps& component, string type_string,
+            const OpArgs& args, uint64_t elements){
+
+        RankPrediction& r = prediction.ranks[rank];
+        int n_processors = prediction.n_processors;
+
+        if(type_string == "MpiSend" || type_string == "MpiRecv"){
+            int peer = args.integer(0) % n_processors;
+
+            if(n_processors == 1 || peer == rank){
+                return;
+            }
+
+            key_type key = args.key(2);
+            auto size = component.signal_sizes.find(key);
+
+            if(size == component.signal_sizes.end()){
+                stringstream msg;
+                msg << type_string << " refers to signal " << key
+                    << ", which is not in its component.";
+                throw runtime_error(msg.str());
+            }
+
+            uint64_t bytes = size->second * sizeof(dtype);
+
+            if(type_string == "MpiSend"){
+                r.n_sends++;
+                r.bytes_sent += bytes;
+                send_peers[rank].insert(peer);
+            }else{
+                r.n_recvs++;
+                r.bytes_received += bytes;
+                recv_peers[rank].insert(peer);
+            }
+
+            return;
+        }
+
+        double seconds = op_costs.cost(type_string).ns(elements) * 1e-9;
+
+        r.n_ops++;
+        r.compute += seconds;
+        r.class_compute[type_string] += seconds;
+    }
+
+    void finish(const MessageModel& messages){
+        for(int rank = 0; rank < prediction.n_processors; rank++){
+            RankPrediction& r = prediction.ranks[rank];
+
+            if(prediction.mpi_merged){
+                r.n_sends = send_peers[rank].size();
+                r.n_recvs = recv_peers[rank].size();
+            }
+
+            r.comm = messages.latency * (r.n_sends + r.n_recvs)
+                     + max(r.bytes_sent, r.bytes_received) / messages.bandwidth;
+        }
+    }
+
+private:
+    NetworkPrediction& prediction;
+    const OpCostModel& op_costs;
+
+    vector<set<int>> send_peers;
+    vector<set<int>> recv_peers;
+};
+
+NetworkPrediction predict_network(
+        string filename, int n_processors, bool mpi_merged,
+        const OpCostModel& op_costs, const MessageModel& messages){
+
+    if(n_processors < 1){
+        throw runtime_error("Can only predict for one or more processes.");
+    }
+
+    ifstream in_file(filename);
+    if(!in_file.good()){
+        stringstream msg;
+        msg << "The network file " << filename << " does not exist.";
+        throw runtime_error(msg.str());
+    }
+    in_file.close();
+
+    hid_t f = H5Fopen(filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+
+    NetworkPrediction prediction;
+    prediction.n_processors = n_processors;
+    prediction.mpi_merged = mpi_merged;
+    prediction.ranks.resize(n_processors);
+
+    hid_t attr = H5Aopen(f, "n_components", H5P_DEFAULT);
+    H5Aread(attr, H5T_NATIVE_INT, &prediction.n_components);
+    H5Aclose(attr);
+
+    attr = H5Aopen(f, "dt", H5P_DEFAULT);
+    H5Aread(attr, H5T_NATIVE_DOUBLE, &prediction.dt);
+    H5Aclose(attr);
+
+    PredictionBuilder builder(prediction, op_costs);
+
+    for(int component = 0; component < prediction.n_components; component++){
+        int rank = component % n_processors;
+        prediction.ranks[rank].n_components++;
+
+        ComponentOps ops = read_component_ops(f, component);
+
+        for(auto& table : ops.op_tables){
+            for(size_t i = 0; i < table->n_rows(); i++){
+                OpTableRow row = table->row(i);
+                builder.add_op(rank, ops, table->type_string, row, op_elements(*table, row));
+            }
+        }
+
+        for(const string& op_string : ops.op_strings){
+            OpSpec spec(op_string);
+            StringOpArgs args(spec.arguments);
+            builder.add_op(rank, ops, spec.type_string, args, op_elements(spec));
+        }
+    }
+
+    H5Fclose(f);
+
+    builder.finish(messages);
+
+    return prediction;
+}
+
+void print_prediction(const NetworkPrediction& prediction, float sim_length){
+    const double us = 1e6;
+    const double KiB = 1024.0;
+
+    int n_processors = prediction.n_processors;
+    int slowest = prediction.bottleneck();
+
+    double mean_step = 0.0;
+    uint64_t total_bytes = 0, max_bytes = 0;
+    int total_messages = 0;
+
+    for(const RankPrediction& r : prediction.ranks){
+        mean_step += r.step() / n_processors;
+        total_bytes += r.bytes_sent;
+        total_messages += r.n_sends;
+        max_bytes = max(max_bytes, max(r.bytes_sent, r.bytes_received));
+    }
+
+    streamsize precision = cout.precision(2);
+    ios::fmtflags flags = cout.flags();
+    cout << fixed;
+
+    cout << "Predicted cost per step of " << prediction.n_components << " components on "
+         << n_processors << " processes"
+         << (prediction.mpi_merged ? " (merged communication)" : "") << ":" << endl;
+
+    cout << "  " << setw(6) << "rank" << setw(6) << "comps" << setw(8) << "ops"
+         << setw(14) << "compute (us)" << setw(7) << "sends" << setw(7) << "recvs"
+         << setw(12) << "sent (KiB)" << setw(12) << "recv (KiB)"
+         << setw(11) << "comm (us)" << setw(11) << "step (us)" << endl;
+
+    for(int rank = 0; rank < n_processors; rank++){
+        const RankPrediction& r = prediction.ranks[rank];
+
+        cout << "  " << setw(6) << rank << setw(6) << r.n_components << setw(8) << r.n_ops
+             << setw(14) << r.compute * us << setw(7) << r.n_sends << setw(7) << r.n_recvs
+             << setw(12) << r.bytes_sent / KiB << setw(12) << r.bytes_received / KiB
+             << setw(11) << r.comm * us << setw(11) << r.step() * us
+             << (rank == slowest ? "  <- bottleneck" : "") << endl;
+    }
+
+    const RankPrediction& b = prediction.ranks[slowest];
+
+    cout << "Predicted step time: " << b.step() * us << " us (rank " << slowest
+         << ": " << b.compute * us << " us compute, " << b.comm * us << " us communication)."
+         << endl;
+
+    if(mean_step > 0.0){
+        cout << "Slowest process over mean: " << b.step() / mean_step << endl;
+    }
+
+    // Where the bottleneck spends its compute time, most expensive first.
+    vector<pair<double, string>> classes;
+    for(auto& kv : b.class_compute){
+        classes.push_back({kv.second, kv.first});
+    }
+    sort(classes.rbegin(), classes.rend());
+
+    if(!classes.empty()){
+        cout << "Compute on rank " << slowest << " by operator class:" << endl;
+        for(auto& c : classes){
+            cout << "  " << left << setw(20) << c.second << right
+                 << setw(12) << c.first * us << " us" << setw(8)
+                 << (b.compute > 0.0 ? 100.0 * c.first / b.compute : 0.0) << "%" << endl;
+        }
+    }
+
+    cout << "Communication per step: " << total_messages << " messages, "
+         << total_bytes / KiB << " KiB in total, at most " << max_bytes / KiB
+         << " KiB sent or received by one process." << endl;
+
+    if(sim_length > 0.0){
+        int n_steps = int(round(sim_length / prediction.dt));
+        cout << "Predicted time for " << n_steps << " steps: "
+             << n_steps * b.step() << " seconds." << endl;
+    }
+
+    cout.flags(flags);
+    cout.precision(precision);
+}
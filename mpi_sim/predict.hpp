@@ -0,0 +1,105 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "operator.hpp"
+
+using namespace std;
+
+/* Predicting the step time of a network before running it.
+ *
+ * Only the operators and the shapes of the signals are read from the network
+ * file; no signal data is loaded and nothing is built. Each operator is given
+ * a cost per step that is linear in the number of elements it works on (the
+ * size of its largest signal argument), with coefficients for each operator
+ * class fitted to the output of bench_ops. Each MPI message costs a fixed
+ * latency plus its size over the bandwidth. Components are placed on
+ * processes as the simulator places them (component c on process
+ * c % n_processors), and the predicted step time is that of the slowest
+ * process, since every process waits for the others each step. */
+
+// Cost of one call of an operator of some class with `elements` elements:
+// fixed_ns + ns_per_element * elements.
+struct OpCost{
+    double fixed_ns;
+    double ns_per_element;
+
+    double ns(uint64_t elements) const { return fixed_ns + ns_per_element * elements; }
+};
+
+class OpCostModel{
+public:
+    // Starts with costs measured with bench_ops on a development machine.
+    OpCostModel();
+
+    /* Replace the costs of the classes in a CSV written by bench_ops with a
+     * least squares fit of its ns_per_call column against its elements
+     * column. Classes not in the file keep their current costs. */
+    void read_bench_csv(string filename);
+
+    OpCost cost(string type_string) const;
+
+    // Classes that bench_ops does not cover are given this cost.
+    OpCost default_cost;
+
+    map<string, OpCost> costs;
+};
+
+// Each MPI message takes latency + bytes / bandwidth seconds.
+struct MessageModel{
+    MessageModel(): latency(2e-6), bandwidth(5e9){}
+
+    double latency;
+    double bandwidth;
+};
+
+struct RankPrediction{
+    RankPrediction();
+
+    int n_components;
+    int n_ops;
+
+    // Seconds per step spent in operators, in total and by class.
+    double compute;
+    map<string, double> class_compute;
+
+    int n_sends;
+    int n_recvs;
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+
+    // Seconds per step spent on MPI messages: a latency for every message
+    // sent or received, and the larger of the bytes sent and received over
+    // the bandwidth.
+    double comm;
+
+    double step() const { return compute + comm; }
+};
+
+struct NetworkPrediction{
+    int n_components;
+    int n_processors;
+    dtype dt;
+    bool mpi_merged;
+
+    vector<RankPrediction> ranks;
+
+    // The process with the longest predicted step.
+    int bottleneck() const;
+};
+
+/* Read the operators of `filename` and predict the per-step cost of each
+ * process when run on `n_processors` processes. With `mpi_merged`, the
+ * messages between each pair of processes are counted as one per step, as
+ * in merged communication mode. */
+NetworkPrediction predict_network(
+    string filename, int n_processors, bool mpi_merged,
+    const OpCostModel& op_costs, const MessageModel& messages);
+
+/* Print the predicted step time of each process, the bottleneck process and
+ * what it spends its time on, and the communication volume. If `sim_length`
+ * is positive, also the predicted time to simulate that many seconds. */
+void print_prediction(const NetworkPrediction& prediction, float sim_length);
@@ -102,3 +102,16 @@ string Probe::to_string() const{
     return out.str();
 }
 
+size_t Probe::buffer_bytes() const{
+    size_t n = data.capacity() * sizeof(unique_ptr<BaseSignal>);
+
+    for(auto& sample: data){
+        n += sizeof(BaseSignal) + signal_bytes(*sample);
+    }
+
+    if(buffer){
+        n += signal.size1() * flush_every * sizeof(dtype);
+    }
+
+    return n;
+}
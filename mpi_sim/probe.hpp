@@ -14,6 +14,9 @@ public:
 
     void gather(int n_steps);
 
+    // Number of values recorded per sample (i.e. columns in a flushed buffer).
+    int get_n_cols() const { return signal.size1(); }
+
     shared_ptr<dtype> flush_to_buffer(int &n_rows);
 
     // Gives up data currently stored in probe.
@@ -26,6 +29,10 @@ public:
     /* Reset the probe. Only called between simulations. */
     void reset();
 
+    // Bytes held by the samples recorded so far (all of them, once
+    // init_for_simulation has been called) and the flush buffer.
+    size_t buffer_bytes() const;
+
     string to_string() const;
 
     friend ostream& operator << (ostream &out, const Probe &probe){
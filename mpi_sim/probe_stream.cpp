@@ -0,0 +1,119 @@
+#include "probe_stream.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+
+ProbeStream::ProbeStream(string name, int rank)
+:header(NULL), ring(NULL){
+
+    stringstream ss;
+    ss << "/" << name << "_" << rank;
+    shm_name = ss.str();
+
+    segment_size = sizeof(ProbeStreamHeader) + PROBE_STREAM_CAPACITY;
+
+    int fd = shm_open(shm_name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+
+    if(fd < 0){
+        stringstream msg;
+        msg << "Could not create shared memory segment " << shm_name
+            << " for probe stream: " << strerror(errno);
+        throw runtime_error(msg.str());
+    }
+
+    if(ftruncate(fd, segment_size) != 0){
+        stringstream msg;
+        msg << "Could not resize shared memory segment " << shm_name
+            << " for probe stream: " << strerror(errno);
+        close(fd);
+        shm_unlink(shm_name.c_str());
+        throw runtime_error(msg.str());
+    }
+
+    void* addr = mmap(NULL, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if(addr == MAP_FAILED){
+        stringstream msg;
+        msg << "Could not map shared memory segment " << shm_name
+            << " for probe stream: " << strerror(errno);
+        shm_unlink(shm_name.c_str());
+        throw runtime_error(msg.str());
+    }
+
+    header = new (addr) ProbeStreamHeader();
+    header->capacity = PROBE_STREAM_CAPACITY;
+    header->write_pos.store(0);
+    header->read_pos.store(0);
+    header->n_published.store(0);
+    header->n_dropped.store(0);
+
+    ring = (char*) addr + sizeof(ProbeStreamHeader);
+
+    // Written last so that readers never see a half-initialized header.
+    atomic_thread_fence(memory_order_release);
+    header->magic = PROBE_STREAM_MAGIC;
+}
+
+ProbeStream::~ProbeStream(){
+    if(header){
+        munmap((void*) header, segment_size);
+        shm_unlink(shm_name.c_str());
+    }
+}
+
+void ProbeStream::publish(
+        key_type probe_key, int step, const dtype* buffer,
+        unsigned n_rows, unsigned n_cols){
+
+    uint64_t data_size = uint64_t(n_rows) * n_cols * sizeof(dtype);
+    uint64_t record_size = sizeof(ProbeStreamRecord) + data_size;
+
+    uint64_t write_pos = header->write_pos.load(memory_order_relaxed);
+    uint64_t read_pos = header->read_pos.load(memory_order_acquire);
+
+    if(record_size > header->capacity - (write_pos - read_pos)){
+        header->n_dropped.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+
+    ProbeStreamRecord record;
+    record.record_size = record_size;
+    record.probe_key = probe_key;
+    record.step = step;
+    record.n_rows = n_rows;
+    record.n_cols = n_cols;
+
+    write_bytes(write_pos, (const char*) &record, sizeof(ProbeStreamRecord));
+    write_bytes(write_pos + sizeof(ProbeStreamRecord), (const char*) buffer, data_size);
+
+    header->write_pos.store(write_pos + record_size, memory_order_release);
+    header->n_published.fetch_add(1, memory_order_relaxed);
+}
+
+void ProbeStream::write_bytes(uint64_t pos, const char* src, uint64_t n_bytes){
+    uint64_t capacity = header->capacity;
+    uint64_t offset = pos % capacity;
+    uint64_t first = min(n_bytes, capacity - offset);
+
+    memcpy(ring + offset, src, first);
+
+    if(first < n_bytes){
+        memcpy(ring, src + first, n_bytes - first);
+    }
+}
+
+string ProbeStream::to_string() const{
+    stringstream out;
+
+    out << "ProbeStream:" << endl;
+    out << "shm_name: " << shm_name << endl;
+    out << "capacity: " << header->capacity << endl;
+    out << "n_published: " << n_published() << endl;
+    out << "n_dropped: " << n_dropped() << endl;
+
+    return out.str();
+}
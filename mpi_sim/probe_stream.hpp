@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+
+#include "operator.hpp"
+#include "debug.hpp"
+
+using namespace std;
+
+const uint64_t PROBE_STREAM_MAGIC = 0x6e656e676f737472; // "nengostr"
+
+// Size of the data region of each ring buffer, in bytes.
+const uint64_t PROBE_STREAM_CAPACITY = 64 * 1024 * 1024;
+
+/* Sits at the beginning of the shared memory segment. write_pos and read_pos
+ * are monotonically increasing byte counts; the location in the data region
+ * is obtained by taking them modulo capacity. Only the simulator advances
+ * write_pos, only the reader advances read_pos. */
+struct ProbeStreamHeader{
+    uint64_t magic;
+    uint64_t capacity;
+
+    atomic<uint64_t> write_pos;
+    atomic<uint64_t> read_pos;
+
+    atomic<uint64_t> n_published;
+    atomic<uint64_t> n_dropped;
+};
+
+/* Precedes the data for each published block. The block itself is
+ * n_rows * n_cols doubles, stored in row-major order. `step` is the
+ * simulation step at which the block was flushed. */
+struct ProbeStreamRecord{
+    uint64_t record_size;
+    uint64_t probe_key;
+    int64_t step;
+    uint32_t n_rows;
+    uint32_t n_cols;
+};
+
+/* Publishes flushed probe blocks to a single-producer/single-consumer ring
+ * buffer in POSIX shared memory, named /<name>_<rank>, so that a local viewer
+ * process can watch probes while a simulation is running. Publishing never
+ * blocks: if there is not enough free space in the ring (because there is no
+ * reader, or the reader is too slow) the block is dropped and counted. */
+class ProbeStream{
+public:
+    ProbeStream(string name, int rank);
+    ~ProbeStream();
+
+    void publish(
+        key_type probe_key, int step, const dtype* buffer,
+        unsigned n_rows, unsigned n_cols);
+
+    uint64_t n_published() const { return header->n_published.load(); }
+    uint64_t n_dropped() const { return header->n_dropped.load(); }
+
+    string get_shm_name() const { return shm_name; }
+
+    string to_string() const;
+
+protected:
+    void write_bytes(uint64_t pos, const char* src, uint64_t n_bytes);
+
+    string shm_name;
+    size_t segment_size;
+
+    ProbeStreamHeader* header;
+    char* ring;
+};
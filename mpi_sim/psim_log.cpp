@@ -1,8 +1,15 @@
 #include "psim_log.hpp"
 
 ParallelSimulationLog::ParallelSimulationLog(
-    unsigned n_processors, unsigned processor, vector<ProbeSpec> probe_info, dtype dt, MPI_Comm comm)
-:SimulationLog(probe_info, dt), n_processors(n_processors), processor(processor), comm(comm){}
+    unsigned n_processors, unsigned processor, vector<ProbeSpec> probe_info,
+    dtype dt, MPI_Comm comm, unsigned n_clients)
+:SimulationLog(probe_info, dt), n_processors(n_processors), processor(processor), comm(comm),
+n_clients(n_clients == 0 ? n_processors : n_clients){}
+
+bool ParallelSimulationLog::owns_probe(const ProbeSpec& ps) const{
+    unsigned client = ps.component % n_clients;
+    return io_server_index(client, n_clients, n_processors) == processor;
+}
 
 // Master version
 void ParallelSimulationLog::prep_for_simulation(string fn, unsigned n_steps){
@@ -72,6 +79,19 @@ void ParallelSimulationLog::setup_hdf5(unsigned n_steps){
     H5Tset_strpad(str_type, H5T_STR_NULLTERM);
 
     for(ProbeSpec ps : probe_info){
+        if(ps.storage == PROBE_STORAGE_EVENTS){
+            // Create property list for independent dataset write.
+            plist_id = H5Pcreate(H5P_DATASET_XFER);
+            H5Pset_dxpl_mpio(plist_id, H5FD_MPIO_INDEPENDENT);
+
+            if(owns_probe(ps)){
+                event_dset_index[ps.probe_key] = event_datasets.size();
+            }
+
+            event_datasets.push_back(create_event_datasets(ps, plist_id));
+            continue;
+        }
+
         hsize_t dset_dims[] = {n_steps, ps.signal_spec.shape1};
 
         // Create the dataspace for the dataset.
@@ -98,7 +118,7 @@ void ParallelSimulationLog::setup_hdf5(unsigned n_steps){
 
         HDF5Dataset d(ps.name, ps.signal_spec.shape1, dset_id, dataspace_id, plist_id);
 
-        if(ps.component % n_processors == processor){
+        if(owns_probe(ps)){
             dset_map[ps.probe_key] = d;
         }
 
@@ -108,6 +128,40 @@ void ParallelSimulationLog::setup_hdf5(unsigned n_steps){
     closed = false;
 }
 
+void ParallelSimulationLog::flush_events(){
+    if(event_datasets.size() == 0){
+        return;
+    }
+
+    // Each process fills in the new sizes of the datasets it owns.
+    vector<unsigned long long> local_sizes(2 * event_datasets.size(), 0);
+    vector<unsigned long long> sizes(2 * event_datasets.size(), 0);
+
+    for(auto& kv : event_dset_index){
+        HDF5EventDataset& d = event_datasets[kv.second];
+        local_sizes[2 * kv.second] = d.n_events + d.pending_events.size() / 2;
+        local_sizes[2 * kv.second + 1] = d.n_samples + d.pending_index.size();
+    }
+
+    MPI_Allreduce(
+        local_sizes.data(), sizes.data(), sizes.size(),
+        MPI_UNSIGNED_LONG_LONG, MPI_SUM, comm);
+
+    for(unsigned i = 0; i < event_datasets.size(); i++){
+        extend_event_datasets(event_datasets[i], sizes[2*i], sizes[2*i + 1]);
+    }
+
+    for(auto& kv : event_dset_index){
+        write_pending_events(event_datasets[kv.second]);
+    }
+
+    // Keep the bookkeeping of datasets owned by other processes up to date.
+    for(unsigned i = 0; i < event_datasets.size(); i++){
+        event_datasets[i].n_events = sizes[2*i];
+        event_datasets[i].n_samples = sizes[2*i + 1];
+    }
+}
+
 void ParallelSimulationLog::write_file(
         string filename_suffix, unsigned rank, unsigned max_buffer_size, string data){
 
@@ -137,3 +191,174 @@ void ParallelSimulationLog::write_file(
     MPI_File_write(fh, c_data, max_buffer_size, MPI_CHAR, MPI_STATUS_IGNORE);
     MPI_File_close(&fh);
 }
+
+string rank_log_filename(string filename, unsigned processor){
+    size_t dot = filename.find_last_of('.');
+    size_t slash = filename.find_last_of('/');
+
+    if(dot == string::npos || (slash != string::npos && dot < slash)){
+        dot = filename.length();
+    }
+
+    stringstream ss;
+    ss << filename.substr(0, dot) << "_" << processor << filename.substr(dot);
+    return ss.str();
+}
+
+RankSimulationLog::RankSimulationLog(
+    unsigned n_processors, unsigned processor, vector<ProbeSpec> probe_info,
+    dtype dt, MPI_Comm comm, unsigned n_clients)
+:ParallelSimulationLog(n_processors, processor, vector<ProbeSpec>(), dt, comm, n_clients){
+
+    for(ProbeSpec& ps : probe_info){
+        if(owns_probe(ps)){
+            this->probe_info.push_back(ps);
+        }
+    }
+}
+
+void RankSimulationLog::setup_hdf5(unsigned n_steps){
+    string rank_filename = rank_log_filename(filename, processor);
+    file_id = H5Fcreate(rank_filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+
+    // Lets nengo_mpi_merge check that it has found the files from every processor.
+    hid_t att_dataspace_id = H5Screate(H5S_SCALAR);
+    hid_t att_id;
+
+    att_id = H5Acreate2(
+        file_id, "processor", H5T_NATIVE_UINT, att_dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
+    H5Awrite(att_id, H5T_NATIVE_UINT, &processor);
+    H5Aclose(att_id);
+
+    att_id = H5Acreate2(
+        file_id, "n_processors", H5T_NATIVE_UINT, att_dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
+    H5Awrite(att_id, H5T_NATIVE_UINT, &n_processors);
+    H5Aclose(att_id);
+
+    H5Sclose(att_dataspace_id);
+
+    create_datasets(n_steps);
+
+    closed = false;
+}
+
+void RankSimulationLog::flush_events(){
+    SimulationLog::flush_events();
+}
+
+IOClientSimulationLog::IOClientSimulationLog(
+    unsigned n_processors, unsigned processor, vector<ProbeSpec> probe_info,
+    dtype dt, MPI_Comm comm, MPI_Comm io_comm, int server)
+:ParallelSimulationLog(n_processors, processor, probe_info, dt, comm),
+io_comm(io_comm), server(server){
+
+    for(ProbeSpec& ps : probe_info){
+        if(owns_probe(ps)){
+            n_cols[ps.probe_key] = ps.signal_spec.shape1;
+        }
+    }
+}
+
+void IOClientSimulationLog::setup_hdf5(unsigned){
+    closed = false;
+}
+
+void IOClientSimulationLog::send_header(key_type kind, key_type probe_key, unsigned n_rows){
+    PendingSend send;
+    send.header = shared_ptr<key_type>(new key_type[IO_HEADER_SIZE], default_delete<key_type[]>());
+    send.header.get()[0] = kind;
+    send.header.get()[1] = probe_key;
+    send.header.get()[2] = n_rows;
+
+    MPI_Isend(
+        send.header.get(), IO_HEADER_SIZE, MPI_LONG_LONG_INT,
+        server, io_tag, io_comm, &send.request);
+
+    pending_sends.push_back(send);
+}
+
+void IOClientSimulationLog::write(key_type probe_key, shared_ptr<dtype> buffer, unsigned n_rows){
+    if(n_rows == 0){
+        return;
+    }
+
+    send_header(IO_BLOCK, probe_key, n_rows);
+
+    // Probes reuse their buffer at the next flush, so send a copy.
+    size_t size = n_rows * n_cols.at(probe_key);
+
+    PendingSend send;
+    send.buffer = shared_ptr<dtype>(new dtype[size], default_delete<dtype[]>());
+    copy(buffer.get(), buffer.get() + size, send.buffer.get());
+
+    // Messages between a pair of processes with the same tag are not
+    // overtaken, so the server receives the data directly after the header.
+    MPI_Isend(
+        send.buffer.get(), size, MPI_DOUBLE, server, io_tag, io_comm, &send.request);
+
+    pending_sends.push_back(send);
+
+    reap_sends(false);
+}
+
+void IOClientSimulationLog::flush_events(){
+    send_header(IO_ROUND_END, 0, 0);
+}
+
+void IOClientSimulationLog::end_simulation(){
+    send_header(IO_RUN_END, 0, 0);
+    reap_sends(true);
+}
+
+void IOClientSimulationLog::reap_sends(bool wait){
+    if(pending_sends.empty()){
+        return;
+    }
+
+    vector<MPI_Request> requests;
+    requests.reserve(pending_sends.size());
+    for(PendingSend& send : pending_sends){
+        requests.push_back(send.request);
+    }
+
+    if(wait){
+        MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+        pending_sends.clear();
+        return;
+    }
+
+    // Sends don't complete in order, so test all of them rather than
+    // stopping at the first one that is still in flight.
+    int n_done = 0;
+    vector<int> done_indices(requests.size());
+    MPI_Testsome(
+        requests.size(), requests.data(), &n_done,
+        done_indices.data(), MPI_STATUSES_IGNORE);
+
+    if(n_done == MPI_UNDEFINED || n_done == 0){
+        return;
+    }
+
+    vector<bool> done(requests.size(), false);
+    for(int i = 0; i < n_done; i++){
+        done[done_indices[i]] = true;
+    }
+
+    unsigned i = 0;
+    for(auto it = pending_sends.begin(); it != pending_sends.end(); i++){
+        if(done[i]){
+            it = pending_sends.erase(it);
+        }else{
+            ++it;
+        }
+    }
+}
+
+void IOClientSimulationLog::close(){
+    if(!closed){
+        reap_sends(true);
+
+        closed = true;
+        ready_for_simulation = false;
+    }
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <map>
+#include <list>
 #include <vector>
 #include <string>
 #include <memory>
@@ -13,6 +14,23 @@
 #include "spec.hpp"
 #include "debug.hpp"
 
+// Tag for messages from compute processes to I/O server processes.
+const int io_tag = 3;
+
+// Kinds of message sent to an I/O server; each message is a header of
+// IO_HEADER_SIZE keys (kind, probe key, number of rows), followed, for
+// IO_BLOCK messages, by a message holding the rows of probe data.
+const key_type IO_BLOCK = 0;
+const key_type IO_ROUND_END = 1;
+const key_type IO_RUN_END = 2;
+const int IO_HEADER_SIZE = 3;
+
+// Index of the I/O server that collects the probe data of process
+// `client`. Consecutive clients (usually on the same node) share a server.
+inline unsigned io_server_index(unsigned client, unsigned n_clients, unsigned n_servers){
+    return (unsigned long long)(client) * n_servers / n_clients;
+}
+
 // A parallel version of SimulationLog. Represents an HDF5 file to which we
 // write data collected throughout the simulation. All processors have access
 // to the same file, and all processors can write to it independently.
@@ -20,9 +38,12 @@ class ParallelSimulationLog: public SimulationLog{
 public:
     ParallelSimulationLog(){};
 
+    // If this log is being written by I/O servers, `n_clients` is the
+    // number of compute processes whose probes are divided among the
+    // `n_processors` servers. Otherwise it is 0.
     ParallelSimulationLog(
         unsigned n_processors, unsigned processor,
-        vector<ProbeSpec> probe_info, dtype dt, MPI_Comm comm);
+        vector<ProbeSpec> probe_info, dtype dt, MPI_Comm comm, unsigned n_clients=0);
 
     // Called by master
     void prep_for_simulation(string fn, unsigned n_steps);
@@ -35,13 +56,93 @@ public:
     // processors can write simulation results to.
     void setup_hdf5(unsigned n_steps);
 
+    // Event datasets are extended collectively, so all processes exchange
+    // the number of events each has buffered before anything is written.
+    void flush_events() override;
+
     virtual void write_file(string filename_suffix, unsigned rank, unsigned max_buffer_size, string data);
 
 protected:
+    // Whether this process writes the data for the probe.
+    bool owns_probe(const ProbeSpec& ps) const;
+
     unsigned n_processors;
     unsigned processor;
     MPI_Comm comm;
 
+    unsigned n_clients;
+
     unsigned mpi_rank;
     unsigned mpi_size;
 };
+
+// Name of the file that `processor` writes to when logging to `filename`
+// with a RankSimulationLog, e.g. results.h5 -> results_3.h5.
+string rank_log_filename(string filename, unsigned processor);
+
+// A SimulationLog for parallel simulations in which each processor writes
+// the probes that it owns to its own file using serial HDF5, so that setting
+// up the log and writing to it require no collective HDF5 calls. The
+// per-processor files can be combined afterwards with nengo_mpi_merge.
+class RankSimulationLog: public ParallelSimulationLog{
+public:
+    RankSimulationLog(){};
+
+    // `probe_info` is the info for all probes in the network; only those
+    // owned by `processor` are given datasets.
+    RankSimulationLog(
+        unsigned n_processors, unsigned processor,
+        vector<ProbeSpec> probe_info, dtype dt, MPI_Comm comm, unsigned n_clients=0);
+
+    void setup_hdf5(unsigned n_steps) override;
+
+    void flush_events() override;
+};
+
+// Used by compute processes when probe data is written by dedicated I/O
+// server processes. Rather than writing to a file, each flushed block of
+// probe data is sent to this process's server with MPI_Isend, so the
+// simulation can continue while the server does the writing. Blocks are
+// kept alive until their sends complete.
+class IOClientSimulationLog: public ParallelSimulationLog{
+public:
+    IOClientSimulationLog(){};
+
+    // `comm` contains only the compute processes; `io_comm` contains all
+    // processes, and `server` is the rank of this process's server in it.
+    IOClientSimulationLog(
+        unsigned n_processors, unsigned processor, vector<ProbeSpec> probe_info,
+        dtype dt, MPI_Comm comm, MPI_Comm io_comm, int server);
+
+    // No file is created by compute processes.
+    void setup_hdf5(unsigned n_steps) override;
+
+    void write(key_type probe_key, shared_ptr<dtype> buffer, unsigned n_rows) override;
+
+    // Tells the server that a round of writes is complete.
+    void flush_events() override;
+
+    // Tells the server that the run is over, then waits for all sends to complete.
+    void end_simulation() override;
+
+    void close() override;
+
+protected:
+    void send_header(key_type kind, key_type probe_key, unsigned n_rows);
+
+    // Free the buffers of sends that have completed.
+    void reap_sends(bool wait);
+
+    MPI_Comm io_comm;
+    int server;
+
+    map<key_type, unsigned> n_cols;
+
+    struct PendingSend{
+        MPI_Request request;
+        shared_ptr<key_type> header;
+        shared_ptr<dtype> buffer;
+    };
+
+    list<PendingSend> pending_sends;
+};
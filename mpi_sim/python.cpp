@@ -90,6 +90,25 @@ void PythonMpiSimulator::load_network(bpy::object filename){
     sim->from_file(c_filename);
 }
 
+void PythonMpiSimulator::load_network_from_buffers(
+        bpy::object dt, bpy::object n_components, bpy::list packed, bpy::list probe_info){
+
+    dtype c_dt = bpy::extract<dtype>(dt);
+    int c_n_components = bpy::extract<int>(n_components);
+
+    vector<string> c_packed;
+    for(unsigned i = 0; i < bpy::len(packed); i++){
+        c_packed.push_back(bpy::extract<string>(packed[i]));
+    }
+
+    vector<string> c_probe_info;
+    for(unsigned i = 0; i < bpy::len(probe_info); i++){
+        c_probe_info.push_back(bpy::extract<string>(probe_info[i]));
+    }
+
+    sim->from_buffers(c_dt, c_n_components, c_packed, c_probe_info);
+}
+
 void PythonMpiSimulator::finalize_build(){
     sim->finalize_build();
 }
@@ -320,6 +339,7 @@ BOOST_PYTHON_MODULE(mpi_sim)
     bpy::class_<PythonMpiSimulator, boost::noncopyable>(
             "MpiSimulator", bpy::init<>())
         .def("load_network", &PythonMpiSimulator::load_network)
+        .def("load_network_from_buffers", &PythonMpiSimulator::load_network_from_buffers)
         .def("finalize_build", &PythonMpiSimulator::finalize_build)
         .def("run_n_steps", &PythonMpiSimulator::run_n_steps)
         .def("get_probe_data", &PythonMpiSimulator::get_probe_data)
@@ -40,6 +40,13 @@ public:
     PythonMpiSimulator(bpy::object n_components);
 
     void load_network(bpy::object filename);
+
+    /* Load a network built in python without going through a file.
+     * `packed` is a list with one packed component (see
+     * component_buffer.hpp) per component, as a byte string, and
+     * `probe_info` a list of the probe strings of all probes. */
+    void load_network_from_buffers(
+        bpy::object dt, bpy::object n_components, bpy::list packed, bpy::list probe_info);
     void finalize_build();
 
     /* Methods for controlling simulation. */
@@ -28,16 +28,27 @@ void SimulationLog::prep_for_simulation(){
 }
 
 void SimulationLog::setup_hdf5(unsigned n_steps){
-    hid_t dset_id, dataspace_id, plist_id, att_id, att_dataspace_id;
-
-    // Create a new file collectively and release property list identifier.
     file_id = H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
 
+    create_datasets(n_steps);
+
+    closed = false;
+}
+
+void SimulationLog::create_datasets(unsigned n_steps){
+    hid_t dset_id, dataspace_id, att_id, att_dataspace_id;
+
     hid_t str_type = H5Tcopy(H5T_C_S1);
     H5Tset_size(str_type, MAX_PROBE_NAME_LENGTH);
     H5Tset_strpad(str_type, H5T_STR_NULLTERM);
 
     for(ProbeSpec ps : probe_info){
+        if(ps.storage == PROBE_STORAGE_EVENTS){
+            event_dset_index[ps.probe_key] = event_datasets.size();
+            event_datasets.push_back(create_event_datasets(ps, H5P_DEFAULT));
+            continue;
+        }
+
         hsize_t dset_dims[] = {n_steps, ps.signal_spec.shape1};
 
         // Create the dataspace for the dataset.
@@ -67,9 +78,170 @@ void SimulationLog::setup_hdf5(unsigned n_steps){
     H5Tclose(str_type);
 }
 
+HDF5EventDataset SimulationLog::create_event_datasets(ProbeSpec& ps, hid_t plist_id){
+    hid_t att_id, att_dataspace_id;
+
+    string group_key = to_string(ps.probe_key);
+    hid_t group_id = H5Gcreate2(
+        file_id, group_key.c_str(), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+
+    // Attributes so that readers can reconstruct the dense data
+    hid_t str_type = H5Tcopy(H5T_C_S1);
+    H5Tset_size(str_type, MAX_PROBE_NAME_LENGTH);
+    H5Tset_strpad(str_type, H5T_STR_NULLTERM);
+
+    att_dataspace_id = H5Screate(H5S_SCALAR);
+
+    att_id = H5Acreate2(group_id, "name", str_type, att_dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
+    H5Awrite(att_id, str_type, ps.name.substr(0, MAX_PROBE_NAME_LENGTH).c_str());
+    H5Aclose(att_id);
+
+    att_id = H5Acreate2(group_id, "storage", str_type, att_dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
+    H5Awrite(att_id, str_type, PROBE_STORAGE_EVENTS.c_str());
+    H5Aclose(att_id);
+
+    int n_cols = ps.signal_spec.shape1;
+    att_id = H5Acreate2(
+        group_id, "n_cols", H5T_NATIVE_INT, att_dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
+    H5Awrite(att_id, H5T_NATIVE_INT, &n_cols);
+    H5Aclose(att_id);
+
+    // Spiking neurons output 1/dt when they spike
+    dtype amplitude = 1.0 / dt;
+    att_id = H5Acreate2(
+        group_id, "amplitude", H5T_NATIVE_DOUBLE, att_dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
+    H5Awrite(att_id, H5T_NATIVE_DOUBLE, &amplitude);
+    H5Aclose(att_id);
+
+    H5Sclose(att_dataspace_id);
+    H5Tclose(str_type);
+
+    // events: (sample, column) pairs
+    hsize_t events_dims[] = {0, 2};
+    hsize_t events_max_dims[] = {H5S_UNLIMITED, 2};
+    hsize_t events_chunk[] = {EVENT_CHUNK_SIZE, 2};
+
+    hid_t dataspace_id = H5Screate_simple(2, events_dims, events_max_dims);
+    hid_t create_plist = H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_chunk(create_plist, 2, events_chunk);
+
+    hid_t events_id = H5Dcreate2(
+        group_id, "events", H5T_NATIVE_UINT, dataspace_id,
+        H5P_DEFAULT, create_plist, H5P_DEFAULT);
+
+    H5Pclose(create_plist);
+    H5Sclose(dataspace_id);
+
+    // index: offset of the first event of each sample
+    hsize_t index_dims[] = {0};
+    hsize_t index_max_dims[] = {H5S_UNLIMITED};
+    hsize_t index_chunk[] = {EVENT_INDEX_CHUNK_SIZE};
+
+    dataspace_id = H5Screate_simple(1, index_dims, index_max_dims);
+    create_plist = H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_chunk(create_plist, 1, index_chunk);
+
+    hid_t index_id = H5Dcreate2(
+        group_id, "index", H5T_NATIVE_ULLONG, dataspace_id,
+        H5P_DEFAULT, create_plist, H5P_DEFAULT);
+
+    H5Pclose(create_plist);
+    H5Sclose(dataspace_id);
+
+    return HDF5EventDataset(ps.name, n_cols, group_id, events_id, index_id, plist_id);
+}
+
+void SimulationLog::extend_event_datasets(
+        HDF5EventDataset& d, hsize_t n_events, hsize_t n_samples){
+
+    hsize_t events_dims[] = {n_events, 2};
+    H5Dset_extent(d.events_id, events_dims);
+
+    hsize_t index_dims[] = {n_samples};
+    H5Dset_extent(d.index_id, index_dims);
+}
+
+void SimulationLog::write_pending_events(HDF5EventDataset& d){
+    hsize_t n_new_events = d.pending_events.size() / 2;
+    hsize_t n_new_samples = d.pending_index.size();
+
+    if(n_new_events > 0){
+        hsize_t count[] = {n_new_events, 2};
+        hsize_t offset[] = {d.n_events, 0};
+
+        hid_t memspace_id = H5Screate_simple(2, count, NULL);
+        hid_t filespace_id = H5Dget_space(d.events_id);
+        H5Sselect_hyperslab(filespace_id, H5S_SELECT_SET, offset, NULL, count, NULL);
+
+        H5Dwrite(
+            d.events_id, H5T_NATIVE_UINT, memspace_id, filespace_id,
+            d.plist_id, d.pending_events.data());
+
+        H5Sclose(filespace_id);
+        H5Sclose(memspace_id);
+    }
+
+    if(n_new_samples > 0){
+        hsize_t count[] = {n_new_samples};
+        hsize_t offset[] = {d.n_samples};
+
+        hid_t memspace_id = H5Screate_simple(1, count, NULL);
+        hid_t filespace_id = H5Dget_space(d.index_id);
+        H5Sselect_hyperslab(filespace_id, H5S_SELECT_SET, offset, NULL, count, NULL);
+
+        H5Dwrite(
+            d.index_id, H5T_NATIVE_ULLONG, memspace_id, filespace_id,
+            d.plist_id, d.pending_index.data());
+
+        H5Sclose(filespace_id);
+        H5Sclose(memspace_id);
+    }
+
+    d.n_events += n_new_events;
+    d.n_samples += n_new_samples;
+
+    d.pending_events.clear();
+    d.pending_index.clear();
+}
+
+void SimulationLog::flush_events(){
+    for(auto& kv : event_dset_index){
+        HDF5EventDataset& d = event_datasets[kv.second];
+
+        extend_event_datasets(
+            d, d.n_events + d.pending_events.size() / 2,
+            d.n_samples + d.pending_index.size());
+
+        write_pending_events(d);
+    }
+}
+
 void SimulationLog::write(key_type probe_key, shared_ptr<dtype> buffer, unsigned n_rows){
     herr_t status;
 
+    auto event_location = event_dset_index.find(probe_key);
+
+    if(event_location != event_dset_index.end()){
+        HDF5EventDataset& d = event_datasets[event_location->second];
+
+        const dtype* row = buffer.get();
+        for(unsigned i = 0; i < n_rows; i++){
+            unsigned sample = d.n_samples + d.pending_index.size();
+            d.pending_index.push_back(d.n_events + d.pending_events.size() / 2);
+
+            for(unsigned j = 0; j < d.n_cols; j++){
+                if(row[j] != 0.0){
+                    d.pending_events.push_back(sample);
+                    d.pending_events.push_back(j);
+                }
+            }
+
+            row += d.n_cols;
+        }
+
+        return;
+    }
+
     HDF5Dataset& d = dset_map.at(probe_key);
 
     unsigned n_cols = d.n_cols;
@@ -108,8 +280,17 @@ void SimulationLog::close(){
             d.close();
         }
 
+        for(auto& d : event_datasets){
+            d.close();
+        }
+
         H5Fclose(file_id);
 
+        datasets.clear();
+        dset_map.clear();
+        event_datasets.clear();
+        event_dset_index.clear();
+
         closed = true;
         ready_for_simulation = false;
     }
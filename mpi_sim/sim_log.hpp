@@ -48,8 +48,52 @@ struct HDF5Dataset{
     unsigned row_offset;
 };
 
+// Stores metadata about the HDF5 datasets for a probe whose data is stored
+// as a list of events. Events are (sample, column) pairs giving the location of
+// every non-zero value, appended to the extensible `events` dataset. Entry i of
+// the `index` dataset is the number of events recorded before sample i, so the
+// events for a window of samples can be read without scanning the whole list.
+struct HDF5EventDataset{
+    HDF5EventDataset(){};
+
+    HDF5EventDataset(string n, unsigned n_cols, hid_t g, hid_t e, hid_t i, hid_t p)
+    :name(n), n_cols(n_cols), group_id(g), events_id(e), index_id(i),
+    plist_id(p), n_events(0), n_samples(0){};
+
+    void close(){
+        H5Dclose(events_id);
+        H5Dclose(index_id);
+        H5Gclose(group_id);
+
+        if(plist_id != H5P_DEFAULT){
+            H5Pclose(plist_id);
+        }
+    }
+
+    string name;
+
+    unsigned n_cols;
+
+    hid_t group_id;
+    hid_t events_id;
+    hid_t index_id;
+    hid_t plist_id;
+
+    // Number of events and samples written to file so far.
+    hsize_t n_events;
+    hsize_t n_samples;
+
+    // Events and index entries waiting to be written by flush_events.
+    vector<unsigned> pending_events;
+    vector<unsigned long long> pending_index;
+};
+
 const unsigned MAX_PROBE_NAME_LENGTH = 512;
 
+// Chunk sizes for the extensible datasets used by event probes.
+const hsize_t EVENT_CHUNK_SIZE = 4096;
+const hsize_t EVENT_INDEX_CHUNK_SIZE = 1024;
+
 // Represents an HDF5 file to which we write data collected throughout the simulation.
 // If filename given to prep_for_simulation is the empty string, no logging is done.
 class SimulationLog{
@@ -72,15 +116,27 @@ public:
     // Write some data recorded by a probe in the simulator to the dataset in the
     // HDF5 that was reserved for that probe at the beginning of the simulation
     // (by calling the method `setup_hdf5`).
-    void write(key_type probe_key, shared_ptr<dtype> buffer, unsigned n_rows);
+    // For probes stored as events, the non-zero entries are only buffered;
+    // they are written by the next call to `flush_events`.
+    virtual void write(key_type probe_key, shared_ptr<dtype> buffer, unsigned n_rows);
+
+    // Append all buffered events to the event datasets. Must be called after
+    // each round of calls to `write`; collective for parallel logs.
+    virtual void flush_events();
+
+    // Called once all data from a simulation run has been written.
+    virtual void end_simulation(){};
 
     virtual void write_file(string filename_suffix, unsigned rank, unsigned max_buffer_size, string data);
 
     // Close the HDF5 file.
-    void close();
+    virtual void close();
 
     bool is_closed(){return closed;};
 
+    // The filename given to prep_for_simulation, or empty if not logging.
+    string get_filename(){return filename;};
+
 protected:
     bool ready_for_simulation;
 
@@ -93,5 +149,24 @@ protected:
 
     map<key_type, HDF5Dataset> dset_map;
     vector<HDF5Dataset> datasets;
+
+    // All event probes, in the order they appear in probe_info, and the
+    // location in that vector of each event probe this process writes to.
+    vector<HDF5EventDataset> event_datasets;
+    map<key_type, unsigned> event_dset_index;
+
     bool closed;
+
+    // Create the group and extensible datasets for an event probe.
+    HDF5EventDataset create_event_datasets(ProbeSpec& ps, hid_t plist_id);
+
+    // Grow the datasets of `d` to the given sizes. For parallel logs this
+    // is collective, and must be called by all processes with the same sizes.
+    void extend_event_datasets(HDF5EventDataset& d, hsize_t n_events, hsize_t n_samples);
+
+    // Write the pending events of `d` to file; the datasets must already be large enough.
+    void write_pending_events(HDF5EventDataset& d);
+
+    // Create a dataset in `file_id` for every probe in `probe_info`, using serial HDF5.
+    void create_datasets(unsigned n_steps);
 };
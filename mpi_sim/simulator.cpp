@@ -1,10 +1,53 @@
 #include "simulator.hpp"
 
 Simulator::Simulator(bool collect_timings)
-:collect_timings(collect_timings){
+:collect_timings(collect_timings), log_per_rank(false),
+network_image_mode(NETWORK_IMAGE_NONE), fold_signals(false), timing_period(1), trace(false),
+perf_counters(false), memory_report(false){
     chunk = unique_ptr<MpiSimulatorChunk>(new MpiSimulatorChunk(collect_timings));
 }
 
+void Simulator::set_probe_stream(string name){
+    probe_stream_name = name;
+    chunk->set_probe_stream(name);
+}
+
+void Simulator::set_log_per_rank(bool per_rank){
+    log_per_rank = per_rank;
+    chunk->set_log_per_rank(per_rank);
+}
+
+void Simulator::set_network_image(string name, int mode){
+    network_image_name = name;
+    network_image_mode = mode;
+    chunk->set_network_image(name, mode);
+}
+
+void Simulator::set_fold_signals(bool fold){
+    fold_signals = fold;
+    chunk->set_fold_signals(fold);
+}
+
+void Simulator::set_timing_period(unsigned period){
+    timing_period = max(period, 1u);
+    chunk->set_timing_period(period);
+}
+
+void Simulator::set_trace(bool trace){
+    this->trace = trace;
+    chunk->set_trace(trace);
+}
+
+void Simulator::set_perf_counters(bool enabled){
+    perf_counters = enabled;
+    chunk->set_perf_counters(enabled);
+}
+
+void Simulator::set_memory_report(bool enabled){
+    memory_report = enabled;
+    chunk->set_memory_report(enabled);
+}
+
 void Simulator::from_file(string filename){
     clock_t begin = clock();
 
@@ -25,6 +68,16 @@ void Simulator::from_file(string filename){
 
     in_file.close();
 
+    if(network_image_mode == NETWORK_IMAGE_CACHE){
+        string prefix = build_cache_prefix(network_image_name, filename, 1, false);
+        bool cached = network_image_valid(network_image_filename(prefix, 0), 0, 1);
+
+        chunk->set_network_image(prefix, cached ? NETWORK_IMAGE_LOAD : NETWORK_IMAGE_SAVE);
+
+        cout << (cached ? "Loading network from build cache: " : "Saving network to build cache: ")
+             << prefix << endl;
+    }
+
     // Use non-parallel property lists.
     hid_t file_plist = H5Pcreate(H5P_FILE_ACCESS);
     hid_t read_plist = H5Pcreate(H5P_DATASET_XFER);
@@ -45,6 +98,27 @@ void Simulator::from_file(string filename){
     write_to_loadtimes_file(delta);
 }
 
+void Simulator::from_buffers(
+        dtype dt, int n_components, const vector<string>& packed,
+        const vector<string>& probe_info){
+
+    clock_t begin = clock();
+
+    label = "network in memory";
+
+    chunk->from_buffers(dt, n_components, packed, probe_info, MPI_COMM_NULL);
+
+    for(const ProbeSpec& pi : chunk->probe_info){
+        probe_data[pi.probe_key] = vector<unique_ptr<BaseSignal>>();
+    }
+
+    clock_t end = clock();
+    double delta = double(end - begin) / CLOCKS_PER_SEC;
+    cout << "Loading network from memory took " << delta << " seconds." << endl;
+
+    write_to_loadtimes_file(delta);
+}
+
 void Simulator::finalize_build(){
     chunk->finalize_build();
 }
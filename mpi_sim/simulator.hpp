@@ -23,7 +23,40 @@ public:
 
     virtual ~Simulator(){};
 
+    /* Must be called before from_file. See MpiSimulatorChunk::set_probe_stream. */
+    void set_probe_stream(string name);
+
+    /* Must be called before from_file. See MpiSimulatorChunk::set_log_per_rank. */
+    void set_log_per_rank(bool per_rank);
+
+    /* Must be called before from_file. See MpiSimulatorChunk::set_network_image.
+     * With NETWORK_IMAGE_CACHE, name is a build cache directory, and from_file
+     * loads the cached images for the network if there are any, or else
+     * builds from the network file and caches images for next time. */
+    void set_network_image(string name, int mode);
+
+    /* Must be called before from_file. See MpiSimulatorChunk::set_fold_signals. */
+    void set_fold_signals(bool fold);
+
+    /* Must be called before from_file. See MpiSimulatorChunk::set_timing_period. */
+    void set_timing_period(unsigned period);
+
+    /* Must be called before from_file. See MpiSimulatorChunk::set_trace. */
+    void set_trace(bool trace);
+
+    /* Must be called before from_file. See MpiSimulatorChunk::set_perf_counters. */
+    void set_perf_counters(bool enabled);
+
+    /* Must be called before from_file. See MpiSimulatorChunk::set_memory_report. */
+    void set_memory_report(bool enabled);
+
     virtual void from_file(string filename);
+
+    /* Load the network from packed components built in python rather than
+     * from a file. See MpiSimulatorChunk::from_buffers. */
+    virtual void from_buffers(
+        dtype dt, int n_components, const vector<string>& packed,
+        const vector<string>& probe_info);
     virtual void finalize_build();
 
     virtual SignalView get_signal(string signal_string);
@@ -68,6 +101,15 @@ protected:
     unique_ptr<MpiSimulatorChunk> chunk;
     bool collect_timings;
     string label;
+    string probe_stream_name;
+    bool log_per_rank;
+    string network_image_name;
+    int network_image_mode;
+    bool fold_signals;
+    unsigned timing_period;
+    bool trace;
+    bool perf_counters;
+    bool memory_report;
 
     // Place to store probe data retrieved from worker
     // processes after simulation has finished.
@@ -110,6 +110,16 @@ void SpaunStimulus::reset(unsigned seed){
     previous_index = -1;
 }
 
+size_t SpaunStimulus::state_bytes() const{
+    size_t n = 0;
+
+    for(auto& image: images){
+        n += signal_bytes(*image);
+    }
+
+    return n;
+}
+
 ImageStore::ImageStore(string dir_name)
 :dir_name(dir_name), loaded_img_size(-1){
     load_image_counts(dir_name + "/counts");
@@ -32,6 +32,8 @@ public:
 
     virtual unsigned get_seed_modifier() const{ return unsigned(identifier); }
 
+    size_t state_bytes() const;
+
 protected:
     dtype* time_pointer;
 
@@ -1,4 +1,7 @@
 #include "spec.hpp"
+#include "utils.hpp"
+
+#include <iomanip>
 
 OpSpec::OpSpec(string op_string){
     try{
@@ -80,6 +83,46 @@ string SignalSpec::to_string() const{
     return out.str();
 }
 
+SignalSpec StringOpArgs::signal(int i) const{
+    return SignalSpec(arguments.at(i));
+}
+
+dtype StringOpArgs::real(int i) const{
+    return boost::lexical_cast<dtype>(arguments.at(i));
+}
+
+int StringOpArgs::integer(int i) const{
+    return boost::lexical_cast<int>(arguments.at(i));
+}
+
+key_type StringOpArgs::key(int i) const{
+    return boost::lexical_cast<key_type>(arguments.at(i));
+}
+
+unique_ptr<BaseSignal> StringOpArgs::array(int i, bool get_size) const{
+    return python_list_to_signal(arguments.at(i), get_size);
+}
+
+vector<int> StringOpArgs::index_vector(int i) const{
+    return python_list_to_index_vector(arguments.at(i));
+}
+
+string StringOpArgs::str(int i) const{
+    return arguments.at(i);
+}
+
+string StringOpArgs::to_string() const{
+    stringstream out;
+
+    int i = 0;
+    for(auto& s: arguments){
+        out << i << ": " << s << endl;
+        i++;
+    }
+
+    return out.str();
+}
+
 ProbeSpec::ProbeSpec(string probe_string){
     try{
         vector<string> tokens;
@@ -92,6 +135,15 @@ ProbeSpec::ProbeSpec(string probe_string){
         name = tokens[4];
         signal_spec = SignalSpec(signal_string);
 
+        storage = tokens.size() > 5 ? tokens[5] : PROBE_STORAGE_DENSE;
+
+        if(storage != PROBE_STORAGE_DENSE && storage != PROBE_STORAGE_EVENTS){
+            stringstream msg;
+            msg << "Unknown probe storage mode: " << storage << endl;
+            msg << "The probe string was: " << probe_string << endl;
+            throw logic_error(msg.str());
+        }
+
     }catch(const boost::bad_lexical_cast& e){
         stringstream msg;
         msg << "Caught bad lexical cast while extracting ProbeSpec from string "
@@ -101,6 +153,36 @@ ProbeSpec::ProbeSpec(string probe_string){
     }
 }
 
+string ProbeSpec::encode() const{
+    stringstream out;
+    out << setprecision(17);
+    out << component << PROBE_DELIM << probe_key << PROBE_DELIM << signal_string
+        << PROBE_DELIM << period << PROBE_DELIM << name << PROBE_DELIM << storage;
+
+    return out.str();
+}
+
+string encode_probe_info(const vector<ProbeSpec>& probe_info){
+    string encoded;
+
+    for(const ProbeSpec& ps : probe_info){
+        encoded.append(ps.encode());
+        encoded.push_back('\0');
+    }
+
+    return encoded;
+}
+
+vector<ProbeSpec> decode_probe_info(const string& encoded){
+    vector<ProbeSpec> probe_info;
+
+    for(size_t pos = 0; pos < encoded.size(); pos = encoded.find('\0', pos) + 1){
+        probe_info.push_back(ProbeSpec(string(encoded.c_str() + pos)));
+    }
+
+    return probe_info;
+}
+
 string ProbeSpec::to_string() const{
     stringstream out;
 
@@ -110,6 +192,7 @@ string ProbeSpec::to_string() const{
     out << "signal: " << signal_spec << endl;
     out << "period: " << period << endl;
     out << "name: " << name << endl;
+    out << "storage: " << storage << endl;
 
     return out.str();
 }
@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <sstream>
+#include <memory>
 
 #include "operator.hpp"
 
@@ -13,6 +14,10 @@ const string OP_DELIM = ";";
 const string SIGNAL_DELIM = ":";
 const string PROBE_DELIM = "|";
 
+// Ways that probe data can be stored in the simulation log.
+const string PROBE_STORAGE_DENSE = "dense";
+const string PROBE_STORAGE_EVENTS = "events";
+
 using namespace std;
 
 class Spec{
@@ -53,6 +58,49 @@ public:
     string to_string() const override;
 };
 
+/* Positional access to the arguments of an operator, independent of how they
+ * were stored in the network file. Argument i of an operator is always the same
+ * parameter whether it comes from an op string or from a row of a binary
+ * operator table (see op_table.hpp), so MpiSimulatorChunk::add_op only has to
+ * be written once. */
+class OpArgs: public Spec {
+public:
+    virtual ~OpArgs(){};
+
+    virtual SignalSpec signal(int i) const = 0;
+    virtual dtype real(int i) const = 0;
+    virtual int integer(int i) const = 0;
+    virtual key_type key(int i) const = 0;
+
+    /* If get_size is false the array is returned with shape (n, 1). Only
+     * consulted for string arguments; table arrays always carry their shape. */
+    virtual unique_ptr<BaseSignal> array(int i, bool get_size) const = 0;
+    virtual vector<int> index_vector(int i) const = 0;
+
+    virtual string str(int i) const = 0;
+
+    virtual string to_string() const override = 0;
+};
+
+/* OpArgs backed by the tokens of an op string. */
+class StringOpArgs: public OpArgs {
+public:
+    StringOpArgs(vector<string> arguments):arguments(move(arguments)){};
+
+    SignalSpec signal(int i) const override;
+    dtype real(int i) const override;
+    int integer(int i) const override;
+    key_type key(int i) const override;
+    unique_ptr<BaseSignal> array(int i, bool get_size) const override;
+    vector<int> index_vector(int i) const override;
+    string str(int i) const override;
+
+    string to_string() const override;
+
+protected:
+    vector<string> arguments;
+};
+
 class ProbeSpec: public Spec {
 public:
     ProbeSpec(){};
@@ -65,5 +113,17 @@ public:
     dtype period;
     string name;
 
+    // Either PROBE_STORAGE_DENSE or PROBE_STORAGE_EVENTS. Optional
+    // final field of the probe string, defaults to dense.
+    string storage;
+
+    // Inverse of the constructor; produces a probe string.
+    string encode() const;
+
     string to_string() const override;
 };
+
+/* Pack a list of ProbeSpecs into a single block of null-terminated probe
+ * strings, e.g. for broadcasting, and unpack it again. */
+string encode_probe_info(const vector<ProbeSpec>& probe_info);
+vector<ProbeSpec> decode_probe_info(const string& encoded);
@@ -0,0 +1,548 @@
+#include "timing.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <exception>
+
+LatencyHistogram::LatencyHistogram()
+:counts(LATENCY_BUCKETS, 0), n(0), total(0), longest(0){}
+
+void LatencyHistogram::merge(const LatencyHistogram& other){
+    for(unsigned b = 0; b < LATENCY_BUCKETS; b++){
+        counts[b] += other.counts[b];
+    }
+
+    n += other.n;
+    total += other.total;
+    longest = max(longest, other.longest);
+}
+
+// Buckets 0 to 3 hold durations of exactly 0 to 3 ns. After that, bucket
+// 4 * (k - 1) + j holds durations in [(4 + j) * 2^(k-2), (5 + j) * 2^(k-2)),
+// where k is the position of the highest set bit.
+unsigned LatencyHistogram::bucket(uint64_t ns){
+    if(ns < LATENCY_SUB_BUCKETS){
+        return ns;
+    }
+
+    unsigned k = 63 - __builtin_clzll(ns);
+    unsigned b = LATENCY_SUB_BUCKETS * (k - 1) + ((ns >> (k - 2)) & (LATENCY_SUB_BUCKETS - 1));
+
+    return min(b, LATENCY_BUCKETS - 1);
+}
+
+uint64_t LatencyHistogram::bucket_upper_bound(unsigned b){
+    if(b < LATENCY_SUB_BUCKETS){
+        return b;
+    }
+
+    unsigned k = b / LATENCY_SUB_BUCKETS + 1;
+    uint64_t width = uint64_t(1) << (k - 2);
+
+    return (LATENCY_SUB_BUCKETS + b % LATENCY_SUB_BUCKETS + 1) * width - 1;
+}
+
+uint64_t LatencyHistogram::percentile_ns(double q) const {
+    if(n == 0){
+        return 0;
+    }
+
+    uint64_t rank = max(uint64_t(1), uint64_t(q * n + 0.5));
+    uint64_t seen = 0;
+
+    for(unsigned b = 0; b < LATENCY_BUCKETS; b++){
+        seen += counts[b];
+
+        if(seen >= rank){
+            return min(bucket_upper_bound(b), longest);
+        }
+    }
+
+    return longest;
+}
+
+SimulationTimings::SimulationTimings(size_t n_operators, unsigned period)
+:operators(n_operators), period(max(period, 1u)){
+    counted.fill(false);
+}
+
+string timings_prefix(string log_filename, unsigned run){
+    string prefix = "nengo_mpi";
+
+    if(!log_filename.empty()){
+        size_t dot = log_filename.find_last_of('.');
+        size_t slash = log_filename.find_last_of('/');
+
+        if(dot == string::npos || (slash != string::npos && dot < slash)){
+            prefix = log_filename;
+        }else{
+            prefix = log_filename.substr(0, dot);
+        }
+    }
+
+    if(run > 0){
+        stringstream ss;
+        ss << prefix << "_run" << run;
+        prefix = ss.str();
+    }
+
+    return prefix;
+}
+
+string json_string(const string& s){
+    stringstream out;
+    out << '"';
+
+    for(char c : s){
+        switch(c){
+            case '"': out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\t': out << "\\t"; break;
+            default:
+                if((unsigned char)(c) < 0x20){
+                    out << "\\u" << hex << setw(4) << setfill('0') << int(c) << dec;
+                }else{
+                    out << c;
+                }
+        }
+    }
+
+    out << '"';
+    return out.str();
+}
+
+// Statistics of a histogram, in seconds, as the members of a JSON object.
+static string json_stats(const LatencyHistogram& h){
+    stringstream out;
+    out << setprecision(9);
+    out << "\"n_samples\": " << h.count()
+        << ", \"total\": " << h.total_ns() * 1e-9
+        << ", \"mean\": " << h.mean_ns() * 1e-9
+        << ", \"p50\": " << h.percentile_ns(0.5) * 1e-9
+        << ", \"p99\": " << h.percentile_ns(0.99) * 1e-9
+        << ", \"max\": " << h.max_ns() * 1e-9;
+    return out.str();
+}
+
+static string csv_stats(const LatencyHistogram& h){
+    stringstream out;
+    out << setprecision(9);
+    out << h.count() << "," << h.total_ns() * 1e-9 << "," << h.mean_ns() * 1e-9 << ","
+        << h.percentile_ns(0.5) * 1e-9 << "," << h.percentile_ns(0.99) * 1e-9 << ","
+        << h.max_ns() * 1e-9;
+    return out.str();
+}
+
+// Hardware counter totals for one operator class, and metrics derived from
+// them, as the members of a JSON object. Counters that were not collected
+// are null. LLC misses are converted to bytes assuming 64-byte lines; flops
+// cannot be counted portably, so memory traffic is given per instruction.
+static string json_counters(const PerfCounts& counts, const array<bool, N_PERF_COUNTERS>& counted){
+    stringstream out;
+    out << setprecision(6);
+
+    for(int c = 0; c < N_PERF_COUNTERS; c++){
+        out << (c ? ", " : "") << "\"" << perf_counter_names[c] << "\": ";
+
+        if(counted[c]){
+            out << counts[c];
+        }else{
+            out << "null";
+        }
+    }
+
+    double cycles = counts[PERF_CYCLES];
+    double instructions = counts[PERF_INSTRUCTIONS];
+
+    out << ", \"ipc\": ";
+    if(counted[PERF_INSTRUCTIONS] && cycles > 0){
+        out << instructions / cycles;
+    }else{
+        out << "null";
+    }
+
+    out << ", \"llc_bytes_per_instruction\": ";
+    if(counted[PERF_LLC_MISSES] && counted[PERF_INSTRUCTIONS] && instructions > 0){
+        out << 64.0 * counts[PERF_LLC_MISSES] / instructions;
+    }else{
+        out << "null";
+    }
+
+    out << ", \"stalled_fraction\": ";
+    if(counted[PERF_STALLED_CYCLES] && cycles > 0){
+        out << counts[PERF_STALLED_CYCLES] / cycles;
+    }else{
+        out << "null";
+    }
+
+    return out.str();
+}
+
+static void open_timings_file(ofstream& out, string filename){
+    out.open(filename);
+
+    if(!out){
+        stringstream msg;
+        msg << "Could not open timings file " << filename << ".";
+        throw runtime_error(msg.str());
+    }
+
+    out << setprecision(9);
+}
+
+void SimulationTimings::write(string prefix, int rank, const list<Operator*>& operator_list) const {
+    map<string, LatencyHistogram> classes;
+    map<string, int> class_sizes;
+    map<string, size_t> class_slowest;
+    map<string, PerfCounts> class_counts;
+
+    vector<Operator*> ops(operator_list.begin(), operator_list.end());
+
+    for(size_t i = 0; i < ops.size(); i++){
+        string class_name = ops[i]->classname();
+        classes[class_name].merge(operators[i]);
+        class_sizes[class_name]++;
+
+        if(!operator_counts.empty()){
+            PerfCounts& counts = class_counts[class_name];
+            for(int c = 0; c < N_PERF_COUNTERS; c++){
+                counts[c] += operator_counts[i][c];
+            }
+        }
+
+        auto slowest = class_slowest.find(class_name);
+        if(slowest == class_slowest.end() ||
+                operators[slowest->second].total_ns() < operators[i].total_ns()){
+            class_slowest[class_name] = i;
+        }
+    }
+
+    stringstream base;
+    base << prefix << "_timings_" << rank;
+
+    ofstream json;
+    open_timings_file(json, base.str() + ".json");
+
+    json << "{" << endl;
+    json << "  \"rank\": " << rank << "," << endl;
+    json << "  \"timing_period\": " << period << "," << endl;
+    json << "  \"load\": {" << json_stats(load) << "}," << endl;
+    json << "  \"flush\": {" << json_stats(flushes) << "}," << endl;
+    json << "  \"step\": {" << json_stats(steps) << "}," << endl;
+
+    json << "  \"classes\": {";
+    bool first = true;
+    for(auto& kv : classes){
+        Operator* slowest = ops[class_slowest[kv.first]];
+        stringstream description;
+        description << *slowest;
+
+        json << (first ? "" : ",") << endl
+             << "    " << json_string(kv.first) << ": {"
+             << "\"n_operators\": " << class_sizes[kv.first] << ", "
+             << json_stats(kv.second) << ", "
+             << "\"slowest_operator\": " << class_slowest[kv.first] << ", "
+             << "\"slowest_operator_description\": " << json_string(description.str());
+
+        if(!operator_counts.empty()){
+            json << ", \"counters\": {" << json_counters(class_counts[kv.first], counted) << "}";
+        }
+
+        json << "}";
+        first = false;
+    }
+    json << endl << "  }," << endl;
+
+    json << "  \"operators\": [";
+    for(size_t i = 0; i < ops.size(); i++){
+        json << (i ? "," : "") << endl
+             << "    {\"index\": " << i << ", \"class\": " << json_string(ops[i]->classname())
+             << ", " << json_stats(operators[i]) << "}";
+    }
+    json << endl << "  ]," << endl;
+
+    json << "  \"peers\": [";
+    first = true;
+    for(auto& kv : peers){
+        const PeerCommStats& p = kv.second;
+
+        json << (first ? "" : ",") << endl
+             << "    {\"rank\": " << kv.first
+             << ", \"messages_sent\": " << p.messages_sent
+             << ", \"bytes_sent\": " << p.bytes_sent
+             << ", \"send_wait\": " << p.send_wait_ns * 1e-9
+             << ", \"messages_received\": " << p.messages_received
+             << ", \"bytes_received\": " << p.bytes_received
+             << ", \"recv_wait\": " << p.recv_wait_ns * 1e-9 << "}";
+        first = false;
+    }
+    json << endl << "  ]" << endl;
+    json << "}" << endl;
+
+    ofstream csv;
+    open_timings_file(csv, base.str() + ".csv");
+
+    csv << "rank,scope,class,index,n_samples,total,mean,p50,p99,max" << endl;
+    csv << rank << ",load,,," << csv_stats(load) << endl;
+    csv << rank << ",flush,,," << csv_stats(flushes) << endl;
+    csv << rank << ",step,,," << csv_stats(steps) << endl;
+
+    for(auto& kv : classes){
+        csv << rank << ",class," << kv.first << ",," << csv_stats(kv.second) << endl;
+    }
+
+    for(size_t i = 0; i < ops.size(); i++){
+        csv << rank << ",operator," << ops[i]->classname() << "," << i << ","
+            << csv_stats(operators[i]) << endl;
+    }
+}
+
+// Number of uint64 values sent per peer by write_comm_matrix.
+const int COMM_ENTRY_SIZE = 7;
+
+void write_comm_matrix(string prefix, const map<int, PeerCommStats>& peers, MPI_Comm comm){
+    int rank, n_processors;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &n_processors);
+
+    // Only pairs that communicate are sent, since the dense matrix grows
+    // with the square of the number of processes.
+    vector<uint64_t> local;
+    for(auto& kv : peers){
+        const PeerCommStats& p = kv.second;
+        uint64_t entry[COMM_ENTRY_SIZE] = {
+            uint64_t(kv.first), p.messages_sent, p.bytes_sent, p.send_wait_ns,
+            p.messages_received, p.bytes_received, p.recv_wait_ns};
+        local.insert(local.end(), entry, entry + COMM_ENTRY_SIZE);
+    }
+
+    int n_local = local.size();
+    vector<int> counts(rank == 0 ? n_processors : 0), displs(counts.size());
+    MPI_Gather(&n_local, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, comm);
+
+    int n_total = 0;
+    for(size_t i = 0; i < counts.size(); i++){
+        displs[i] = n_total;
+        n_total += counts[i];
+    }
+
+    vector<uint64_t> all(n_total);
+    MPI_Gatherv(
+        local.data(), n_local, MPI_UINT64_T,
+        all.data(), counts.data(), displs.data(), MPI_UINT64_T, 0, comm);
+
+    if(rank != 0){
+        return;
+    }
+
+    // Keyed by (src, dst). Messages and bytes are counted at both ends,
+    // which agree unless a message was still in flight.
+    map<pair<int, int>, PeerCommStats> matrix;
+
+    for(int r = 0; r < n_processors; r++){
+        for(int i = displs[r]; i < displs[r] + counts[r]; i += COMM_ENTRY_SIZE){
+            int peer = all[i];
+
+            PeerCommStats& out = matrix[{r, peer}];
+            out.messages_sent = all[i+1];
+            out.bytes_sent = all[i+2];
+            out.send_wait_ns = all[i+3];
+
+            PeerCommStats& in = matrix[{peer, r}];
+            in.messages_received = all[i+4];
+            in.bytes_received = all[i+5];
+            in.recv_wait_ns = all[i+6];
+        }
+    }
+
+    ofstream csv;
+    open_timings_file(csv, prefix + "_comm.csv");
+
+    csv << "src,dst,messages,bytes,send_wait,recv_wait" << endl;
+    for(auto& kv : matrix){
+        const PeerCommStats& p = kv.second;
+
+        if(p.messages_sent == 0 && p.messages_received == 0){
+            continue;
+        }
+
+        csv << kv.first.first << "," << kv.first.second << ","
+            << max(p.messages_sent, p.messages_received) << ","
+            << max(p.bytes_sent, p.bytes_received) << ","
+            << p.send_wait_ns * 1e-9 << "," << p.recv_wait_ns * 1e-9 << endl;
+    }
+}
+
+// Number of uint64 values sent per process by report_load_balance.
+const int LOAD_ENTRY_SIZE = 5;
+
+// Number of processes listed in the summary printed by report_load_balance.
+const int N_SLOWEST_PROCESSES = 5;
+
+// Layout of MPI_DOUBLE_INT, for MPI_MAXLOC.
+struct DoubleInt{
+    double value;
+    int rank;
+};
+
+void report_load_balance(string prefix, const RunLoad& load, string cost_file, MPI_Comm comm){
+    int rank, n_processors;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &n_processors);
+
+    // Every process ran the same number of steps. Per-step figures are
+    // reduced rather than gathered, so rank 0 never holds more than a few
+    // values per step.
+    int n_steps = load.compute_ns.size();
+
+    uint64_t compute_ns = 0;
+    vector<DoubleInt> local_max(n_steps);
+    vector<double> local_sum(n_steps);
+
+    for(int i = 0; i < n_steps; i++){
+        compute_ns += load.compute_ns[i];
+        local_max[i] = {load.compute_ns[i] * 1e-9, rank};
+        local_sum[i] = load.compute_ns[i] * 1e-9;
+    }
+
+    vector<DoubleInt> step_max(rank == 0 ? n_steps : 0);
+    vector<double> step_sum(step_max.size());
+
+    MPI_Reduce(
+        local_max.data(), step_max.data(), n_steps, MPI_DOUBLE_INT, MPI_MAXLOC, 0, comm);
+    MPI_Reduce(
+        local_sum.data(), step_sum.data(), n_steps, MPI_DOUBLE, MPI_SUM, 0, comm);
+
+    uint64_t entry[LOAD_ENTRY_SIZE] = {
+        compute_ns, load.wait_ns, load.step_ns, load.n_operators, load.n_mpi_operators};
+
+    vector<uint64_t> all(rank == 0 ? n_processors * LOAD_ENTRY_SIZE : 0);
+    MPI_Gather(entry, LOAD_ENTRY_SIZE, MPI_UINT64_T, all.data(), LOAD_ENTRY_SIZE, MPI_UINT64_T, 0, comm);
+
+    if(rank != 0){
+        return;
+    }
+
+    vector<double> imbalance(n_steps);
+    vector<int> slowest_steps(n_processors, 0);
+    double critical_path = 0.0, balanced = 0.0, mean_imbalance = 0.0;
+
+    for(int i = 0; i < n_steps; i++){
+        double mean = step_sum[i] / n_processors;
+        imbalance[i] = mean > 0.0 ? step_max[i].value / mean : 1.0;
+
+        slowest_steps[step_max[i].rank]++;
+        critical_path += step_max[i].value;
+        balanced += mean;
+        mean_imbalance += imbalance[i] / n_steps;
+    }
+
+    vector<double> sorted_imbalance(imbalance);
+    sort(sorted_imbalance.begin(), sorted_imbalance.end());
+
+    auto percentile = [&](double q){
+        if(sorted_imbalance.empty()){
+            return 1.0;
+        }
+
+        return sorted_imbalance[min(sorted_imbalance.size() - 1, size_t(q * sorted_imbalance.size()))];
+    };
+
+    // Totals of each process, in seconds.
+    vector<double> compute(n_processors), wait(n_processors), step(n_processors);
+    double run = 0.0, mean_compute = 0.0;
+
+    for(int r = 0; r < n_processors; r++){
+        compute[r] = all[r * LOAD_ENTRY_SIZE] * 1e-9;
+        wait[r] = all[r * LOAD_ENTRY_SIZE + 1] * 1e-9;
+        step[r] = all[r * LOAD_ENTRY_SIZE + 2] * 1e-9;
+
+        run = max(run, step[r]);
+        mean_compute += compute[r] / n_processors;
+    }
+
+    double max_compute = *max_element(compute.begin(), compute.end());
+    double run_imbalance = mean_compute > 0.0 ? max_compute / mean_compute : 1.0;
+
+    vector<int> by_compute(n_processors);
+    for(int r = 0; r < n_processors; r++){
+        by_compute[r] = r;
+    }
+
+    stable_sort(by_compute.begin(), by_compute.end(), [&](int a, int b){
+        return compute[a] > compute[b];
+    });
+
+    streamsize precision = cout.precision(4);
+
+    cout << "Load balance over " << n_processors << " processes, " << n_steps << " steps:" << endl;
+    cout << "  Compute imbalance per step (max / mean): mean " << mean_imbalance
+         << ", p50 " << percentile(0.5) << ", p99 " << percentile(0.99)
+         << ", max " << percentile(1.0) << endl;
+    cout << "  Compute imbalance over the run: " << run_imbalance << endl;
+    cout << "  Critical path " << critical_path << " s, perfectly balanced "
+         << balanced << " s, actual " << run << " s" << endl;
+    cout << "  Slowest processes:" << endl;
+
+    for(int i = 0; i < min(n_processors, N_SLOWEST_PROCESSES); i++){
+        int r = by_compute[i];
+        cout << "    rank " << r << ": compute " << compute[r] << " s, MPI wait " << wait[r]
+             << " s, " << all[r * LOAD_ENTRY_SIZE + 3] << " operators, slowest on "
+             << slowest_steps[r] << " steps" << endl;
+    }
+
+    cout.precision(precision);
+
+    if(!prefix.empty()){
+        ofstream json;
+        open_timings_file(json, prefix + "_balance.json");
+
+        json << "{" << endl;
+        json << "  \"n_processors\": " << n_processors << "," << endl;
+        json << "  \"n_steps\": " << n_steps << "," << endl;
+        json << "  \"step_imbalance\": {\"mean\": " << mean_imbalance
+             << ", \"p50\": " << percentile(0.5) << ", \"p99\": " << percentile(0.99)
+             << ", \"max\": " << percentile(1.0) << "}," << endl;
+        json << "  \"run_imbalance\": " << run_imbalance << "," << endl;
+        json << "  \"critical_path\": " << critical_path << "," << endl;
+        json << "  \"balanced\": " << balanced << "," << endl;
+        json << "  \"run\": " << run << "," << endl;
+
+        json << "  \"ranks\": [";
+        for(int r = 0; r < n_processors; r++){
+            json << (r ? "," : "") << endl
+                 << "    {\"rank\": " << r << ", \"compute\": " << compute[r]
+                 << ", \"wait\": " << wait[r] << ", \"step\": " << step[r]
+                 << ", \"n_operators\": " << all[r * LOAD_ENTRY_SIZE + 3]
+                 << ", \"n_mpi_operators\": " << all[r * LOAD_ENTRY_SIZE + 4]
+                 << ", \"slowest_steps\": " << slowest_steps[r] << "}";
+        }
+        json << endl << "  ]" << endl;
+        json << "}" << endl;
+
+        ofstream csv;
+        open_timings_file(csv, prefix + "_balance_steps.csv");
+
+        csv << "step,max_compute,mean_compute,imbalance,slowest_rank" << endl;
+        for(int i = 0; i < n_steps; i++){
+            csv << i << "," << step_max[i].value << "," << step_sum[i] / n_processors << ","
+                << imbalance[i] << "," << step_max[i].rank << endl;
+        }
+    }
+
+    if(!cost_file.empty()){
+        ofstream costs;
+        open_timings_file(costs, cost_file);
+
+        costs << "rank,n_steps,n_operators,n_mpi_operators,compute,wait,step" << endl;
+        for(int r = 0; r < n_processors; r++){
+            costs << r << "," << n_steps << "," << all[r * LOAD_ENTRY_SIZE + 3] << ","
+                  << all[r * LOAD_ENTRY_SIZE + 4] << "," << compute[r] << ","
+                  << wait[r] << "," << step[r] << endl;
+        }
+    }
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <map>
+#include <list>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+#include <mpi.h>
+
+#include "operator.hpp"
+#include "perf_counters.hpp"
+
+using namespace std;
+
+// Monotonic wall clock used for all timing. Unlike clock(), which counts the
+// CPU time of the whole process, it also counts time spent blocked.
+typedef chrono::steady_clock timing_clock;
+
+inline uint64_t elapsed_ns(timing_clock::time_point begin, timing_clock::time_point end){
+    return chrono::duration_cast<chrono::nanoseconds>(end - begin).count();
+}
+
+// Each power of two is split into this many latency buckets.
+const unsigned LATENCY_SUB_BUCKETS = 4;
+
+// Durations longer than a minute all fall in the last bucket.
+const unsigned LATENCY_BUCKETS = LATENCY_SUB_BUCKETS * 35;
+
+/* A histogram of durations in nanoseconds, with buckets that grow
+ * geometrically so that every bucket is within 25% of its lower bound.
+ * Percentiles are estimated as the upper bound of the bucket they fall in
+ * (but never more than the longest duration recorded). */
+class LatencyHistogram{
+public:
+    LatencyHistogram();
+
+    void add(uint64_t ns){
+        counts[bucket(ns)]++;
+        n++;
+        total += ns;
+        longest = max(longest, ns);
+    }
+
+    void merge(const LatencyHistogram& other);
+
+    uint64_t count() const { return n; }
+    uint64_t total_ns() const { return total; }
+    uint64_t max_ns() const { return longest; }
+    double mean_ns() const { return n ? double(total) / n : 0.0; }
+
+    // q in [0, 1].
+    uint64_t percentile_ns(double q) const;
+
+    static unsigned bucket(uint64_t ns);
+    static uint64_t bucket_upper_bound(unsigned b);
+
+protected:
+    vector<uint32_t> counts;
+    uint64_t n;
+    uint64_t total;
+    uint64_t longest;
+};
+
+/* Messages between one process and one of its peers over a simulation.
+ * Wait times are the time spent blocked in MPI_Wait on sends to the peer
+ * and on receives from it. */
+struct PeerCommStats{
+    uint64_t messages_sent;
+    uint64_t bytes_sent;
+    uint64_t send_wait_ns;
+    uint64_t messages_received;
+    uint64_t bytes_received;
+    uint64_t recv_wait_ns;
+};
+
+/* Wall-clock timings of one process's simulation. The length of every step
+ * is recorded; operators are timed individually only on every
+ * `period`-th step, since reading the clock around each operator is the
+ * main cost of collecting timings. */
+class SimulationTimings{
+public:
+    SimulationTimings(size_t n_operators, unsigned period);
+
+    bool times_operators(unsigned step) const { return step % period == 0; }
+
+    LatencyHistogram steps;
+    vector<LatencyHistogram> operators;
+    unsigned period;
+
+    // Time taken to load and build the chunk (a single sample), and to
+    // flush the probes to the log, each time they were flushed.
+    LatencyHistogram load;
+    LatencyHistogram flushes;
+
+    // Keyed by peer rank.
+    map<int, PeerCommStats> peers;
+
+    // Hardware counter deltas summed over each operator's timed calls.
+    // Empty unless counters were collected; counted says which were.
+    vector<PerfCounts> operator_counts;
+    array<bool, N_PERF_COUNTERS> counted;
+
+    /* Write the timings to <prefix>_timings_<rank>.json and
+     * <prefix>_timings_<rank>.csv. The JSON file holds load, flush,
+     * per-step, per-class and per-operator statistics, a description of
+     * the slowest operator of each class, hardware counter totals and
+     * derived metrics for each class if counters were collected, and the
+     * communication with each peer. The CSV file has one row for each of
+     * the load, flush and step summaries, each class and each operator.
+     * Times are in seconds. */
+    void write(string prefix, int rank, const list<Operator*>& operator_list) const;
+};
+
+/* Gather the communication stats of every process in `comm` on rank 0,
+ * which writes them to <prefix>_comm.csv as a sparse communication matrix:
+ * one row for each pair of processes that exchange messages, giving the
+ * bytes and messages sent from src to dst, the time src spent waiting on
+ * those sends and the time dst spent waiting to receive them. Collective
+ * over `comm`. */
+void write_comm_matrix(string prefix, const map<int, PeerCommStats>& peers, MPI_Comm comm);
+
+/* How one process spent a run: its compute time on each step (the length
+ * of the step less the time it spent blocked in MPI_Wait), its totals, and
+ * the number of operators it ran. */
+struct RunLoad{
+    RunLoad():wait_ns(0), step_ns(0), n_operators(0), n_mpi_operators(0){}
+
+    vector<uint64_t> compute_ns;
+    uint64_t wait_ns;
+    uint64_t step_ns;
+    uint64_t n_operators;
+    uint64_t n_mpi_operators;
+};
+
+/* Gather the loads of every process in `comm` on rank 0, which reports how
+ * unbalanced they were. For each step, the imbalance is the longest compute
+ * time of any process over the mean. Rank 0 prints a summary (imbalance
+ * percentiles, the slowest processes, and the critical path, i.e. the sum
+ * over steps of the longest compute time, which bounds the length of the
+ * run from below if every step waits for the slowest process). If `prefix`
+ * is not empty, it also writes the summary to <prefix>_balance.json, with
+ * per-step figures in <prefix>_balance_steps.csv. If `cost_file` is not
+ * empty, each process's totals are also written there, for
+ * nengo_mpi.partition.work_balanced_partitioner. Collective over `comm`. */
+void report_load_balance(string prefix, const RunLoad& load, string cost_file, MPI_Comm comm);
+
+// `s` as a quoted JSON string.
+string json_string(const string& s);
+
+// Prefix of the files that timings are written to for a simulation
+// logging to `log_filename`: the log filename without its extension, or
+// "nengo_mpi" if there is no log. `run` counts the runs of the simulation
+// from 0; runs after the first add _run<run> to the prefix, so that they
+// don't overwrite the files of earlier runs.
+string timings_prefix(string log_filename, unsigned run=0);
@@ -0,0 +1,225 @@
+#include "trace.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <exception>
+#include <algorithm>
+#include <functional>
+#include <cstdio>
+
+Trace* active_trace = NULL;
+
+// Largest piece of a process's part of the trace file written at once.
+const size_t TRACE_WRITE_BLOCK = 1 << 24;
+
+Trace::Trace(string filename, int rank, MPI_Comm comm)
+:filename(filename), rank(rank), comm(comm), n_dropped(0), part_size(0), part_failed(false){
+
+    stringstream ss;
+    ss << filename << "." << rank << ".part";
+    part_filename = ss.str();
+
+    events.reserve(TRACE_BUFFER_EVENTS);
+
+    name_id("step", "step");
+    name_id("MPI_Wait", "mpi");
+    name_id("flush probes", "probes");
+    name_id("write log", "io");
+    name_id("flush trace", "trace");
+
+    if(comm != MPI_COMM_NULL){
+        MPI_Barrier(comm);
+    }
+
+    origin = timing_clock::now();
+}
+
+Trace::~Trace(){
+    if(part.is_open()){
+        part.close();
+        remove(part_filename.c_str());
+    }
+}
+
+unsigned Trace::name_id(string name, string category){
+    auto key = make_pair(name, category);
+    auto found = name_ids.find(key);
+
+    if(found != name_ids.end()){
+        return found->second;
+    }
+
+    unsigned id = names.size();
+    names.push_back(key);
+    name_ids[key] = id;
+    return id;
+}
+
+void Trace::flush(){
+    auto begin = timing_clock::now();
+
+    if(!part.is_open()){
+        part.open(part_filename, ios::binary | ios::trunc);
+    }
+
+    string json;
+    if(part){
+        json = events_json();
+        part.write(json.data(), json.size());
+    }
+
+    if(!part){
+        // Keep the buffered events for write, and drop the ones that follow.
+        part_failed = true;
+        cout << "Warning: rank " << rank << " could not write its trace part file "
+             << part_filename << "; trace events that do not fit in memory "
+             << "will be dropped." << endl;
+        return;
+    }
+
+    part_size += json.size();
+    events.clear();
+
+    events.push_back(
+        {elapsed_ns(origin, begin), elapsed_ns(origin, timing_clock::now()), TRACE_FLUSH});
+}
+
+string Trace::events_json() const{
+    stringstream out;
+    out << fixed << setprecision(3);
+
+    vector<string> quoted_names, quoted_categories;
+    for(auto& n : names){
+        quoted_names.push_back(json_string(n.first));
+        quoted_categories.push_back(json_string(n.second));
+    }
+
+    for(const TraceEvent& e : events){
+        out << "," << endl
+            << "{\"name\": " << quoted_names[e.name]
+            << ", \"cat\": " << quoted_categories[e.name]
+            << ", \"ph\": \"X\", \"pid\": " << rank << ", \"tid\": 0"
+            << ", \"ts\": " << e.begin_ns * 1e-3
+            << ", \"dur\": " << (e.end_ns - e.begin_ns) * 1e-3 << "}";
+    }
+
+    return out.str();
+}
+
+void Trace::write(){
+    if(n_dropped > 0){
+        cout << "Warning: rank " << rank << " dropped " << n_dropped
+             << " trace events because its trace part file " << part_filename
+             << " could not be written." << endl;
+    }
+
+    stringstream metadata;
+    metadata << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " << rank
+             << ", \"args\": {\"name\": \"Rank " << rank << "\"}}," << endl;
+    metadata << "{\"name\": \"process_sort_index\", \"ph\": \"M\", \"pid\": " << rank
+             << ", \"args\": {\"sort_index\": " << rank << "}}";
+
+    string header = "{\"traceEvents\": [\n";
+    string trailer = "\n]}\n";
+
+    int comm_rank = 0, n_processors = 1;
+    if(comm != MPI_COMM_NULL){
+        MPI_Comm_rank(comm, &comm_rank);
+        MPI_Comm_size(comm, &n_processors);
+    }
+
+    // This process's part of the file is `head`, then the events in the
+    // part file, then `tail`.
+    string head = (comm_rank == 0 ? header : ",\n") + metadata.str();
+    string tail = events_json();
+    if(comm_rank == n_processors - 1){
+        tail += trailer;
+    }
+
+    ifstream flushed;
+    if(part.is_open()){
+        part.close();
+        flushed.open(part_filename, ios::binary);
+    }
+
+    // Calls write_block(data, size, offset) on consecutive blocks of this
+    // process's part of the file, `offset` being relative to its start.
+    auto for_each_block = [&](function<void(const char*, size_t, uint64_t)> write_block){
+        write_block(head.data(), head.size(), 0);
+
+        vector<char> buffer(TRACE_WRITE_BLOCK);
+        bool readable = true;
+
+        for(uint64_t copied = 0; copied < part_size; ){
+            size_t count = min<uint64_t>(TRACE_WRITE_BLOCK, part_size - copied);
+
+            // Throwing here would leave the other processes in the
+            // collective close, so events that can't be read become blanks.
+            if(readable && !flushed.read(buffer.data(), count)){
+                cout << "Warning: rank " << rank << " could not read trace part file "
+                     << part_filename << "; some of its events are missing." << endl;
+                readable = false;
+            }
+
+            if(!readable){
+                fill(buffer.begin(), buffer.begin() + count, ' ');
+            }
+
+            write_block(buffer.data(), count, head.size() + copied);
+            copied += count;
+        }
+
+        for(size_t written = 0; written < tail.size(); written += TRACE_WRITE_BLOCK){
+            size_t count = min(TRACE_WRITE_BLOCK, tail.size() - written);
+            write_block(tail.data() + written, count, head.size() + part_size + written);
+        }
+    };
+
+    if(comm == MPI_COMM_NULL){
+        ofstream out(filename);
+        for_each_block([&](const char* data, size_t count, uint64_t){
+            out.write(data, count);
+        });
+
+        if(!out){
+            stringstream msg;
+            msg << "Could not write trace file " << filename << ".";
+            throw runtime_error(msg.str());
+        }
+    }else{
+        long long size = head.size() + part_size + tail.size(), offset = 0;
+        MPI_Exscan(&size, &offset, 1, MPI_LONG_LONG, MPI_SUM, comm);
+        if(comm_rank == 0){
+            offset = 0;
+        }
+
+        vector<char> c_filename(filename.begin(), filename.end());
+        c_filename.push_back('\0');
+
+        MPI_File fh;
+        int err = MPI_File_open(
+            comm, c_filename.data(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh);
+
+        if(err != MPI_SUCCESS){
+            stringstream msg;
+            msg << "Could not open trace file " << filename << ".";
+            throw runtime_error(msg.str());
+        }
+
+        // Drop what is left of an older, longer trace.
+        MPI_File_set_size(fh, 0);
+
+        for_each_block([&](const char* data, size_t count, uint64_t block_offset){
+            MPI_File_write_at(
+                fh, offset + block_offset, (void*) data, count, MPI_CHAR, MPI_STATUS_IGNORE);
+        });
+
+        MPI_File_close(&fh);
+    }
+
+    if(flushed.is_open()){
+        flushed.close();
+        remove(part_filename.c_str());
+    }
+}
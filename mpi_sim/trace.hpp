@@ -0,0 +1,127 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+
+#include <mpi.h>
+
+#include "timing.hpp"
+
+using namespace std;
+
+// Number of events each process buffers in memory. When the buffer is
+// full its events are flushed to the process's part file, so tracing never
+// allocates mid-run and long runs keep every event.
+const size_t TRACE_BUFFER_EVENTS = 1 << 20;
+
+// Event names that are always registered, in this order.
+enum TraceName {
+    TRACE_STEP, TRACE_MPI_WAIT, TRACE_PROBE_FLUSH, TRACE_LOG_WRITE, TRACE_FLUSH,
+    TRACE_N_BUILTIN_NAMES};
+
+struct TraceEvent{
+    uint64_t begin_ns;
+    uint64_t end_ns;
+    unsigned name;
+};
+
+/* A timeline of one process's simulation, in the Chrome trace format that
+ * chrome://tracing and Perfetto display. Events are begin/end pairs on one
+ * track per process, stored in a buffer allocated up front.
+ *
+ * While a trace is active (see set_active_trace), the simulation records
+ * a step event for each step, an event for each run of consecutive
+ * operators of the same class, and events for MPI waits, probe flushes and
+ * writes to the simulation log.
+ *
+ * Whenever the buffer fills up, its events are converted to JSON and
+ * appended to <filename>.<rank>.part, which write copies into the trace
+ * file and removes. Each such flush is itself recorded as an event. */
+class Trace{
+public:
+    /* Collective over `comm` (which may be MPI_COMM_NULL for a serial
+     * simulation): the processes synchronize with a barrier and take the
+     * time just after it as their common origin. The trace is written to
+     * `filename`; `rank` is the process's track in it. */
+    Trace(string filename, int rank, MPI_Comm comm);
+    ~Trace();
+
+    /* Return the id of the event with the given name and category,
+     * registering it if necessary. */
+    unsigned name_id(string name, string category);
+
+    void record(unsigned name, timing_clock::time_point begin, timing_clock::time_point end){
+        if(events.size() == events.capacity() && !part_failed){
+            flush();
+        }
+
+        if(events.size() < events.capacity()){
+            events.push_back({elapsed_ns(origin, begin), elapsed_ns(origin, end), name});
+        }else{
+            n_dropped++;
+        }
+    }
+
+    // Events dropped because the part file could not be written.
+    size_t n_dropped_events() const { return n_dropped; }
+
+    /* Write the events of all processes to one JSON file. Each process
+     * writes its own part of the file with MPI I/O. Collective over the
+     * `comm` given to the constructor. */
+    void write();
+
+protected:
+    string filename;
+    int rank;
+    MPI_Comm comm;
+    timing_clock::time_point origin;
+
+    vector<TraceEvent> events;
+    size_t n_dropped;
+
+    // Events flushed so far, and the number of bytes of JSON they took.
+    // Once the part file fails, events that do not fit are dropped.
+    string part_filename;
+    ofstream part;
+    uint64_t part_size;
+    bool part_failed;
+
+    vector<pair<string, string>> names;
+    map<pair<string, string>, unsigned> name_ids;
+
+    // Append the buffered events to the part file and empty the buffer.
+    void flush();
+
+    // The buffered events as JSON objects, each preceded by a comma.
+    string events_json() const;
+};
+
+// The trace that the simulation records into, or NULL if not tracing.
+extern Trace* active_trace;
+
+inline void set_active_trace(Trace* trace){
+    active_trace = trace;
+}
+
+// Record an event for the enclosing scope in the active trace, if any.
+class TraceScope{
+public:
+    TraceScope(unsigned name):name(name){
+        if(active_trace){
+            begin = timing_clock::now();
+        }
+    }
+
+    ~TraceScope(){
+        if(active_trace){
+            active_trace->record(name, begin, timing_clock::now());
+        }
+    }
+
+private:
+    unsigned name;
+    timing_clock::time_point begin;
+};
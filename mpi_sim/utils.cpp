@@ -1,5 +1,11 @@
 #include "utils.hpp"
 
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <cstring>
+
 unique_ptr<BaseSignal> python_list_to_signal(string s, bool get_size){
     boost::trim_if(s, boost::is_any_of("[]"));
 
@@ -58,3 +64,66 @@ vector<int> python_list_to_index_vector(string s){
 
     return result;
 }
+
+void parallel_for(size_t n, unsigned n_threads, function<void(size_t)> f){
+    if(n_threads <= 1 || n <= 1){
+        for(size_t i = 0; i < n; i++){
+            f(i);
+        }
+
+        return;
+    }
+
+    atomic<size_t> next(0);
+    exception_ptr error;
+    mutex error_mutex;
+
+    auto work = [&](){
+        size_t i;
+        while((i = next++) < n){
+            try{
+                f(i);
+            }catch(...){
+                lock_guard<mutex> lock(error_mutex);
+                if(!error){
+                    error = current_exception();
+                }
+
+                next = n;
+            }
+        }
+    };
+
+    vector<thread> threads;
+    for(unsigned t = 1; t < n_threads; t++){
+        threads.push_back(thread(work));
+    }
+
+    work();
+
+    for(thread& t : threads){
+        t.join();
+    }
+
+    if(error){
+        rethrow_exception(error);
+    }
+}
+
+uint64_t hash_signal(const BaseSignal& signal){
+    // FNV-1a over the shape and the 64-bit patterns of the values.
+    const uint64_t prime = 0x100000001b3;
+    uint64_t hash = 0xcbf29ce484222325;
+
+    hash = (hash ^ signal.size1()) * prime;
+    hash = (hash ^ signal.size2()) * prime;
+
+    const auto& data = signal.data();
+    for(size_t i = 0; i < data.size(); i++){
+        uint64_t word;
+        memcpy(&word, &data[i], sizeof(word));
+        hash = (hash ^ word) * prime;
+    }
+
+    return hash;
+}
@@ -3,6 +3,8 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <functional>
+#include <cstdint>
 
 #include "operator.hpp"
 
@@ -19,3 +21,12 @@ unique_ptr<BaseSignal> python_list_to_signal(string s, bool get_size=false);
  * index_0, index_1, ..., index_(n-1)
  * The length of the returned vector is n */
 vector<int> python_list_to_index_vector(string s);
+
+/* Call f(i) for every i in [0, n), spread over n_threads threads (including
+ * the calling thread). Returns once every call has finished. If any call
+ * throws, the remaining indices are skipped and the first exception is
+ * rethrown in the calling thread. */
+void parallel_for(size_t n, unsigned n_threads, function<void(size_t)> f);
+
+/* 64-bit hash of the shape and the values (bit for bit) of a signal. */
+uint64_t hash_signal(const BaseSignal& signal);
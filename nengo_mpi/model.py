@@ -21,6 +21,7 @@ except ImportError:
 import nengo
 from nengo import builder
 from nengo.builder import Builder as DefaultBuilder
+from nengo.builder.signal import Signal
 from nengo.neurons import LIF, LIFRate, RectifiedLinear, Sigmoid
 from nengo.neurons import AdaptiveLIF, AdaptiveLIFRate, Izhikevich
 from nengo.synapses import LinearFilter, Triangle
@@ -31,7 +32,7 @@ from nengo.utils.simulator import operator_depencency_graph
 from nengo.cache import NoDecoderCache
 from nengo.network import Network
 from nengo.connection import Connection
-from nengo.ensemble import Ensemble
+from nengo.ensemble import Ensemble, Neurons
 from nengo.node import Node
 from nengo.probe import Probe
 
@@ -43,9 +44,8 @@ import numpy as np
 from collections import defaultdict, OrderedDict
 import warnings
 from itertools import chain
+import numbers
 import re
-import os
-import tempfile
 
 import logging
 logger = logging.getLogger(__name__)
@@ -54,6 +54,33 @@ OP_DELIM = ";"
 SIGNAL_DELIM = ":"
 PROBE_DELIM = "|"
 
+# Ways that the C++ simulator can store probe data in its HDF5 log.
+PROBE_STORAGE_DENSE = "dense"
+PROBE_STORAGE_EVENTS = "events"
+PROBE_STORAGE_MODES = (PROBE_STORAGE_DENSE, PROBE_STORAGE_EVENTS)
+
+# Neuron types whose output is zero except at spikes.
+SPIKING_NEURON_TYPES = (LIF, AdaptiveLIF, Izhikevich)
+
+# Layout of the binary operator tables; must match mpi_sim/op_table.hpp.
+OP_TABLE_VERSION = 1
+OP_TABLE_GROUP = "op_tables"
+OP_TABLE_PARAMS = "op_params"
+SIGNAL_REF_DTYPE = np.dtype([
+    ('key', 'i8'), ('shape1', 'i4'), ('shape2', 'i4'),
+    ('stride1', 'i4'), ('stride2', 'i4'), ('offset', 'i4')])
+ARRAY_REF_DTYPE = np.dtype([
+    ('offset', 'i8'), ('size1', 'i4'), ('size2', 'i4')])
+
+# Kinds of operator table fields; must match OpTableField in op_table.hpp.
+OP_FIELD_INTEGER, OP_FIELD_REAL, OP_FIELD_SIGNAL, OP_FIELD_ARRAY = range(4)
+OP_FIELD_DTYPES = {
+    OP_FIELD_INTEGER: np.dtype('i8'), OP_FIELD_REAL: np.dtype('f8'),
+    OP_FIELD_SIGNAL: SIGNAL_REF_DTYPE, OP_FIELD_ARRAY: ARRAY_REF_DTYPE}
+
+# Layout of packed components; must match mpi_sim/component_buffer.hpp.
+COMPONENT_BUFFER_VERSION = 1
+
 
 def make_builder(base_function):
     """ Return an augmented version of an existing builder function.
@@ -375,6 +402,227 @@ def ndarray_to_string(a):
     return s
 
 
+def pad_shape(x):
+    """ Pad a shape or strides tuple to 2 dimensions. """
+    return (1, 1) if len(x) == 0 else ((x[0], 1) if len(x) == 1 else x)
+
+
+def signal_to_ref(signal):
+    """ Convert a signal to a record of type SIGNAL_REF_DTYPE.
+
+    Holds the same information as the string created by signal_to_string.
+
+    """
+    return (
+        (make_key(signal.base),) + tuple(pad_shape(signal.shape)) +
+        tuple(pad_shape(signal.elemstrides or ())) + (signal.offset,))
+
+
+class OpArray(object):
+    """ An array-valued operator argument.
+
+    In op strings, the array is written as a comma-separated list, preceded
+    by its 2D shape if ``with_shape`` is True. In operator tables it is
+    stored in the op_params dataset.
+
+    """
+    def __init__(self, values, with_shape=False):
+        values = np.asarray(values)
+        self.with_shape = with_shape
+        self.values = (
+            np.atleast_2d(values) if with_shape else values.reshape(-1, 1))
+
+    def __str__(self):
+        if self.with_shape:
+            return ndarray_to_string(self.values)
+        return ",".join(map(str, self.values.flatten()))
+
+
+def op_arg_to_string(arg):
+    return signal_to_string(arg) if isinstance(arg, Signal) else str(arg)
+
+
+def is_table_arg(arg):
+    return isinstance(arg, (Signal, OpArray, numbers.Number))
+
+
+def op_table_fields(records):
+    """ Return the kind (an OP_FIELD_* value) of each argument of a table.
+
+    ``records`` is a list of (index, args) pairs for operators of one type,
+    where every element of ``args`` is a Signal, an OpArray or a number.
+
+    """
+    n_args = len(records[0][1])
+    fields = []
+
+    for i in range(n_args):
+        column = [args[i] for index, args in records]
+
+        if isinstance(column[0], Signal):
+            fields.append(OP_FIELD_SIGNAL)
+        elif isinstance(column[0], OpArray):
+            fields.append(OP_FIELD_ARRAY)
+        elif all(isinstance(a, numbers.Integral) for a in column):
+            fields.append(OP_FIELD_INTEGER)
+        else:
+            fields.append(OP_FIELD_REAL)
+
+    return fields
+
+
+def op_table_rows(records, params, n_params):
+    """ Convert (index, args) records into rows of an operator table.
+
+    The values of array arguments are appended to ``params``, a list of
+    flat float64 arrays holding ``n_params`` values in total. Returns the
+    rows and the new number of values in ``params``.
+
+    """
+    rows = []
+
+    for index, args in records:
+        row = [index]
+
+        for arg in args:
+            if isinstance(arg, Signal):
+                row.append(signal_to_ref(arg))
+            elif isinstance(arg, OpArray):
+                row.append((n_params,) + arg.values.shape)
+                params.append(arg.values.flatten().astype(np.float64))
+                n_params += arg.values.size
+            else:
+                row.append(arg)
+
+        rows.append(tuple(row))
+
+    return rows, n_params
+
+
+def store_op_tables(h5_group, op_records, compression='gzip'):
+    """ Store operators as binary tables, one compound dataset per type.
+
+    ``op_records`` maps each operator type string to a list of
+    (index, args) pairs, where every element of ``args`` is a Signal,
+    an OpArray or a number. See mpi_sim/op_table.hpp for the layout.
+
+    """
+    tables = h5_group.create_group(OP_TABLE_GROUP)
+    tables.attrs['version'] = OP_TABLE_VERSION
+
+    params = []
+    n_params = 0
+
+    for op_type, records in op_records.items():
+        fields = [('index', 'f8')] + [
+            ('arg%d' % i, OP_FIELD_DTYPES[field])
+            for i, field in enumerate(op_table_fields(records))]
+
+        rows, n_params = op_table_rows(records, params, n_params)
+
+        tables.create_dataset(
+            op_type, data=np.array(rows, dtype=fields),
+            compression=compression)
+
+    params = np.concatenate(params) if params else np.zeros(0)
+    tables.create_dataset(
+        OP_TABLE_PARAMS, data=params, dtype='float64',
+        compression=compression if params.size else None)
+
+
+def pack_strings(strings):
+    """ Pack a list of strings as in a packed component.
+
+    The strings are null-terminated and padded with nulls to a multiple
+    of 8 bytes, and preceded by their total size.
+
+    """
+    data = ''.join(s + '\0' for s in strings)
+    data += '\0' * (-len(data) % 8)
+    return np.array([len(data)], dtype='i8').tostring() + data
+
+
+def pack_op_table(op_type, records, params, n_params):
+    """ Pack the operators of one type as in a packed component.
+
+    Rows get the in-memory layout of mpi_sim/op_table.hpp: every field
+    starts at a multiple of 8 bytes. Returns the packed table and the new
+    number of values in ``params`` (see op_table_rows).
+
+    """
+    fields = [OP_FIELD_REAL] + op_table_fields(records)
+
+    offsets = [0]
+    for field in fields:
+        size = OP_FIELD_DTYPES[field].itemsize
+        offsets.append(offsets[-1] + (size + 7) // 8 * 8)
+
+    row_dtype = np.dtype({
+        'names': ['index'] + ['arg%d' % i for i in range(len(fields) - 1)],
+        'formats': [OP_FIELD_DTYPES[field] for field in fields],
+        'offsets': offsets[:-1], 'itemsize': offsets[-1]})
+
+    rows, n_params = op_table_rows(records, params, n_params)
+
+    packed = (
+        pack_strings([op_type]) +
+        np.array([len(fields), len(rows)] + fields, dtype='i8').tostring() +
+        np.array(rows, dtype=row_dtype).tostring())
+
+    return packed, n_params
+
+
+def pack_component(signals, op_records, op_strings, probe_strings):
+    """ Pack one component for MpiSimulator.load_network_from_buffers.
+
+    ``signals`` is a list of (key, signal) pairs and ``op_records`` maps
+    operator type strings to (index, args) records, as for store_op_tables.
+    See mpi_sim/component_buffer.hpp for the layout.
+
+    """
+    data = [signal_data(sig).flatten() for key, sig in signals]
+    data = np.concatenate(data) if data else np.zeros(0)
+
+    params = []
+    n_params = 0
+    tables = []
+
+    for op_type, records in op_records.items():
+        table, n_params = pack_op_table(op_type, records, params, n_params)
+        tables.append(table)
+
+    params = np.concatenate(params) if params else np.zeros(0)
+
+    header = [
+        COMPONENT_BUFFER_VERSION, len(signals), data.size, params.size,
+        len(tables), len(op_strings), len(probe_strings)]
+
+    return ''.join([
+        np.array(header, dtype='i8').tostring(),
+        np.array([long(key) for key, sig in signals], dtype='i8').tostring(),
+        np.array(
+            [pad_shape(sig.shape) for key, sig in signals],
+            dtype='i8').tostring(),
+        data.astype(np.float64).tostring(),
+        pack_strings([str(sig) for key, sig in signals]),
+        params.astype(np.float64).tostring()] + tables + [
+        pack_strings(op_strings),
+        pack_strings(probe_strings)])
+
+
+def signal_data(signal):
+    """ The initial value of a signal as a float64 array of at least 2D. """
+    A = signal.base._initial_value
+
+    if A.ndim == 0:
+        A = np.reshape(A, (1, 1))
+
+    if A.dtype != np.float64:
+        A = A.astype(np.float64)
+
+    return A
+
+
 def store_string_list(
         h5_file, dset_name, strings, final_null=True, compression='gzip'):
     """ Store a list of strings as a dataset in an hdf5 file or group.
@@ -428,11 +676,22 @@ class MpiModel(builder.Model):
         provided, then instead of creating a runnable simulator, the result
         of building the model is saved to a file which can be loaded by
         the executables bin/nengo_mpi and bin/nengo_cpp to run simulations.
+    probe_storage: dict
+        Maps probes to the way their data should be stored when logging
+        to an HDF5 file, either "dense" or "events". Probes not in the
+        dictionary use "events" if they probe the output of spiking
+        neurons, and "dense" otherwise.
+    op_tables: bool
+        If True, operators are written to the network file as binary tables,
+        one per operator type (see mpi_sim/op_table.hpp). Otherwise, and for
+        operators with arguments that can't be stored in a table, operators
+        are written as strings.
 
     """
     def __init__(
             self, n_components, assignments, dt=0.001, label=None,
-            decoder_cache=NoDecoderCache(), save_file=""):
+            decoder_cache=NoDecoderCache(), save_file="", probe_storage=None,
+            op_tables=True):
 
         if not h5py_available:
             raise Exception("h5py not available.")
@@ -447,17 +706,17 @@ class MpiModel(builder.Model):
                 "argument was empty.")
 
         # Only create a working simulator if our goal is not to simply
-        # save the network to a file
+        # save the network to a file. A working simulator is handed the
+        # network in memory, so no file is written at all.
         self.mpi_sim = MpiSimulator() if not save_file else None
 
         self.h5_compression = 'gzip'
         self.op_strings = defaultdict(list)
+        self.op_records = defaultdict(lambda: defaultdict(list))
+        self.op_tables = op_tables
         self.probe_strings = defaultdict(list)
         self.all_probe_strings = []
 
-        if not save_file:
-            save_file = tempfile.mktemp()
-
         self.save_file_name = save_file
 
         # for each component, stores the keys of the signals that have
@@ -479,6 +738,14 @@ class MpiModel(builder.Model):
         # Used to query the C++ simulator for probe data
         self.probe_keys = {}
 
+        self.probe_storage = {} if probe_storage is None else probe_storage
+
+        for probe, storage in self.probe_storage.items():
+            if storage not in PROBE_STORAGE_MODES:
+                raise ValueError(
+                    "Invalid storage mode %s for probe %s. Must be one "
+                    "of %s." % (storage, probe, PROBE_STORAGE_MODES))
+
         self._object_context = [None]
 
         # high-level nengo object -> list of operators
@@ -636,12 +903,13 @@ class MpiModel(builder.Model):
         """ Finalize the build step.
 
         Called once the MpiBuilder has finished running. Finalizes
-        operators and probes, converting them to strings. Then writes
-        all relevant information (signals, ops and probes for each component)
-        to an HDF5 file. Then, if self.mpi_sim is not None (so we want to
-        create a runnable MPI simulator), calls self.mpi_sim.load_file, which
-        tells the C++ code to load the HDF5 file we have just written and
-        create a working simulator.
+        operators and probes, converting them to strings. Then, if
+        self.mpi_sim is None (we are only saving the network), writes all
+        relevant information (signals, ops and probes for each component)
+        to an HDF5 file. Otherwise packs the same information for each
+        component into a byte string and hands the packed components to
+        self.mpi_sim.load_network_from_buffers, which creates a working
+        simulator without going through a file.
 
         """
         all_ops = list(chain(
@@ -656,6 +924,34 @@ class MpiModel(builder.Model):
         self._finalize_ops()
         self._finalize_probes()
 
+        if self.mpi_sim is None:
+            self._save_network()
+            return
+
+        packed = [
+            pack_component(
+                self.signals[component],
+                self.op_records[component] if self.op_tables else {},
+                self.op_strings[component], self.probe_strings[component])
+            for component in range(self.n_components)]
+
+        self.mpi_sim.load_network_from_buffers(
+            self.dt, self.n_components, packed, self.all_probe_strings)
+
+        for args in self.pyfunc_args:
+            f = {
+                'N': self.mpi_sim.create_PyFunc,
+                'I': self.mpi_sim.create_PyFuncI,
+                'O': self.mpi_sim.create_PyFuncO,
+                'IO': self.mpi_sim.create_PyFuncIO}[args[0]]
+            f(*args[1:])
+
+        self.mpi_sim.finalize_build()
+
+    def _save_network(self):
+        """ Write the finalized network to the HDF5 file self.save_file_name.
+
+        """
         with h5.File(self.save_file_name, 'w') as save_file:
             save_file.attrs['dt'] = self.dt
             save_file.attrs['n_components'] = self.n_components
@@ -671,14 +967,7 @@ class MpiModel(builder.Model):
 
                 offset = 0
                 for key, sig in signals:
-                    A = sig.base._initial_value
-
-                    if A.ndim == 0:
-                        A = np.reshape(A, (1, 1))
-
-                    if A.dtype != np.float64:
-                        A = A.astype(np.float64)
-
+                    A = signal_data(sig)
                     signal_dset[offset:offset+A.size] = A.flatten()
                     offset += A.size
 
@@ -688,14 +977,10 @@ class MpiModel(builder.Model):
                     dtype='int64', compression=self.h5_compression)
 
                 # signal shapes
-                def pad(x):
-                    return (
-                        (1, 1) if len(x) == 0 else (
-                            (x[0], 1) if len(x) == 1 else x))
-
                 component_group.create_dataset(
                     'signal_shapes',
-                    data=np.array([pad(sig.shape) for key, sig in signals]),
+                    data=np.array(
+                        [pad_shape(sig.shape) for key, sig in signals]),
                     dtype='u2', compression=self.h5_compression)
 
                 # signal_labels
@@ -705,6 +990,11 @@ class MpiModel(builder.Model):
                     compression=self.h5_compression)
 
                 # operators
+                if self.op_tables:
+                    store_op_tables(
+                        component_group, self.op_records[component],
+                        compression=self.h5_compression)
+
                 op_strings = self.op_strings[component]
                 store_string_list(
                     component_group, 'operators', op_strings,
@@ -721,28 +1011,16 @@ class MpiModel(builder.Model):
                 save_file, 'probe_info', self.all_probe_strings,
                 compression=self.h5_compression)
 
-        if self.mpi_sim is not None:
-            self.mpi_sim.load_network(self.save_file_name)
-            os.remove(self.save_file_name)
-
-            for args in self.pyfunc_args:
-                f = {
-                    'N': self.mpi_sim.create_PyFunc,
-                    'I': self.mpi_sim.create_PyFuncI,
-                    'O': self.mpi_sim.create_PyFuncO,
-                    'IO': self.mpi_sim.create_PyFuncIO}[args[0]]
-                f(*args[1:])
-
-            self.mpi_sim.finalize_build()
-
     def _finalize_ops(self):
         """ Finalize operators.
 
         Main jobs are to create MpiSend and MpiRecv operators based on
-        send_signals and recv_signals, and to turn all ops belonging to
-        the `component` into strings, which are then stored in self.op_strings.
-        PyFunc ops are the only exception, as it is not generally possible to
-        encode an arbitrary python function as a string.
+        send_signals and recv_signals, and to convert all ops belonging to
+        the `component` into rows of binary operator tables (stored in
+        self.op_records) or, if self.op_tables is False or the op has
+        arguments that can't be stored in a table, into strings (stored in
+        self.op_strings). PyFunc ops are the only exception, as it is not
+        generally possible to encode an arbitrary python function this way.
 
         """
         for component in range(self.n_components):
@@ -827,17 +1105,27 @@ class MpiModel(builder.Model):
                     self.pyfunc_args.append(
                         pyfunc_args + [self.global_ordering[op]])
                 else:
-                    op_string = self._op_to_string(op)
+                    op_args = self._op_to_args(op)
+
+                    if not op_args:
+                        continue
+
+                    index = self.global_ordering[op]
+
+                    if self.op_tables and all(map(is_table_arg, op_args[1:])):
+                        self.op_records[component][op_args[0]].append(
+                            (index, op_args[1:]))
+                    else:
+                        op_string = self._op_to_string(index, op_args)
 
-                    if op_string:
                         logger.debug(
                             "Component %d: Adding operator with string: %s",
                             component, op_string)
 
                         self.op_strings[component].append(op_string)
 
-    def _op_to_string(self, op):
-        """ Convert operator into a string.
+    def _op_to_string(self, index, op_args):
+        """ Convert operator arguments into a string.
 
         Such strings will eventually be used to construct operators in the
         C++ code. See the MpiSimulatorChunk::add_op for details on how these
@@ -847,15 +1135,33 @@ class MpiModel(builder.Model):
         operators, which allows the C++ code to put the operators in
         the appropriate order.
 
+        """
+        op_args = [index] + op_args
+
+        op_string = OP_DELIM.join(map(op_arg_to_string, op_args))
+        op_string = op_string.replace(" ", "")
+        op_string = op_string.replace("(", "")
+        op_string = op_string.replace(")", "")
+
+        return op_string
+
+    def _op_to_args(self, op):
+        """ Get the type and positional arguments of an operator.
+
+        Returns a list whose first element is the operator type expected by
+        MpiSimulatorChunk::add_op, followed by its arguments. Signal arguments
+        are left as Signals and array arguments are wrapped in OpArray, so
+        that they can be written either to a string or to an operator table.
+        Returns an empty list for operators that should be skipped.
+
         """
         op_type = type(op)
 
         if op_type == builder.operator.Reset:
-            op_args = ["Reset", signal_to_string(op.dst), op.value]
+            op_args = ["Reset", op.dst, op.value]
 
         elif op_type == builder.operator.Copy:
-            op_args = [
-                "Copy", signal_to_string(op.dst), signal_to_string(op.src)]
+            op_args = ["Copy", op.dst, op.src]
 
         elif op_type == builder.operator.SlicedCopy:
             a = op.src.base
@@ -885,19 +1191,15 @@ class MpiModel(builder.Model):
                     start_B, stop_B, step_B = b_slice.indices(b.size)
 
             op_args = [
-                "SlicedCopy", signal_to_string(b), signal_to_string(a),
+                "SlicedCopy", b, a,
                 int(op.inc), start_A, stop_A, step_A, start_B, stop_B, step_B,
-                str(seq_A), str(seq_B)]
+                OpArray(seq_A), OpArray(seq_B)]
 
         elif op_type == builder.operator.DotInc:
-            op_args = [
-                "DotInc", signal_to_string(op.A), signal_to_string(op.X),
-                signal_to_string(op.Y)]
+            op_args = ["DotInc", op.A, op.X, op.Y]
 
         elif op_type == builder.operator.ElementwiseInc:
-            op_args = [
-                "ElementwiseInc", signal_to_string(op.A),
-                signal_to_string(op.X), signal_to_string(op.Y)]
+            op_args = ["ElementwiseInc", op.A, op.X, op.Y]
 
         elif op_type == builder.neurons.SimNeurons:
             n_neurons = op.J.size
@@ -908,20 +1210,19 @@ class MpiModel(builder.Model):
                 tau_rc = op.neurons.tau_rc
                 min_voltage = op.neurons.min_voltage
 
-                voltage_signal = signal_to_string(op.states[0])
-                ref_time_signal = signal_to_string(op.states[1])
+                voltage_signal = op.states[0]
+                ref_time_signal = op.states[1]
 
                 op_args = [
                     "LIF", n_neurons, tau_rc, tau_ref, min_voltage, self.dt,
-                    signal_to_string(op.J), signal_to_string(op.output),
-                    voltage_signal, ref_time_signal]
+                    op.J, op.output, voltage_signal, ref_time_signal]
 
             elif neuron_type is LIFRate:
                 tau_ref = op.neurons.tau_ref
                 tau_rc = op.neurons.tau_rc
                 op_args = [
                     "LIFRate", n_neurons, tau_rc, tau_ref,
-                    signal_to_string(op.J), signal_to_string(op.output)]
+                    op.J, op.output]
 
             elif neuron_type is AdaptiveLIF:
                 tau_n = op.neurons.tau_n
@@ -932,14 +1233,13 @@ class MpiModel(builder.Model):
 
                 min_voltage = op.neurons.min_voltage
 
-                voltage_signal = signal_to_string(op.states[0])
-                ref_time_signal = signal_to_string(op.states[1])
-                adaptation = signal_to_string(op.states[2])
+                voltage_signal = op.states[0]
+                ref_time_signal = op.states[1]
+                adaptation = op.states[2]
 
                 op_args = [
                     "AdaptiveLIF", n_neurons, tau_n, inc_n, tau_rc, tau_ref,
-                    min_voltage, self.dt, signal_to_string(op.J),
-                    signal_to_string(op.output), voltage_signal,
+                    min_voltage, self.dt, op.J, op.output, voltage_signal,
                     ref_time_signal, adaptation]
 
             elif neuron_type is AdaptiveLIFRate:
@@ -949,22 +1249,18 @@ class MpiModel(builder.Model):
                 tau_rc = op.neurons.tau_rc
                 tau_ref = op.neurons.tau_ref
 
-                adaptation = signal_to_string(op.states[0])
+                adaptation = op.states[0]
 
                 op_args = [
                     "AdaptiveLIFRate", n_neurons, tau_n, inc_n,
-                    tau_rc, tau_ref, self.dt, signal_to_string(op.J),
-                    signal_to_string(op.output), adaptation]
+                    tau_rc, tau_ref, self.dt, op.J, op.output, adaptation]
 
             elif neuron_type is RectifiedLinear:
-                op_args = [
-                    "RectifiedLinear", n_neurons, signal_to_string(op.J),
-                    signal_to_string(op.output)]
+                op_args = ["RectifiedLinear", n_neurons, op.J, op.output]
 
             elif neuron_type is Sigmoid:
                 op_args = [
-                    "Sigmoid", n_neurons, op.neurons.tau_ref,
-                    signal_to_string(op.J), signal_to_string(op.output)]
+                    "Sigmoid", n_neurons, op.neurons.tau_ref, op.J, op.output]
 
             elif neuron_type is Izhikevich:
                 tau_recovery = op.neurons.tau_recovery
@@ -972,14 +1268,13 @@ class MpiModel(builder.Model):
                 reset_voltage = op.neurons.reset_voltage
                 reset_recovery = op.neurons.reset_recovery
 
-                voltage = signal_to_string(op.states[0])
-                recovery = signal_to_string(op.states[1])
+                voltage = op.states[0]
+                recovery = op.states[1]
 
                 op_args = [
                     "Izhikevich", n_neurons, tau_recovery, coupling,
                     reset_voltage, reset_recovery, self.dt,
-                    signal_to_string(op.J), signal_to_string(op.output),
-                    voltage, recovery]
+                    op.J, op.output, voltage, recovery]
 
             else:
                 raise NotImplementedError(
@@ -995,18 +1290,15 @@ class MpiModel(builder.Model):
 #
 #                if len(num) == 1 and len(den) == 0:
 #                    op_args = [
-#                        "NoDenSynapse", signal_to_string(op.input),
-#                        signal_to_string(op.output), num[0]]
+#                        "NoDenSynapse", op.input, op.output, num[0]]
 #                elif len(num) == 1 and len(den) == 1:
 #                    op_args = [
-#                        "SimpleSynapse", signal_to_string(op.input),
-#                        signal_to_string(op.output), den[0], num[0]]
+#                        "SimpleSynapse", op.input, op.output,
+#                        den[0], num[0]]
 #                else:
 #                    op_args = [
-#                        "Synapse", signal_to_string(op.input),
-#                        signal_to_string(op.output),
-#                        ",".join(map(str, num)),
-#                        ",".join(map(str, den))]
+#                        "Synapse", op.input, op.output,
+#                        OpArray(num), OpArray(den)]
 #
 #            elif isinstance(op.synapse, Triangle):
 #                f = op.synapse.make_step(self.dt, op.output)
@@ -1017,8 +1309,8 @@ class MpiModel(builder.Model):
 #                n_taps = x.maxlen
 #
 #                op_args = [
-#                    "TriangleSynapse", signal_to_string(op.input),
-#                    signal_to_string(op.output), n0, ndiff, n_taps]
+#                    "TriangleSynapse", op.input, op.output,
+#                    n0, ndiff, n_taps]
 #
 #            else:
 #                raise NotImplementedError(
@@ -1035,7 +1327,7 @@ class MpiModel(builder.Model):
                 do_scale = op.process.scale
 
                 op_args = [
-                    "WhiteNoise", signal_to_string(op.output),
+                    "WhiteNoise", op.output,
                     float(mean), float(std), int(do_scale), int(op.inc),
                     self.dt]
 
@@ -1047,8 +1339,8 @@ class MpiModel(builder.Model):
                 coefs = closures['signal']
 
                 op_args = [
-                    "WhiteSignal", signal_to_string(op.output),
-                    ndarray_to_string(coefs)]
+                    "WhiteSignal", op.output,
+                    OpArray(coefs, with_shape=True)]
 
             elif process_type in [FilteredNoise, BrownNoise]:
                 raise NotImplementedError(
@@ -1060,29 +1352,19 @@ class MpiModel(builder.Model):
 
         elif op_type == builder.learning_rules.SimBCM:
             op_args = [
-                "BCM", signal_to_string(op.pre_filtered),
-                signal_to_string(op.post_filtered),
-                signal_to_string(op.theta),
-                signal_to_string(op.delta),
-                op.learning_rate, self.dt]
+                "BCM", op.pre_filtered, op.post_filtered, op.theta,
+                op.delta, op.learning_rate, self.dt]
 
         elif op_type == builder.learning_rules.SimOja:
             op_args = [
-                "Oja", signal_to_string(op.pre_filtered),
-                signal_to_string(op.post_filtered),
-                signal_to_string(op.weights),
-                signal_to_string(op.delta),
-                op.learning_rate, self.dt, op.beta]
+                "Oja", op.pre_filtered, op.post_filtered, op.weights,
+                op.delta, op.learning_rate, self.dt, op.beta]
 
         elif op_type == builder.learning_rules.SimVoja:
             op_args = [
-                "Voja", signal_to_string(op.pre_decoded),
-                signal_to_string(op.post_filtered),
-                signal_to_string(op.scaled_encoders),
-                signal_to_string(op.delta),
-                signal_to_string(op.learning_signal),
-                ",".join(map(str, op.scale)),
-                op.learning_rate, self.dt]
+                "Voja", op.pre_decoded, op.post_filtered,
+                op.scaled_encoders, op.delta, op.learning_signal,
+                OpArray(op.scale), op.learning_rate, self.dt]
 
         elif op_type == builder.operator.PreserveValue:
             logger.debug(
@@ -1100,10 +1382,8 @@ class MpiModel(builder.Model):
             op_args = ["MpiRecv", op.src, op.tag, signal_key]
 
         elif op_type == SpaunStimulusOperator:
-            output = signal_to_string(op.output)
-
             op_args = [
-                "SpaunStimulus", output, op.stimulus_sequence,
+                "SpaunStimulus", op.output, op.stimulus_sequence,
                 op.present_interval, op.present_blanks, op.identifier]
 
         else:
@@ -1111,15 +1391,27 @@ class MpiModel(builder.Model):
                 "nengo_mpi cannot handle operator of "
                 "type %s" % str(op_type))
 
-        if op_args:
-            op_args = [self.global_ordering[op]] + op_args
+        return op_args
 
-        op_string = OP_DELIM.join(map(str, op_args))
-        op_string = op_string.replace(" ", "")
-        op_string = op_string.replace("(", "")
-        op_string = op_string.replace(")", "")
+    def _probe_storage_mode(self, probe):
+        """ Return the way the data for ``probe'' should be logged.
 
-        return op_string
+        Spike trains are almost entirely zeros, so by default unfiltered
+        probes on the output of spiking neurons store only the locations of
+        the spikes. A probe with a synapse records continuous values, so it
+        is always stored densely.
+
+        """
+        if probe in self.probe_storage:
+            return self.probe_storage[probe]
+
+        target = probe.target
+        if (isinstance(target, Neurons) and probe.attr == 'output' and
+                probe.synapse is None and
+                isinstance(target.ensemble.neuron_type, SPIKING_NEURON_TYPES)):
+            return PROBE_STORAGE_EVENTS
+
+        return PROBE_STORAGE_DENSE
 
     def _finalize_probes(self):
         """ Finalize probes.
@@ -1147,9 +1439,12 @@ class MpiModel(builder.Model):
                 component, str(signal), probe_key,
                 signal_string, period)
 
+            storage = self._probe_storage_mode(probe)
+
             probe_string = PROBE_DELIM.join(
                 str(i) for i
-                in [component, probe_key, signal_string, period, str(probe)])
+                in [component, probe_key, signal_string,
+                    period, str(probe), storage])
 
             self.probe_strings[component].append(probe_string)
             self.all_probe_strings.append(probe_string)
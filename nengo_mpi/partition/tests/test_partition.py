@@ -4,6 +4,7 @@ from nengo_mpi import Simulator
 
 from nengo_mpi import Partitioner, PartitionError
 from nengo_mpi.partition import work_balanced_partitioner
+from nengo_mpi.partition.work_balanced import read_rank_costs
 from nengo_mpi.partition import metis_available, metis_partitioner
 
 from nengo_mpi.partition.base import network_to_cluster_graph
@@ -80,6 +81,56 @@ def test_work_balanced(simple_network):
     os.remove(save_file)
 
 
+def test_work_balanced_rank_costs(tmpdir):
+    save_file = 'test.net'
+
+    network = nengo.Network()
+
+    with network:
+        A = nengo.Ensemble(100, 1, label='A')
+        B = nengo.Ensemble(60, 1, label='B')
+        C = nengo.Ensemble(50, 1, label='C')
+
+    _, cluster_graph = network_to_cluster_graph(network)
+
+    def partition(**kwargs):
+        assignments = work_balanced_partitioner(cluster_graph, 2, **kwargs)
+
+        components = {}
+        for cluster, component in assignments.items():
+            components.setdefault(component, set()).update(cluster.objects)
+
+        return set(frozenset(c) for c in components.values())
+
+    # By neuron count, A is balanced against B and C.
+    previous_assignments = {A: 0, B: 1, C: 1}
+    assert partition() == set([frozenset([A]), frozenset([B, C])])
+
+    # Rank 1 was three times as slow per neuron as rank 0, so B (1.8) and
+    # C (1.5) now cost more than A (1.0), and B is balanced against A and C.
+    cost_file = str(tmpdir.join('costs.csv'))
+    with open(cost_file, 'w') as f:
+        f.write("rank,n_steps,n_operators,n_mpi_operators,compute,wait,step\n")
+        f.write("0,1000,10,1,1.0,2.3,3.3\n")
+        f.write("1,1000,20,1,3.3,0.0,3.3\n")
+
+    assert read_rank_costs(cost_file) == [1.0, 3.3]
+
+    components = partition(
+        rank_costs=cost_file, previous_assignments=previous_assignments)
+    assert components == set([frozenset([B]), frozenset([A, C])])
+
+    n_components = 2
+    partitioner = Partitioner(
+        n_components, func=work_balanced_partitioner,
+        rank_costs=cost_file, previous_assignments=previous_assignments)
+    sim = Simulator(network, partitioner=partitioner, save_file=save_file)
+
+    assert sim.n_components == n_components
+    assert os.path.isfile(save_file)
+    os.remove(save_file)
+
+
 def test_no_partitioner(simple_network):
     save_file = 'test.net'
 
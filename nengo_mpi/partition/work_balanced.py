@@ -1,12 +1,19 @@
 from heapq import heapify, heappush, heappop
 
 
-def work_balanced_partitioner(cluster_graph, n_components):
+def work_balanced_partitioner(
+        cluster_graph, n_components, rank_costs=None,
+        previous_assignments=None):
     """
     Tries to give each component of the partition an equal number of
     neurons, making no attempt to minimize the weight of edges that
     straddle component boundaries.
 
+    If the measured cost of each process from an earlier run is supplied,
+    neurons are weighted by how expensive they turned out to be on the
+    process that simulated them, so that the new partition balances
+    measured work rather than neuron counts.
+
     Parameters
     ----------
     cluster_graph: networkx Graph
@@ -15,6 +22,15 @@ def work_balanced_partitioner(cluster_graph, n_components):
     n_components: int
         Desired number of components in the partition.
 
+    rank_costs: str or list (optional)
+        The cost of each process in an earlier run of the same network:
+        either the file written by ``nengo_mpi --rank-costs``, or a list
+        giving the compute time of each rank.
+
+    previous_assignments: dict (optional)
+        A mapping from nengo objects to components, giving the partition
+        used for that earlier run. Required if rank_costs is supplied.
+
     Returns
     -------
     assignments: dict
@@ -23,9 +39,17 @@ def work_balanced_partitioner(cluster_graph, n_components):
     """
     assert n_components > 1
 
+    key = lambda n: n.n_neurons
+
+    if rank_costs is not None:
+        if previous_assignments is None:
+            raise ValueError(
+                "previous_assignments must be supplied with rank_costs.")
+
+        key = measured_cost_key(rank_costs, previous_assignments)
+
     components, _ = greedy_balanced_partition(
-        cluster_graph.nodes(), n_components,
-        key=lambda n: n.n_neurons)
+        cluster_graph.nodes(), n_components, key=key)
 
     assignments = {}
     for i, c in enumerate(components):
@@ -35,6 +59,70 @@ def work_balanced_partitioner(cluster_graph, n_components):
     return assignments
 
 
+def read_rank_costs(filename):
+    """ Read the compute time of each rank from a file written by
+    ``nengo_mpi --rank-costs``. Returns a list indexed by rank. """
+
+    costs = {}
+
+    with open(filename, 'r') as f:
+        header = f.readline().strip().split(',')
+        rank_col = header.index('rank')
+        compute_col = header.index('compute')
+
+        for line in f:
+            line = line.strip()
+            if not line:
+                continue
+
+            fields = line.split(',')
+            costs[int(fields[rank_col])] = float(fields[compute_col])
+
+    return [costs.get(r, 0.0) for r in range(max(costs) + 1)]
+
+
+def measured_cost_key(rank_costs, previous_assignments):
+    """ Make a key for greedy_balanced_partition giving the measured cost
+    of a cluster: the number of neurons in each of its objects, times the
+    cost per neuron of the rank that simulated that object.
+
+    Components were spread over ranks round-robin, so component c ran on
+    rank c % n_ranks. Objects that were not in the previous partition, and
+    ranks with no neurons, are given the mean cost per neuron. """
+
+    if isinstance(rank_costs, str):
+        rank_costs = read_rank_costs(rank_costs)
+
+    n_ranks = len(rank_costs)
+    neurons = [0] * n_ranks
+
+    for obj, component in previous_assignments.items():
+        neurons[component % n_ranks] += getattr(obj, 'n_neurons', 0)
+
+    total_neurons = sum(neurons)
+    mean_cost = sum(rank_costs) / total_neurons if total_neurons else 1.0
+
+    per_neuron = [
+        rank_costs[r] / neurons[r] if neurons[r] else mean_cost
+        for r in range(n_ranks)]
+
+    def key(cluster):
+        cost = 0.0
+
+        for obj in cluster.objects:
+            n_neurons = getattr(obj, 'n_neurons', 0)
+            component = previous_assignments.get(obj)
+
+            if component is None:
+                cost += n_neurons * mean_cost
+            else:
+                cost += n_neurons * per_neuron[component % n_ranks]
+
+        return cost
+
+    return key
+
+
 class PriorityDict(dict):
     """
     Retrieved from: http://code.activestate.com/recipes/
@@ -20,7 +20,8 @@ class Simulator(object):
 
     def __init__(
             self, network, dt=0.001, seed=None, model=None,
-            partitioner=None, assignments=None, save_file=""):
+            partitioner=None, assignments=None, save_file="",
+            probe_storage=None, op_tables=True):
         """
         Creates a Simulator for a nengo network than can be executed
         in parallel using MPI.
@@ -60,6 +61,17 @@ class Simulator(object):
             Name of file that will store all data added to the simulator.
             The simulator can later be reconstructed from this file. If
             equal to the empty string, then no file is created.
+
+        probe_storage: dict
+            Maps probes to the way their data is stored when the simulation
+            is logged to an HDF5 file: "dense" (a matrix with one row per
+            sample) or "events" (the locations of non-zero entries). By
+            default, probes on the output of spiking neurons use "events".
+
+        op_tables: bool
+            Whether to store operators in the network file as binary tables
+            (one per operator type) rather than as strings. Tables are
+            faster to load; strings are kept for compatibility.
         """
 
         self.runnable = not save_file
@@ -95,7 +107,8 @@ class Simulator(object):
             self.n_components, self.assignments, dt=dt,
             label="%s, dt=%f" % (network, dt),
             decoder_cache=get_default_decoder_cache(),
-            save_file=save_file)
+            save_file=save_file, probe_storage=probe_storage,
+            op_tables=op_tables)
 
         MpiBuilder.build(self.model, network)
 
@@ -1,5 +1,8 @@
 import os
+import shutil
 import subprocess
+import tempfile
+from contextlib import contextmanager
 import pytest
 import h5py
 
@@ -15,6 +18,55 @@ all_neurons = [
     AdaptiveLIF, AdaptiveLIFRate]  # Izhikevich]
 
 
+@contextmanager
+def saved_network(model, **sim_kwargs):
+    """ Save `model` to a network file, which is removed on exit. Keyword
+    arguments are passed to nengo_mpi.Simulator. """
+
+    network_file = "test_nengo.net"
+
+    try:
+        nengo_mpi.Simulator(model, save_file=network_file, **sim_kwargs)
+        yield network_file
+    finally:
+        try:
+            os.remove(network_file)
+        except:
+            pass
+
+
+def nengo_cpp(network_file, sim_time, extra_args=()):
+    """ Run `network_file` for `sim_time` seconds with nengo_cpp. Returns
+    the probe data it logged, as an open h5py.File, and its output. """
+
+    fd, log_file = tempfile.mkstemp(suffix='.h5')
+    os.close(fd)
+
+    try:
+        output = subprocess.check_output(
+            ['nengo_cpp', '--noprog', '--log', log_file] +
+            list(extra_args) + [network_file, str(sim_time)])
+
+        results = h5py.File(log_file, 'r')
+    finally:
+        try:
+            os.remove(log_file)
+        except:
+            pass
+
+    return results, output
+
+
+def run_nengo_cpp(model, sim_time, extra_args=(), **sim_kwargs):
+    """ Save `model` to a network file and run it with nengo_cpp, returning
+    the probe data. Keyword arguments are passed to nengo_mpi.Simulator. """
+
+    with saved_network(model, **sim_kwargs) as network_file:
+        results, _ = nengo_cpp(network_file, sim_time, extra_args)
+
+    return results
+
+
 @pytest.mark.parametrize("neuron_type", all_neurons)
 @pytest.mark.parametrize("synapse", [None, 0.0, 0.02, 0.05])
 def test_basic_cpp(neuron_type, synapse):
@@ -41,27 +93,259 @@ def test_basic_cpp(neuron_type, synapse):
     refimpl_sim = nengo.Simulator(m)
     refimpl_sim.run(sim_time)
 
-    network_file = "test_nengo.net"
-    log_file = "test_nengo.h5"
+    results = run_nengo_cpp(m, sim_time)
 
-    try:
-        nengo_mpi.Simulator(m, save_file=network_file)
-        subprocess.check_output(
-            ['nengo_cpp', '--noprog', network_file, str(sim_time)])
+    assert np.allclose(
+        refimpl_sim.data[A_p], results[str(id(A_p))], atol=0.00001, rtol=0.00)
+    assert np.allclose(
+        refimpl_sim.data[B_p], results[str(id(B_p))], atol=0.00001, rtol=0.00)
 
-        results = h5py.File(log_file, 'r')
-    finally:
-        try:
-            os.remove(network_file)
-        except:
-            pass
 
-        try:
-            os.remove(log_file)
-        except:
-            pass
+def test_spike_events_cpp():
+    n_neurons = 40
+
+    m = nengo.Network(seed=1)
+    with m:
+        A = nengo.Ensemble(n_neurons, dimensions=1, neuron_type=LIF())
+
+        input = nengo.Node(0.5)
+        nengo.Connection(input, A)
+
+        A_p = nengo.Probe(A)
+        spikes_p = nengo.Probe(A.neurons)
+
+    sim_time = 1
+
+    refimpl_sim = nengo.Simulator(m)
+    refimpl_sim.run(sim_time)
+
+    results = run_nengo_cpp(m, sim_time)
+
+    spikes = results[str(id(spikes_p))]
+    assert spikes.attrs['storage'] == 'events'
+
+    events = spikes['events'][:]
+    index = spikes['index'][:]
+    assert index.shape[0] == refimpl_sim.data[spikes_p].shape[0]
+    assert np.all(np.diff(index) >= 0)
+
+    dense = np.zeros((index.shape[0], spikes.attrs['n_cols']))
+    dense[events[:, 0], events[:, 1]] = spikes.attrs['amplitude']
+
+    assert np.allclose(refimpl_sim.data[spikes_p], dense)
+    assert np.allclose(
+        refimpl_sim.data[A_p], results[str(id(A_p))], atol=0.00001, rtol=0.00)
+
+
+def test_filtered_spike_probe_cpp():
+    n_neurons = 40
+
+    m = nengo.Network(seed=1)
+    with m:
+        A = nengo.Ensemble(n_neurons, dimensions=1, neuron_type=LIF())
+
+        input = nengo.Node(0.5)
+        nengo.Connection(input, A)
+
+        filtered_p = nengo.Probe(A.neurons, synapse=0.01)
+
+    sim_time = 1
+
+    refimpl_sim = nengo.Simulator(m)
+    refimpl_sim.run(sim_time)
+
+    results = run_nengo_cpp(m, sim_time)
+
+    filtered = results[str(id(filtered_p))]
+    assert isinstance(filtered, h5py.Dataset)
+    assert 'storage' not in filtered.attrs
+
+    assert np.allclose(
+        refimpl_sim.data[filtered_p], filtered, atol=0.00001, rtol=0.00)
+
+
+@pytest.mark.parametrize("op_tables", [True, False])
+def test_op_tables_cpp(op_tables):
+    n_neurons = 40
+
+    m = nengo.Network(seed=1)
+    with m:
+        A = nengo.Ensemble(n_neurons, dimensions=2)
+        B = nengo.Ensemble(n_neurons, dimensions=2)
+
+        nengo.Connection(A[0], B[1], synapse=0.02)
+
+        input = nengo.Node([0.3, -0.4])
+        nengo.Connection(input, A, synapse=0.05)
+
+        A_p = nengo.Probe(A)
+        B_p = nengo.Probe(B)
+
+    sim_time = 1
+
+    refimpl_sim = nengo.Simulator(m)
+    refimpl_sim.run(sim_time)
+
+    with saved_network(m, op_tables=op_tables) as network_file:
+        with h5py.File(network_file, 'r') as network:
+            assert ('op_tables' in network['0']) == op_tables
+
+        results, _ = nengo_cpp(network_file, sim_time)
 
     assert np.allclose(
         refimpl_sim.data[A_p], results[str(id(A_p))], atol=0.00001, rtol=0.00)
     assert np.allclose(
         refimpl_sim.data[B_p], results[str(id(B_p))], atol=0.00001, rtol=0.00)
+
+
+@pytest.mark.parametrize("op_tables", [True, False])
+def test_in_memory_cpp(op_tables):
+    """ A network handed to the simulator in memory gives the same probe
+    data as the same network saved to a file and run with nengo_cpp. """
+
+    n_neurons = 40
+
+    m = nengo.Network(seed=1)
+    with m:
+        A = nengo.Ensemble(n_neurons, dimensions=2)
+        B = nengo.Ensemble(n_neurons, dimensions=2)
+
+        nengo.Connection(A, B, synapse=0.02, transform=[[0, 1], [-1, 0]])
+
+        input = nengo.Node([0.3, -0.4])
+        nengo.Connection(input, A, synapse=0.05)
+
+        A_p = nengo.Probe(A)
+        B_p = nengo.Probe(B, synapse=0.01)
+
+    sim_time = 1
+
+    mpi_sim = nengo_mpi.Simulator(m, op_tables=op_tables)
+    mpi_sim.run(sim_time)
+
+    results = run_nengo_cpp(m, sim_time, op_tables=op_tables)
+
+    assert np.allclose(
+        mpi_sim.data[A_p], results[str(id(A_p))], atol=0.00001, rtol=0.00)
+    assert np.allclose(
+        mpi_sim.data[B_p], results[str(id(B_p))], atol=0.00001, rtol=0.00)
+
+
+def test_fold_signals_cpp():
+    """ Folding identical read-only signals onto shared storage does not
+    change the probe data. """
+
+    n_neurons = 40
+
+    m = nengo.Network(seed=1)
+    with m:
+        input = nengo.Node([0.3, -0.4])
+
+        # A and B are built from the same seed, so their gains, biases,
+        # encoders and decoders are identical read-only signals.
+        A = nengo.Ensemble(n_neurons, dimensions=2, seed=2)
+        B = nengo.Ensemble(n_neurons, dimensions=2, seed=2)
+        C = nengo.Ensemble(n_neurons, dimensions=2)
+
+        nengo.Connection(input, A, synapse=0.05)
+        nengo.Connection(input, B, synapse=0.01)
+        nengo.Connection(A, C, synapse=0.02, transform=[[0, 1], [-1, 0]])
+        nengo.Connection(B, C, synapse=0.02)
+
+        A_p = nengo.Probe(A)
+        B_p = nengo.Probe(B)
+        C_p = nengo.Probe(C, synapse=0.01)
+
+    sim_time = 0.5
+
+    with saved_network(m) as network_file:
+        results, _ = nengo_cpp(network_file, sim_time)
+        folded_results, output = nengo_cpp(
+            network_file, sim_time, ['--fold-signals'])
+
+    assert b"Folded" in output
+
+    for p in [A_p, B_p, C_p]:
+        assert np.array_equal(
+            results[str(id(p))][...], folded_results[str(id(p))][...])
+
+
+def assert_same_probe_data(results, other_results, probes):
+    """ Check that two nengo_cpp runs logged identical data for `probes`. """
+
+    for p in probes:
+        data = results[str(id(p))]
+        other_data = other_results[str(id(p))]
+
+        # Spiking probes stored as events are groups of datasets.
+        if isinstance(data, h5py.Group):
+            for name in data:
+                assert np.array_equal(data[name][...], other_data[name][...])
+        else:
+            assert np.array_equal(data[...], other_data[...])
+
+
+def image_test_network(transform=[[0, 1], [-1, 0]]):
+    m = nengo.Network(seed=1)
+    with m:
+        A = nengo.Ensemble(40, dimensions=2)
+        B = nengo.Ensemble(40, dimensions=2)
+
+        nengo.Connection(A, B, synapse=0.02, transform=transform)
+
+        input = nengo.Node([0.3, -0.4])
+        nengo.Connection(input, A, synapse=0.05)
+
+        probes = [nengo.Probe(A), nengo.Probe(B, synapse=0.01),
+                  nengo.Probe(B.neurons)]
+
+    return m, probes
+
+
+def test_network_image_cpp():
+    """ A network loaded from an image, either saved with --save-image or
+    found in the build cache, gives the same probe data as the network
+    loaded from the file. A changed network misses the build cache. """
+
+    m, probes = image_test_network()
+    sim_time = 0.5
+
+    image_dir = tempfile.mkdtemp()
+    image_prefix = os.path.join(image_dir, 'test_nengo')
+    cache_dir = os.path.join(image_dir, 'cache')
+    cache_args = ['--build-cache', cache_dir]
+
+    try:
+        with saved_network(m) as network_file:
+            results, _ = nengo_cpp(network_file, sim_time)
+            nengo_cpp(network_file, sim_time, ['--save-image', image_prefix])
+
+            assert os.path.exists(image_prefix + '_0.img')
+
+            image_results, _ = nengo_cpp(
+                network_file, sim_time, ['--load-image', image_prefix])
+
+            _, output = nengo_cpp(network_file, sim_time, cache_args)
+            assert b"Saving network to build cache" in output
+
+            cached_results, output = nengo_cpp(
+                network_file, sim_time, cache_args)
+            assert b"Loading network from build cache" in output
+
+        assert_same_probe_data(results, image_results, probes)
+        assert_same_probe_data(results, cached_results, probes)
+
+        # Same structure and file name, different weights.
+        m, probes = image_test_network(transform=[[0, -1], [1, 0]])
+
+        with saved_network(m) as network_file:
+            results, _ = nengo_cpp(network_file, sim_time)
+
+            changed_results, output = nengo_cpp(
+                network_file, sim_time, cache_args)
+            assert b"Saving network to build cache" in output
+
+        assert len(os.listdir(cache_dir)) == 2
+        assert_same_probe_data(results, changed_results, probes)
+    finally:
+        shutil.rmtree(image_dir)
@@ -23,6 +23,41 @@ def load_probes(probe_ids, f):
     f = h5py.File(f, 'r')
 
 
+def load_event_probe(group, start=0, stop=None):
+    """
+    Reconstruct dense data for a probe that was stored as a list of events.
+
+    Parameters
+    ----------
+    group: h5.Group
+        The group for the probe, containing ``events'' and ``index''
+        datasets.
+
+    start, stop: int
+        Range of samples to load. Only the events within the range are read
+        from the file.
+
+    Returns
+    -------
+    An array with one row per sample in the range.
+    """
+
+    index = group['index']
+    n_samples = index.shape[0]
+    stop = n_samples if stop is None else min(stop, n_samples)
+
+    first = index[start] if start < n_samples else 0
+    last = index[stop] if stop < n_samples else group['events'].shape[0]
+
+    data = np.zeros((stop - start, group.attrs['n_cols']))
+
+    if last > first:
+        events = group['events'][first:last]
+        data[events[:, 0] - start, events[:, 1]] = group.attrs['amplitude']
+
+    return data
+
+
 def merge_probes(probe_map, infile, outfile):
     """
     When we split up ensemble arrays (as we sometimes have to do in order to
@@ -0,0 +1,104 @@
+import mmap
+import os
+import struct
+import sys
+import time
+
+import numpy as np
+
+# Must match the layout of ProbeStreamHeader and ProbeStreamRecord
+# in mpi_sim/probe_stream.hpp.
+MAGIC = 0x6e656e676f737472
+HEADER_FORMAT = "=QQQQQQ"
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+READ_POS_OFFSET = 24
+RECORD_FORMAT = "=QQqII"
+RECORD_SIZE = struct.calcsize(RECORD_FORMAT)
+
+
+class ProbeStreamReader(object):
+    """
+    Attach to a probe stream created by running nengo_mpi or nengo_cpp
+    with ``--stream name``. One stream exists per MPI process.
+
+    Parameters
+    ----------
+    name: string
+        Name passed to ``--stream``.
+
+    rank: int
+        Rank of the process whose stream to read.
+    """
+
+    def __init__(self, name, rank=0):
+        path = "/dev/shm/%s_%d" % (name, rank)
+        with open(path, 'r+b') as f:
+            self.mm = mmap.mmap(f.fileno(), 0)
+
+        magic, self.capacity = struct.unpack_from("=QQ", self.mm, 0)
+        if magic != MAGIC:
+            raise IOError("%s is not a nengo_mpi probe stream." % path)
+
+    def _header(self):
+        keys = [
+            'magic', 'capacity', 'write_pos', 'read_pos',
+            'n_published', 'n_dropped']
+        return dict(zip(keys, struct.unpack_from(HEADER_FORMAT, self.mm, 0)))
+
+    def _read_bytes(self, pos, n_bytes):
+        offset = HEADER_SIZE + pos % self.capacity
+        first = min(n_bytes, self.capacity - pos % self.capacity)
+        data = self.mm[offset:offset+first]
+
+        if first < n_bytes:
+            data += self.mm[HEADER_SIZE:HEADER_SIZE + n_bytes - first]
+
+        return data
+
+    def poll(self):
+        """
+        Return a list of (probe_key, step, data) tuples for all blocks
+        published since the last call. ``data`` has shape (n_rows, n_cols).
+        """
+        header = self._header()
+        read_pos = header['read_pos']
+        write_pos = header['write_pos']
+
+        blocks = []
+        while read_pos < write_pos:
+            record_size, key, step, n_rows, n_cols = struct.unpack(
+                RECORD_FORMAT, self._read_bytes(read_pos, RECORD_SIZE))
+
+            raw = self._read_bytes(
+                read_pos + RECORD_SIZE, record_size - RECORD_SIZE)
+            data = np.frombuffer(raw, dtype=np.float64)
+            blocks.append((key, step, data.reshape(n_rows, n_cols)))
+
+            read_pos += record_size
+
+        struct.pack_into("=Q", self.mm, READ_POS_OFFSET, read_pos)
+
+        return blocks
+
+    @property
+    def n_dropped(self):
+        return self._header()['n_dropped']
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print("Usage: python stream_probes.py <stream name> [rank]")
+        sys.exit(1)
+
+    name = sys.argv[1]
+    rank = int(sys.argv[2]) if len(sys.argv) > 2 else 0
+
+    reader = ProbeStreamReader(name, rank)
+
+    while os.path.exists("/dev/shm/%s_%d" % (name, rank)):
+        for key, step, data in reader.poll():
+            print(
+                "probe %d, step %d: %d rows, mean %f"
+                % (key, step, data.shape[0], data.mean()))
+
+        time.sleep(0.1)